@@ -0,0 +1,202 @@
+#include "Analytics.h"
+
+#include <iomanip>
+#include <iostream>
+
+using namespace std;
+
+//*********************************************************************
+//  ShotHeatmapReducer
+//*********************************************************************
+
+ShotHeatmapReducer::ShotHeatmapReducer()
+: m_shots(MAXROWS * MAXCOLS, 0), m_hits(MAXROWS * MAXCOLS, 0)
+{}
+
+void ShotHeatmapReducer::add(const ReplayGame& game)
+{
+    int n = game.nShots();
+    for (int i = 0; i < n; i++)
+    {
+        ReplayShot s = game.shot(i);
+        if (!s.validShot())
+            continue;
+        m_shots[s.cell()]++;
+        if (s.shotHit())
+            m_hits[s.cell()]++;
+    }
+}
+
+void ShotHeatmapReducer::merge(const ShotHeatmapReducer& other)
+{
+    for (size_t i = 0; i < m_shots.size(); i++)
+    {
+        m_shots[i] += other.m_shots[i];
+        m_hits[i] += other.m_hits[i];
+    }
+}
+
+void ShotHeatmapReducer::print(int nRows, int nCols) const
+{
+    cout << "Hit rate by cell (percent of valid shots at that cell):" << endl;
+    for (int r = 0; r < nRows; r++)
+    {
+        for (int c = 0; c < nCols; c++)
+        {
+            long long shots = m_shots[r * MAXCOLS + c];
+            long long hits = m_hits[r * MAXCOLS + c];
+            cout << setw(4) << (shots == 0 ? 0 : 100 * hits / shots);
+        }
+        cout << endl;
+    }
+}
+
+//*********************************************************************
+//  FirstHitLatencyReducer
+//*********************************************************************
+
+void FirstHitLatencyReducer::add(const ReplayGame& game)
+{
+    int shotsSoFar[2] = { 0, 0 };
+    bool done[2] = { false, false };
+    int n = game.nShots();
+    for (int i = 0; i < n  &&  !(done[0] && done[1]); i++)
+    {
+        ReplayShot s = game.shot(i);
+        int p = s.player();
+        if (done[p])
+            continue;
+        shotsSoFar[p]++;
+        if (s.shotHit())
+        {
+            done[p] = true;
+            if ((int)m_histogram.size() <= shotsSoFar[p])
+                m_histogram.resize(shotsSoFar[p] + 1, 0);
+            m_histogram[shotsSoFar[p]]++;
+        }
+    }
+}
+
+void FirstHitLatencyReducer::merge(const FirstHitLatencyReducer& other)
+{
+    if (m_histogram.size() < other.m_histogram.size())
+        m_histogram.resize(other.m_histogram.size(), 0);
+    for (size_t i = 0; i < other.m_histogram.size(); i++)
+        m_histogram[i] += other.m_histogram[i];
+}
+
+double FirstHitLatencyReducer::mean() const
+{
+    long long n = 0;
+    long long total = 0;
+    for (size_t i = 0; i < m_histogram.size(); i++)
+    {
+        n += m_histogram[i];
+        total += m_histogram[i] * (long long)i;
+    }
+    return n == 0 ? 0 : double(total) / n;
+}
+
+void FirstHitLatencyReducer::print() const
+{
+    cout << "Shots needed for a first hit: mean " << mean() << endl;
+    for (size_t i = 1; i < m_histogram.size(); i++)
+        if (m_histogram[i] != 0)
+            cout << setw(5) << i << setw(12) << m_histogram[i] << endl;
+}
+
+//*********************************************************************
+//  SinkOrderReducer
+//*********************************************************************
+
+SinkOrderReducer::SinkOrderReducer(int nShips)
+: m_nShips(nShips), m_counts(nShips * nShips, 0)
+{}
+
+void SinkOrderReducer::add(const ReplayGame& game)
+{
+    int sunk[2] = { 0, 0 };
+    int n = game.nShots();
+    for (int i = 0; i < n; i++)
+    {
+        ReplayShot s = game.shot(i);
+        if (!s.shipDestroyed()  ||  s.shipId() < 0  ||  s.shipId() >= m_nShips)
+            continue;
+        int p = s.player();
+        if (sunk[p] < m_nShips)
+            m_counts[s.shipId() * m_nShips + sunk[p]]++;
+        sunk[p]++;
+    }
+}
+
+void SinkOrderReducer::merge(const SinkOrderReducer& other)
+{
+    for (size_t i = 0; i < m_counts.size(); i++)
+        m_counts[i] += other.m_counts[i];
+}
+
+void SinkOrderReducer::print() const
+{
+    cout << "Times each ship was sunk k-th (rows are ship ids, columns k = 1.."
+    << m_nShips << "):" << endl;
+    for (int s = 0; s < m_nShips; s++)
+    {
+        cout << setw(3) << s;
+        for (int k = 0; k < m_nShips; k++)
+            cout << setw(10) << m_counts[s * m_nShips + k];
+        cout << endl;
+    }
+}
+
+//*********************************************************************
+//  OpeningReducer
+//*********************************************************************
+
+OpeningReducer::OpeningReducer()
+: m_games(MAXROWS * MAXCOLS, 0), m_wins(MAXROWS * MAXCOLS, 0)
+{}
+
+void OpeningReducer::add(const ReplayGame& game)
+{
+    bool seen[2] = { false, false };
+    int n = game.nShots();
+    for (int i = 0; i < n  &&  !(seen[0] && seen[1]); i++)
+    {
+        ReplayShot s = game.shot(i);
+        int p = s.player();
+        if (seen[p])
+            continue;
+        seen[p] = true;
+        if (!s.onBoard())
+            continue;
+        m_games[s.cell()]++;
+        if (game.winner() == p)
+            m_wins[s.cell()]++;
+    }
+}
+
+void OpeningReducer::merge(const OpeningReducer& other)
+{
+    for (size_t i = 0; i < m_games.size(); i++)
+    {
+        m_games[i] += other.m_games[i];
+        m_wins[i] += other.m_wins[i];
+    }
+}
+
+void OpeningReducer::print(int nRows, int nCols) const
+{
+    cout << "Win rate by first shot (percent, - if never opened there):" << endl;
+    for (int r = 0; r < nRows; r++)
+    {
+        for (int c = 0; c < nCols; c++)
+        {
+            long long games = m_games[r * MAXCOLS + c];
+            if (games == 0)
+                cout << setw(4) << '-';
+            else
+                cout << setw(4) << 100 * m_wins[r * MAXCOLS + c] / games;
+        }
+        cout << endl;
+    }
+}
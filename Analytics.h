@@ -0,0 +1,137 @@
+#ifndef ANALYTICS_INCLUDED
+#define ANALYTICS_INCLUDED
+
+#include "Replay.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Run reducers over archived games in parallel.
+//
+// A reducer is any copyable type with
+//     void add(const ReplayGame& game);
+//     void merge(const Reducer& other);
+// Each thread works on its own copy of init, taking chunks of
+// blocksPerChunk blocks at a time from any of the files, and the copies
+// are merged when all games have been seen.  nThreads == 0 means one
+// thread per core.  If rejected is not null it is set to the number of
+// blocks found corrupt, whose games from the first bad one on were skipped.
+template <class Reducer>
+Reducer reduceReplays(const std::vector<const ReplayFile*>& files, const Reducer& init,
+                      int nThreads = 0, int blocksPerChunk = 16, size_t* rejected = nullptr)
+{
+    if (nThreads <= 0)
+        nThreads = std::max(1u, std::thread::hardware_concurrency());
+    if (blocksPerChunk < 1)
+        blocksPerChunk = 1;
+
+    // chunk k is blocks [first, first+blocksPerChunk) of one file
+    struct Chunk
+    {
+        const ReplayFile* file;
+        size_t first;
+    };
+    std::vector<Chunk> chunks;
+    for (size_t f = 0; f < files.size(); f++)
+        if (files[f]->ok())
+            for (size_t b = 0; b < files[f]->nBlocks(); b += blocksPerChunk)
+                chunks.push_back(Chunk{ files[f], b });
+
+    Reducer total = init;
+    std::mutex totalMutex;
+    std::atomic<size_t> next(0);
+    std::atomic<size_t> bad(0);
+
+    auto worker = [&]() {
+        Reducer mine = init;
+        for (size_t k = next++; k < chunks.size(); k = next++)
+        {
+            const Chunk& c = chunks[k];
+            size_t end = std::min(c.first + blocksPerChunk, c.file->nBlocks());
+            for (size_t b = c.first; b < end; b++)
+                if (!c.file->forEachGame(b, [&mine](const ReplayGame& game) { mine.add(game); }))
+                    bad++;
+        }
+        std::lock_guard<std::mutex> lock(totalMutex);
+        total.merge(mine);
+    };
+
+    std::vector<std::thread> threads;
+    for (int t = 1; t < nThreads; t++)
+        threads.push_back(std::thread(worker));
+    worker();
+    for (size_t t = 0; t < threads.size(); t++)
+        threads[t].join();
+    if (rejected != nullptr)
+        *rejected = bad.load();
+    return total;
+}
+
+template <class Reducer>
+Reducer reduceReplays(const ReplayFile& file, const Reducer& init, int nThreads = 0,
+                      size_t* rejected = nullptr)
+{
+    return reduceReplays(std::vector<const ReplayFile*>(1, &file), init, nThreads, 16, rejected);
+}
+
+//*********************************************************************
+//  Built-in reducers
+//*********************************************************************
+
+// How often each cell was shot at and hit, over both players
+class ShotHeatmapReducer
+{
+public:
+    ShotHeatmapReducer();
+    void add(const ReplayGame& game);
+    void merge(const ShotHeatmapReducer& other);
+    void print(int nRows, int nCols) const;
+    long long shots(int r, int c) const { return m_shots[r * MAXCOLS + c]; }
+    long long hits(int r, int c) const { return m_hits[r * MAXCOLS + c]; }
+private:
+    std::vector<long long> m_shots;
+    std::vector<long long> m_hits;
+};
+
+// How many of its own shots a player needed to score its first hit
+class FirstHitLatencyReducer
+{
+public:
+    void add(const ReplayGame& game);
+    void merge(const FirstHitLatencyReducer& other);
+    void print() const;
+    double mean() const;
+private:
+    std::vector<long long> m_histogram;     // [shots] -> number of players
+};
+
+// In which order ships were sunk: how often each ship was the k-th to go down
+class SinkOrderReducer
+{
+public:
+    SinkOrderReducer(int nShips);
+    void add(const ReplayGame& game);
+    void merge(const SinkOrderReducer& other);
+    void print() const;
+    long long count(int shipId, int position) const { return m_counts[shipId * m_nShips + position]; }
+private:
+    int m_nShips;
+    std::vector<long long> m_counts;        // [ship][position]
+};
+
+// Games played and won by players whose first shot was at each cell
+class OpeningReducer
+{
+public:
+    OpeningReducer();
+    void add(const ReplayGame& game);
+    void merge(const OpeningReducer& other);
+    void print(int nRows, int nCols) const;
+private:
+    std::vector<long long> m_games;
+    std::vector<long long> m_wins;
+};
+
+#endif // ANALYTICS_INCLUDED
@@ -0,0 +1,127 @@
+#ifndef BITBOARD_INCLUDED
+#define BITBOARD_INCLUDED
+
+#include "globals.h"
+#include <cstdint>
+
+// A set of board cells packed into 128 bits.  Cell (r,c) is stored at bit
+// r*MAXCOLS + c no matter how big the actual board is, so every board up to
+// MAXROWS x MAXCOLS fits and masks from different board sizes line up.
+class Bitboard
+{
+public:
+    constexpr Bitboard() : m_lo(0), m_hi(0) {}
+    constexpr Bitboard(uint64_t lo, uint64_t hi) : m_lo(lo), m_hi(hi) {}
+
+    static constexpr int index(int r, int c) { return r * MAXCOLS + c; }
+    static constexpr int index(Point p) { return index(p.r, p.c); }
+    static Point point(int i) { return Point(i / MAXCOLS, i % MAXCOLS); }
+
+    static constexpr Bitboard bit(int i)
+    {
+        return i < 64 ? Bitboard(uint64_t(1) << i, 0)
+                      : Bitboard(0, uint64_t(1) << (i - 64));
+    }
+    static constexpr Bitboard cell(int r, int c) { return bit(index(r, c)); }
+    static constexpr Bitboard cell(Point p) { return bit(index(p)); }
+
+    constexpr bool testBit(int i) const
+    {
+        return i < 64 ? (m_lo >> i) & 1 : (m_hi >> (i - 64)) & 1;
+    }
+    constexpr bool test(int r, int c) const { return testBit(index(r, c)); }
+    constexpr bool test(Point p) const { return testBit(index(p)); }
+
+    constexpr bool empty() const { return (m_lo | m_hi) == 0; }
+    constexpr bool intersects(Bitboard o) const
+    {
+        return ((m_lo & o.m_lo) | (m_hi & o.m_hi)) != 0;
+    }
+    // true if every cell of o is also in this set
+    constexpr bool contains(Bitboard o) const
+    {
+        return (o.m_lo & ~m_lo) == 0  &&  (o.m_hi & ~m_hi) == 0;
+    }
+
+    constexpr Bitboard operator|(Bitboard o) const { return Bitboard(m_lo | o.m_lo, m_hi | o.m_hi); }
+    constexpr Bitboard operator&(Bitboard o) const { return Bitboard(m_lo & o.m_lo, m_hi & o.m_hi); }
+    constexpr Bitboard operator^(Bitboard o) const { return Bitboard(m_lo ^ o.m_lo, m_hi ^ o.m_hi); }
+    // cells of this set that are not in o
+    constexpr Bitboard without(Bitboard o) const { return Bitboard(m_lo & ~o.m_lo, m_hi & ~o.m_hi); }
+    constexpr bool operator==(Bitboard o) const { return m_lo == o.m_lo  &&  m_hi == o.m_hi; }
+    constexpr bool operator!=(Bitboard o) const { return !(*this == o); }
+
+    Bitboard& operator|=(Bitboard o) { m_lo |= o.m_lo; m_hi |= o.m_hi; return *this; }
+    Bitboard& operator&=(Bitboard o) { m_lo &= o.m_lo; m_hi &= o.m_hi; return *this; }
+    Bitboard& operator^=(Bitboard o) { m_lo ^= o.m_lo; m_hi ^= o.m_hi; return *this; }
+
+    int count() const { return __builtin_popcountll(m_lo) + __builtin_popcountll(m_hi); }
+
+    // index of the lowest cell in the set, or -1 if the set is empty
+    int lowest() const
+    {
+        if (m_lo != 0)
+            return __builtin_ctzll(m_lo);
+        if (m_hi != 0)
+            return 64 + __builtin_ctzll(m_hi);
+        return -1;
+    }
+
+    // remove and return the lowest cell; the set must not be empty
+    int popLowest()
+    {
+        int i = lowest();
+        if (m_lo != 0)
+            m_lo &= m_lo - 1;
+        else
+            m_hi &= m_hi - 1;
+        return i;
+    }
+
+    // the set with every cell moved n places lower (cell i + n becomes
+    // cell i), for 0 <= n < 128
+    Bitboard lowered(int n) const
+    {
+        if (n == 0)
+            return *this;
+        if (n >= 64)
+            return Bitboard(m_hi >> (n - 64), 0);
+        return Bitboard((m_lo >> n) | (m_hi << (64 - n)), m_hi >> n);
+    }
+
+    uint64_t lo() const { return m_lo; }
+    uint64_t hi() const { return m_hi; }
+
+    uint64_t hash() const
+    {
+        uint64_t h = m_lo * 0x9E3779B97F4A7C15ULL ^ (m_hi + 0x632BE59BD9B4E019ULL);
+        h ^= h >> 31;
+        h *= 0xBF58476D1CE4E5B9ULL;
+        return h ^ (h >> 29);
+    }
+
+private:
+    uint64_t m_lo;
+    uint64_t m_hi;
+};
+
+// all cells of an nRows x nCols board
+constexpr Bitboard boardMask(int nRows, int nCols)
+{
+    Bitboard b;
+    for (int r = 0; r < nRows; r++)
+        for (int c = 0; c < nCols; c++)
+            b = b | Bitboard::cell(r, c);
+    return b;
+}
+
+// cells covered by a ship of length len whose top or leftmost cell is (r,c)
+constexpr Bitboard shipMask(int r, int c, int len, Direction dir)
+{
+    Bitboard b;
+    for (int k = 0; k < len; k++)
+        b = b | (dir == HORIZONTAL ? Bitboard::cell(r, c + k) : Bitboard::cell(r + k, c));
+    return b;
+}
+
+#endif // BITBOARD_INCLUDED
@@ -1,6 +1,10 @@
 #include "Board.h"
+#include "Bitboard.h"
 #include "Game.h"
+#include "Heatmap.h"
+#include "Tuning.h"
 #include <iostream>
+#include <string>
 
 using namespace std;
 
@@ -14,8 +18,12 @@ public:
     bool placeShip(Point topOrLeft, int shipId, Direction dir);
     bool unplaceShip(Point topOrLeft, int shipId, Direction dir);
     void display(bool shotsOnly) const;
+    char displaySymbol(Point p, bool shotsOnly) const;
     bool attack(Point p, bool& shotHit, bool& shipDestroyed, int& shipId);
+    int attack(const vector<Point>& shots, vector<ShotResult>& results);
     bool allShipsDestroyed() const;
+    int shipAt(Point p) const;
+    bool isBlocked(Point p) const;
     
 private:
     const Game& m_game;
@@ -52,14 +60,38 @@ void BoardImpl::clear()
 
 void BoardImpl::block()
 {
-    // Block cells with 50% probability
+    // Block cells with the tuned probability.  At the default 50% that is
+    // one random bit per cell from each 32 bit draw; otherwise each cell
+    // gets a draw of its own, compared with the percentage of 2^32.
+    int percent = tuned(TUNE_BLOCK_PERCENT);
+    if (percent != 50)
+    {
+        uint32_t threshold = uint32_t(percent * 4294967296.0 / 100);
+        for (int r = 0; r < m_game.rows(); r++)
+            for (int c = 0; c < m_game.cols(); c++)
+                if (uint32_t(randomGenerator()()) < threshold)
+                    m_board[r][c] = '#';
+        return;
+    }
+    uint32_t bits = 0;
+    int nBits = 0;
     for (int r = 0; r < m_game.rows(); r++)
         for (int c = 0; c < m_game.cols(); c++)
-            if (randInt(2) == 0)
+        {
+            if (nBits == 0)
+            {
+                bits = randomGenerator()();
+                nBits = 32;
+            }
+            bool blocked = (bits & 1) != 0;
+            bits >>= 1;
+            nBits--;
+            if (blocked)
             {
                 // block cell (r,c) with #
                 m_board[r][c] = '#';
             }
+        }
     
     //TESTING BOARDS
     /*
@@ -202,6 +234,10 @@ bool BoardImpl::placeShip(Point topOrLeft, int shipId, Direction dir)
             break;
     }
     
+    if (heatmapsEnabled()){
+        recordPlacementHeat(shipMask(topOrLeft.r, topOrLeft.c, m_game.shipLength(shipId), dir), 1);
+    }
+    
     return true;
 }
 
@@ -252,10 +288,23 @@ bool BoardImpl::unplaceShip(Point topOrLeft, int shipId, Direction dir)
             break;
     }
     
+    if (heatmapsEnabled()){
+        recordPlacementHeat(shipMask(topOrLeft.r, topOrLeft.c, m_game.shipLength(shipId), dir), -1);
+    }
     
     return true;
 }
 
+char BoardImpl::displaySymbol(Point p, bool shotsOnly) const
+{
+    // if shots only T -> use period to display undamaged ship segment
+    char ch = m_board[p.r][p.c];
+    if (shotsOnly && ch != 'X' && ch != 'o' && ch != '#'){
+        return '.';
+    }
+    return ch;
+}
+
 void BoardImpl::display(bool shotsOnly) const
 {
     // o = missed attacks
@@ -266,39 +315,36 @@ void BoardImpl::display(bool shotsOnly) const
     // if shots only T -> use period to display undamaged ship segment
     //********************************************
     
+    // the whole board is put together in one buffer, reused from call to
+    // call, and written at once, rather than a character at a time with a
+    // flush after every row
+    static thread_local string frame;
+    frame.clear();
+    
     // print spaces
-    cout << "  ";
+    frame += "  ";
     
     // print col nums
     for (int i = 0; i < m_game.cols(); i++){
-        cout << i;
+        frame += to_string(i);
     }
     
     // new line to print rows
-    cout << endl;
+    frame += '\n';
     
     // print rows and row content
     for (int r = 0; r < m_game.rows(); r++){
-        cout << r << " ";
+        frame += to_string(r);
+        frame += ' ';
         
         for (int c = 0; c < m_game.cols(); c++){
-            
-            if (shotsOnly){
-                if (m_board[r][c] != 'X' && m_board[r][c] != 'o' && m_board[r][c] != '#'){
-                    cout << '.';
-                }
-                else {
-                    cout << m_board[r][c];
-                }
-            }
-            
-            else {
-                cout << m_board[r][c];
-            }
+            frame += displaySymbol(Point(r, c), shotsOnly);
         }
-        cout << endl;
+        frame += '\n';
     }
     
+    cout.write(frame.data(), frame.size());
+    cout.flush();
 }
 
 bool BoardImpl::attack(Point p, bool& shotHit, bool& shipDestroyed, int& shipId)
@@ -360,9 +406,72 @@ bool BoardImpl::attack(Point p, bool& shotHit, bool& shipDestroyed, int& shipId)
         shipDestroyed = false;
     }
     
+    if (heatmapsEnabled()){
+        recordShotHeat(p);
+    }
+    
     return true;
 }
 
+int BoardImpl::attack(const vector<Point>& shots, vector<ShotResult>& results)
+{
+    // count each ship's undamaged segments once, then let every hit take
+    // one off, so a ship is destroyed when its count reaches zero
+    int shipOf[256];
+    for (int i = 0; i < 256; i++){
+        shipOf[i] = -1;
+    }
+    for (int i = 0; i < m_ships; i++){
+        shipOf[(unsigned char)m_game.shipSymbol(i)] = i;
+    }
+    
+    vector<int> segments(m_ships, 0);
+    for (int r = 0; r < m_game.rows(); r++){
+        for (int c = 0; c < m_game.cols(); c++){
+            int id = shipOf[(unsigned char)m_board[r][c]];
+            if (id != -1){
+                segments[id]++;
+            }
+        }
+    }
+    
+    results.resize(shots.size());
+    int nValid = 0;
+    for (size_t k = 0; k < shots.size(); k++){
+        Point p = shots[k];
+        ShotResult& result = results[k];
+        result = ShotResult();
+        result.p = p;
+        
+        // a shot repeated within the salvo finds the cell already marked,
+        // so it is wasted just like a shot at a cell from an earlier turn
+        if (!m_game.isValid(p) || m_board[p.r][p.c] == 'o' || m_board[p.r][p.c] == 'X'){
+            continue;
+        }
+        
+        result.validShot = true;
+        nValid++;
+        int id = shipOf[(unsigned char)m_board[p.r][p.c]];
+        if (id == -1){
+            m_board[p.r][p.c] = 'o';
+        }
+        else {
+            m_board[p.r][p.c] = 'X';
+            result.shotHit = true;
+            if (--segments[id] == 0){
+                result.shipDestroyed = true;
+                result.shipId = id;
+            }
+        }
+        
+        if (heatmapsEnabled()){
+            recordShotHeat(p);
+        }
+    }
+    
+    return nValid;
+}
+
 bool BoardImpl::allShipsDestroyed() const
 {
     
@@ -383,6 +492,26 @@ bool BoardImpl::allShipsDestroyed() const
     return true;
 }
 
+int BoardImpl::shipAt(Point p) const
+{
+    if (!m_game.isValid(p)){
+        return -1;
+    }
+    
+    for (int i = 0; i < m_ships; i++){
+        if (m_board[p.r][p.c] == m_game.shipSymbol(i)){
+            return i;
+        }
+    }
+    
+    return -1;
+}
+
+bool BoardImpl::isBlocked(Point p) const
+{
+    return m_game.isValid(p)  &&  m_board[p.r][p.c] == '#';
+}
+
 //******************** Board functions ********************************
 Board::Board(const Game& g)
 {
@@ -424,12 +553,32 @@ void Board::display(bool shotsOnly) const
     m_impl->display(shotsOnly);
 }
 
+char Board::displaySymbol(Point p, bool shotsOnly) const
+{
+    return m_impl->displaySymbol(p, shotsOnly);
+}
+
 bool Board::attack(Point p, bool& shotHit, bool& shipDestroyed, int& shipId)
 {
     return m_impl->attack(p, shotHit, shipDestroyed, shipId);
 }
 
+int Board::attack(const vector<Point>& shots, vector<ShotResult>& results)
+{
+    return m_impl->attack(shots, results);
+}
+
 bool Board::allShipsDestroyed() const
 {
     return m_impl->allShipsDestroyed();
 }
+
+int Board::shipAt(Point p) const
+{
+    return m_impl->shipAt(p);
+}
+
+bool Board::isBlocked(Point p) const
+{
+    return m_impl->isBlocked(p);
+}
@@ -2,10 +2,21 @@
 #define BOARD_INCLUDED
 
 #include "globals.h"
+#include <vector>
 
 class Game;
 class BoardImpl;
 
+// What one shot of a salvo did, as attack reports it for a single shot
+struct ShotResult
+{
+    Point p;
+    bool validShot = false;     // on the board, and not shot at before (even earlier in the salvo)
+    bool shotHit = false;
+    bool shipDestroyed = false;
+    int shipId = -1;            // the ship it destroyed, or -1
+};
+
 class Board
 {
 public:
@@ -17,9 +28,24 @@ public:
     bool placeShip(Point topOrLeft, int shipId, Direction dir);
     bool unplaceShip(Point topOrLeft, int shipId, Direction dir);
     void display(bool shotsOnly) const;
+    
+    // the character display shows for the cell at p, which must be valid
+    char displaySymbol(Point p, bool shotsOnly) const;
+    
     bool attack(Point p, bool& shotHit, bool& shipDestroyed, int& shipId);
+    
+    // Fire a whole salvo, in order, with one scan of the board rather than
+    // one per shot; results[i] is what shots[i] did.  Returns the number
+    // of valid shots.
+    int attack(const std::vector<Point>& shots, std::vector<ShotResult>& results);
     bool allShipsDestroyed() const;
     
+    // id of the undamaged ship segment at p, or -1 if there is none
+    int shipAt(Point p) const;
+    
+    // true if p was blocked by block() and not yet unblocked
+    bool isBlocked(Point p) const;
+    
     // We prevent a Board object from being copied or assigned
     Board(const Board&) = delete;
     Board& operator=(const Board&) = delete;
@@ -0,0 +1,373 @@
+#include "Counting.h"
+#include "Game.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+//*********************************************************************
+//  BigCount
+//*********************************************************************
+
+BigCount::BigCount(uint64_t n)
+{
+    m_limbs[0] = n;
+    for (int k = 1; k < LIMBS; k++)
+        m_limbs[k] = 0;
+}
+
+bool BigCount::isZero() const
+{
+    for (int k = 0; k < LIMBS; k++)
+        if (m_limbs[k] != 0)
+            return false;
+    return true;
+}
+
+BigCount& BigCount::operator+=(const BigCount& o)
+{
+    uint64_t carry = 0;
+    for (int k = 0; k < LIMBS; k++)
+    {
+        uint64_t sum = m_limbs[k] + carry;
+        carry = (sum < carry);
+        m_limbs[k] = sum + o.m_limbs[k];
+        carry += (m_limbs[k] < sum);
+    }
+    return *this;
+}
+
+BigCount& BigCount::operator*=(uint32_t n)
+{
+    unsigned __int128 carry = 0;
+    for (int k = 0; k < LIMBS; k++)
+    {
+        unsigned __int128 product = (unsigned __int128)m_limbs[k] * n + carry;
+        m_limbs[k] = (uint64_t)product;
+        carry = product >> 64;
+    }
+    return *this;
+}
+
+bool BigCount::operator==(const BigCount& o) const
+{
+    return equal(m_limbs, m_limbs + LIMBS, o.m_limbs);
+}
+
+string BigCount::toString() const
+{
+    // peel off nine decimal digits at a time
+    uint64_t limbs[LIMBS];
+    copy(m_limbs, m_limbs + LIMBS, limbs);
+    string digits;
+    for (;;)
+    {
+        uint64_t rem = 0;
+        bool zero = true;
+        for (int k = LIMBS - 1; k >= 0; k--)
+        {
+            unsigned __int128 cur = ((unsigned __int128)rem << 64) | limbs[k];
+            limbs[k] = (uint64_t)(cur / 1000000000);
+            rem = (uint64_t)(cur % 1000000000);
+            if (limbs[k] != 0)
+                zero = false;
+        }
+        for (int d = 0; d < 9; d++)
+        {
+            digits += char('0' + rem % 10);
+            rem /= 10;
+            if (zero  &&  rem == 0)
+                break;
+        }
+        if (zero)
+            break;
+    }
+    reverse(digits.begin(), digits.end());
+    return digits;
+}
+
+double BigCount::toDouble() const
+{
+    double d = 0;
+    for (int k = LIMBS - 1; k >= 0; k--)
+        d = d * 18446744073709551616.0 + m_limbs[k];
+    return d;
+}
+
+//*********************************************************************
+//  countLayouts
+//*********************************************************************
+
+namespace {
+
+// the cells at or after the current one that earlier ships cover, and the
+// ships of each length still to place as one mixed-radix number
+struct CountState
+{
+    Bitboard covered;
+    uint64_t shipsLeft;
+    bool operator==(const CountState& o) const
+    {
+        return covered == o.covered  &&  shipsLeft == o.shipsLeft;
+    }
+};
+
+bool operator<(const CountState& a, const CountState& b)
+{
+    if (a.covered.hi() != b.covered.hi())
+        return a.covered.hi() < b.covered.hi();
+    if (a.covered.lo() != b.covered.lo())
+        return a.covered.lo() < b.covered.lo();
+    return a.shipsLeft < b.shipsLeft;
+}
+
+// Sort a list of states and add up the counts of equal ones
+template <class Count>
+void mergeRuns(vector<pair<CountState, Count>>& states)
+{
+    sort(states.begin(), states.end(),
+         [](const pair<CountState, Count>& a, const pair<CountState, Count>& b) {
+             return a.first < b.first;
+         });
+    size_t n = 0;
+    for (size_t j = 0; j < states.size(); j++)
+    {
+        if (n > 0  &&  states[n - 1].first == states[j].first)
+            states[n - 1].second += states[j].second;
+        else
+            states[n++] = states[j];
+    }
+    states.resize(n);
+}
+
+// Merge two lists sorted as mergeRuns leaves them into one such list,
+// adding up the counts of states in both
+template <class Count>
+void mergeSorted(const vector<pair<CountState, Count>>& a,
+                 const vector<pair<CountState, Count>>& b,
+                 vector<pair<CountState, Count>>& out)
+{
+    out.clear();
+    out.reserve(a.size() + b.size());
+    size_t i = 0;
+    size_t j = 0;
+    while (i < a.size()  &&  j < b.size())
+    {
+        if (a[i].first < b[j].first)
+            out.push_back(a[i++]);
+        else if (b[j].first < a[i].first)
+            out.push_back(b[j++]);
+        else
+        {
+            out.push_back(a[i++]);
+            out.back().second += b[j++].second;
+        }
+    }
+    out.insert(out.end(), a.begin() + i, a.end());
+    out.insert(out.end(), b.begin() + j, b.end());
+}
+
+// Call f(thread, i) for every i < n, spreading the calls over nThreads
+// threads
+template <class F>
+void parallelFor(size_t n, int nThreads, F f)
+{
+    atomic<size_t> next(0);
+    auto worker = [&](int t) {
+        for (size_t i = next++; i < n; i = next++)
+            f(t, i);
+    };
+    vector<thread> threads;
+    for (int t = 1; t < nThreads; t++)
+        threads.push_back(thread(worker, t));
+    worker(0);
+    for (size_t t = 0; t < threads.size(); t++)
+        threads[t].join();
+}
+
+// The profile DP behind countLayouts, with ships of equal length alike.
+// Count is uint64_t when no count can overflow it, which is much faster,
+// and BigCount otherwise.
+class LayoutCounter
+{
+public:
+    LayoutCounter(const Game& g, Bitboard misses, Bitboard hits, int nThreads);
+    // false if some count might not fit in 64 bits
+    bool small() const { return m_small; }
+    template <class Count> Count count() const;
+    // multiply n by the number of ways ships of equal length can be told
+    // apart
+    void tellApart(BigCount& n) const;
+private:
+    int m_rows;
+    int m_cols;
+    Bitboard m_open;
+    Bitboard m_hits;
+    int m_nThreads;
+    vector<int> m_lengths;          // the distinct lengths
+    vector<int> m_totals;           // ships of each length in the fleet
+    vector<uint64_t> m_place;       // place values of the ships left
+    uint64_t m_all;                 // every ship left
+    bool m_small;
+};
+
+LayoutCounter::LayoutCounter(const Game& g, Bitboard misses, Bitboard hits, int nThreads)
+: m_rows(g.rows()), m_cols(g.cols()),
+  m_open(boardMask(g.rows(), g.cols()).without(misses)),
+  m_hits(hits & boardMask(g.rows(), g.cols())), m_nThreads(nThreads), m_all(0)
+{
+    if (m_nThreads <= 0)
+        m_nThreads = max(1, (int)thread::hardware_concurrency());
+
+    for (int s = 0; s < g.nShips(); s++)
+    {
+        int len = g.shipLength(s);
+        size_t i = find(m_lengths.begin(), m_lengths.end(), len) - m_lengths.begin();
+        if (i == m_lengths.size())
+        {
+            m_lengths.push_back(len);
+            m_totals.push_back(0);
+        }
+        m_totals[i]++;
+    }
+    m_place.resize(m_lengths.size());
+    uint64_t unit = 1;
+    for (size_t i = m_lengths.size(); i-- > 0; )
+    {
+        m_place[i] = unit;
+        m_all += m_totals[i] * unit;
+        unit *= m_totals[i] + 1;
+    }
+
+    // a partial layout picks at most one of its positions, or none, for
+    // each ship, which bounds every count
+    double bound = 1;
+    for (size_t i = 0; i < m_lengths.size(); i++)
+    {
+        int len = m_lengths[i];
+        double positions = max(m_cols - len + 1, 0) * m_rows;
+        if (len > 1)
+            positions += max(m_rows - len + 1, 0) * m_cols;
+        for (int k = 0; k < m_totals[i]; k++)
+            bound *= positions + 1;
+    }
+    m_small = (bound < 1e19);
+}
+
+template <class Count>
+Count LayoutCounter::count() const
+{
+    typedef vector<pair<CountState, Count>> StateList;
+    if (m_hits.intersects(boardMask(m_rows, m_cols).without(m_open)))
+        return Count(0);
+
+    StateList states;
+    states.push_back(make_pair(CountState{ Bitboard(), m_all }, Count(1)));
+
+    for (int r = 0; r < m_rows  &&  !states.empty(); r++)
+        for (int c = 0; c < m_cols  &&  !states.empty(); c++)
+        {
+            const int cell = Bitboard::index(r, c);
+            const Bitboard here = Bitboard::bit(cell);
+            const bool isHit = m_hits.testBit(cell);
+
+            // the ships that can start here, running right or down
+            vector<pair<int, Bitboard>> starts;     // (length class, cells)
+            for (size_t i = 0; i < m_lengths.size(); i++)
+            {
+                int len = m_lengths[i];
+                // a mask is only made for a position on the board
+                if (c + len <= m_cols)
+                {
+                    Bitboard h = shipMask(r, c, len, HORIZONTAL);
+                    if (m_open.contains(h))
+                        starts.push_back(make_pair((int)i, h));
+                }
+                // a length 1 ship looks the same both ways
+                if (len > 1  &&  r + len <= m_rows)
+                {
+                    Bitboard v = shipMask(r, c, len, VERTICAL);
+                    if (m_open.contains(v))
+                        starts.push_back(make_pair((int)i, v));
+                }
+            }
+
+            // each chunk of states is expanded on its own, and its
+            // successors sorted and merged, after which the chunks' lists
+            // are merged pairwise
+            const size_t chunk = max<size_t>(4096, states.size() / m_nThreads + 1);
+            const size_t nChunks = (states.size() + chunk - 1) / chunk;
+            vector<StateList> out(nChunks);
+            parallelFor(nChunks, m_nThreads, [&](int, size_t k) {
+                StateList& next = out[k];
+                size_t end = min(states.size(), (k + 1) * chunk);
+                for (size_t j = k * chunk; j < end; j++)
+                {
+                    const CountState& s = states[j].first;
+                    const Count& n = states[j].second;
+                    if (s.covered.testBit(cell))
+                    {
+                        next.push_back(make_pair(CountState{ s.covered.without(here), s.shipsLeft }, n));
+                        continue;
+                    }
+                    if (!isHit)
+                        next.push_back(states[j]);
+                    for (size_t m = 0; m < starts.size(); m++)
+                    {
+                        int i = starts[m].first;
+                        if ((s.shipsLeft / m_place[i]) % (m_totals[i] + 1) == 0)
+                            continue;
+                        if (starts[m].second.intersects(s.covered))
+                            continue;
+                        next.push_back(make_pair(CountState{ (s.covered | starts[m].second).without(here),
+                                                             s.shipsLeft - m_place[i] }, n));
+                    }
+                }
+                mergeRuns(next);
+            });
+            // each round halves the number of lists, merging the pairs of
+            // a round in parallel
+            for (size_t width = 1; width < nChunks; width *= 2)
+            {
+                size_t nPairs = (nChunks + 2 * width - 1) / (2 * width);
+                parallelFor(nPairs, m_nThreads, [&](int, size_t k) {
+                    size_t a = 2 * width * k;
+                    size_t b = a + width;
+                    if (b >= nChunks)
+                        return;
+                    StateList merged;
+                    mergeSorted(out[a], out[b], merged);
+                    out[a].swap(merged);
+                    StateList().swap(out[b]);
+                });
+            }
+            states.swap(out[0]);
+        }
+
+    Count total(0);
+    for (size_t j = 0; j < states.size(); j++)
+        if (states[j].first.shipsLeft == 0)
+            total += states[j].second;
+    return total;
+}
+
+void LayoutCounter::tellApart(BigCount& n) const
+{
+    for (size_t i = 0; i < m_totals.size(); i++)
+        for (int k = 2; k <= m_totals[i]; k++)
+            n *= k;
+}
+
+}  // end of anonymous namespace
+
+BigCount countLayouts(const Game& g, Bitboard misses, Bitboard hits, int nThreads)
+{
+    LayoutCounter counter(g, misses, hits, nThreads);
+    BigCount total = (counter.small() ? BigCount(counter.count<uint64_t>())
+                                      : counter.count<BigCount>());
+    counter.tellApart(total);
+    return total;
+}
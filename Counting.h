@@ -0,0 +1,46 @@
+#ifndef COUNTING_INCLUDED
+#define COUNTING_INCLUDED
+
+#include "Bitboard.h"
+#include <cstdint>
+#include <string>
+
+class Game;
+
+// An unsigned integer big enough to count the layouts of any fleet on a
+// board of at most MAXROWS x MAXCOLS cells (100 one-cell ships have 100!
+// layouts, about 2^525).
+class BigCount
+{
+public:
+    static const int LIMBS = 10;
+
+    BigCount(uint64_t n = 0);
+    bool isZero() const;
+    BigCount& operator+=(const BigCount& o);
+    BigCount& operator*=(uint32_t n);
+    bool operator==(const BigCount& o) const;
+    std::string toString() const;
+    double toDouble() const;
+private:
+    uint64_t m_limbs[LIMBS];        // least significant first
+};
+
+// The number of legal layouts of g's fleet: every ship placed, none
+// overlapping, none covering a miss, and every hit covered by some ship.
+// Ships are told apart, so swapping two ships of the same length gives a
+// different layout.
+//
+// This is a profile DP over the cells in row-major order.  A state is the
+// set of cells at or after the current one that are already covered by
+// ships started earlier, and how many ships of each length are still to be
+// placed; each cell is either covered already, left empty, or the start of
+// a ship running right or down.  Ships of equal length are counted as if
+// they were alike and the total is multiplied back up at the end.  The
+// states of each cell are expanded on nThreads threads (0 means one per
+// core), each thread merging its share of the next cell's states.  The
+// standard fleet on a 10x10 board takes a few seconds.
+BigCount countLayouts(const Game& g, Bitboard misses = Bitboard(),
+                      Bitboard hits = Bitboard(), int nThreads = 0);
+
+#endif // COUNTING_INCLUDED
@@ -0,0 +1,251 @@
+#include "Endgame.h"
+
+#include <algorithm>
+#include <chrono>
+
+using namespace std;
+
+static double nowMs()
+{
+    return chrono::duration<double, milli>(
+        chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+EndgameSolver::EndgameSolver(const PlacementTable& table, int maxLayouts,
+                             long long maxNodes, double budgetMs)
+: m_table(table), m_maxLayouts(maxLayouts), m_maxNodes(maxNodes), m_budgetMs(budgetMs),
+  m_failedAt(maxLayouts + 1), m_nodes(0), m_deadline(0), m_aborted(false)
+{}
+
+void EndgameSolver::reset()
+{
+    m_failedAt = m_maxLayouts + 1;
+}
+
+bool EndgameSolver::outOfTime()
+{
+    if (m_aborted)
+        return true;
+    if (++m_nodes > m_maxNodes)
+        m_aborted = true;
+    // the clock, if there is one, is only read every so often
+    else if (m_budgetMs > 0  &&  (m_nodes & 255) == 0  &&  nowMs() > m_deadline)
+        m_aborted = true;
+    return m_aborted;
+}
+
+bool EndgameSolver::enumerate(const vector<vector<Bitboard>>& candidates,
+                              const vector<int>& order, size_t depth, Bitboard used,
+                              Bitboard hits, vector<Bitboard>& current,
+                              vector<Bitboard>& layouts)
+{
+    if (outOfTime())
+        return false;
+    if (depth == order.size())
+    {
+        // every hit must belong to some ship
+        if (!used.contains(hits))
+            return true;
+        if ((int)(layouts.size() / order.size()) >= m_maxLayouts)
+            return false;
+        layouts.insert(layouts.end(), current.begin(), current.end());
+        return true;
+    }
+    
+    int s = order[depth];
+    const vector<Bitboard>& list = candidates[s];
+    for (size_t k = 0; k < list.size(); k++)
+    {
+        if (list[k].intersects(used))
+            continue;
+        current[s] = list[k];
+        if (!enumerate(candidates, order, depth + 1, used | list[k], hits, current, layouts))
+            return false;
+    }
+    return true;
+}
+
+bool EndgameSolver::consistentLayouts(const ShotKnowledge& k, vector<Bitboard>& layouts)
+{
+    int nShips = m_table.nShips();
+    Bitboard misses = k.shots.without(k.hits);
+    
+    // positions each ship could still have: a sunk ship lies on hits and
+    // covers the shot that sank it; any other ship avoids misses and is not
+    // hit everywhere
+    vector<vector<Bitboard>> candidates(nShips);
+    vector<int> sunkAt(nShips, -1);
+    for (size_t i = 0; i < k.sinks.size(); i++)
+        if (k.sinks[i].shipId >= 0  &&  k.sinks[i].shipId < nShips)
+            sunkAt[k.sinks[i].shipId] = Bitboard::index(k.sinks[i].p);
+    for (int s = 0; s < nShips; s++)
+    {
+        const vector<ShipPlacement>& list = m_table.placements(s);
+        for (size_t i = 0; i < list.size(); i++)
+        {
+            Bitboard mask = list[i].mask;
+            if (sunkAt[s] >= 0 ? (mask.testBit(sunkAt[s])  &&  k.hits.contains(mask))
+                               : (!mask.intersects(misses)  &&  !k.hits.contains(mask)))
+                candidates[s].push_back(mask);
+        }
+    }
+    
+    // try the most constrained ships first
+    vector<int> order(nShips);
+    for (int s = 0; s < nShips; s++)
+        order[s] = s;
+    sort(order.begin(), order.end(), [&candidates](int a, int b) {
+        return candidates[a].size() < candidates[b].size();
+    });
+    
+    layouts.clear();
+    vector<Bitboard> current(nShips);
+    return enumerate(candidates, order, 0, Bitboard(), k.hits, current, layouts);
+}
+
+double EndgameSolver::solve(const vector<int>& layouts, Bitboard shots, int& bestCell)
+{
+    int nShips = m_table.nShips();
+    bestCell = -1;
+    
+    // with one layout left, the ship cells not yet shot are all that remain
+    if (layouts.size() == 1)
+    {
+        Bitboard left = m_fleets[layouts[0]].without(shots);
+        bestCell = left.lowest();
+        return left.count();
+    }
+    
+    uint64_t key = shots.hash();
+    for (size_t i = 0; i < layouts.size(); i++)
+        key = (key ^ (uint64_t)layouts[i]) * 0x100000001B3ULL + 0x9E3779B97F4A7C15ULL;
+    unordered_map<uint64_t, Entry>::const_iterator it = m_memo.find(key);
+    if (it != m_memo.end()  &&  it->second.shots == shots  &&  it->second.layouts == layouts)
+    {
+        bestCell = it->second.cell;
+        return it->second.value;
+    }
+    if (outOfTime())
+        return 0;
+    
+    // how many layouts have a ship on each unshot cell, and the fewest
+    // shots any layout still needs
+    int hitCount[MAXROWS * MAXCOLS] = {};
+    int fewestLeft = MAXROWS * MAXCOLS;
+    for (size_t i = 0; i < layouts.size(); i++)
+    {
+        Bitboard left = m_fleets[layouts[i]].without(shots);
+        fewestLeft = min(fewestLeft, left.count());
+        while (!left.empty())
+            hitCount[left.popLowest()]++;
+    }
+    if (fewestLeft == 0)
+        return 0;
+    
+    // try the likeliest hits first, so good answers prune the rest early
+    vector<int> cells;
+    for (int i = 0; i < MAXROWS * MAXCOLS; i++)
+        if (hitCount[i] > 0)
+            cells.push_back(i);
+    sort(cells.begin(), cells.end(), [&hitCount](int a, int b) {
+        return hitCount[a] > hitCount[b];
+    });
+    
+    double best = 1e9;
+    double n = (double)layouts.size();
+    for (size_t ci = 0; ci < cells.size()  &&  !m_aborted; ci++)
+    {
+        int c = cells[ci];
+        Bitboard cell = Bitboard::bit(c);
+        Bitboard after = shots | cell;
+        
+        // every layout needs at least one shot per ship cell not yet shot,
+        // so there is no point searching a shot that cannot beat the best
+        double lowerBound = 1;
+        for (size_t i = 0; i < layouts.size(); i++)
+            lowerBound += m_fleets[layouts[i]].without(after).count() / n;
+        if (lowerBound >= best)
+            continue;
+        
+        // split the layouts by what the shot would reveal: a miss, a hit,
+        // or the sinking of a particular ship, and whether the game is over
+        vector<pair<int, int>> outcomes;
+        outcomes.reserve(layouts.size());
+        for (size_t i = 0; i < layouts.size(); i++)
+        {
+            int L = layouts[i];
+            int outcome = 0;
+            if (m_fleets[L].intersects(cell))
+            {
+                outcome = 1;
+                for (int s = 0; s < nShips; s++)
+                    if (m_ships[L * nShips + s].intersects(cell))
+                    {
+                        if (after.contains(m_ships[L * nShips + s]))
+                            outcome = 2 + 2 * s + (after.contains(m_fleets[L]) ? 1 : 0);
+                        break;
+                    }
+            }
+            outcomes.push_back(make_pair(outcome, L));
+        }
+        sort(outcomes.begin(), outcomes.end());
+        
+        double value = 1;
+        for (size_t i = 0; i < outcomes.size()  &&  value < best; )
+        {
+            size_t j = i;
+            vector<int> group;
+            while (j < outcomes.size()  &&  outcomes[j].first == outcomes[i].first)
+                group.push_back(outcomes[j++].second);
+            int ignored;
+            value += group.size() / n * solve(group, after, ignored);
+            i = j;
+        }
+        if (value < best)
+        {
+            best = value;
+            bestCell = c;
+        }
+    }
+    
+    if (!m_aborted)
+        m_memo[key] = Entry{ shots, layouts, best, bestCell };
+    return best;
+}
+
+bool EndgameSolver::bestShot(const ShotKnowledge& k, Point& shot, double* expectedShots)
+{
+    m_nodes = 0;
+    m_aborted = false;
+    m_deadline = nowMs() + m_budgetMs;
+    
+    vector<Bitboard> layouts;
+    if (!consistentLayouts(k, layouts)  ||  layouts.empty())
+        return false;
+    
+    int nShips = m_table.nShips();
+    int nLayouts = (int)(layouts.size() / nShips);
+    if (nLayouts >= m_failedAt)
+        return false;
+    m_ships.swap(layouts);
+    m_fleets.assign(nLayouts, Bitboard());
+    for (int L = 0; L < nLayouts; L++)
+        for (int s = 0; s < nShips; s++)
+            m_fleets[L] |= m_ships[L * nShips + s];
+    m_memo.clear();
+    
+    vector<int> all(nLayouts);
+    for (int L = 0; L < nLayouts; L++)
+        all[L] = L;
+    int cell;
+    double value = solve(all, k.shots, cell);
+    if (m_aborted)
+        m_failedAt = nLayouts / 2;
+    if (m_aborted  ||  cell < 0)
+        return false;
+    
+    shot = Bitboard::point(cell);
+    if (expectedShots != nullptr)
+        *expectedShots = value;
+    return true;
+}
@@ -0,0 +1,87 @@
+#ifndef ENDGAME_INCLUDED
+#define ENDGAME_INCLUDED
+
+#include "Placement.h"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// What an attacker knows about the opponent's board
+struct ShotKnowledge
+{
+    struct Sink
+    {
+        int shipId;
+        Point p;                // the shot that sank it
+    };
+
+    Bitboard shots;             // cells attacked so far
+    Bitboard hits;              // cells attacked that held a ship
+    std::vector<Sink> sinks;
+};
+
+// Exact endgame play.
+//
+// Once few fleet layouts are consistent with what an attacker knows,
+// bestShot enumerates them and searches every sequence of shots and
+// outcomes for the shot that minimizes the expected number of shots still
+// needed to sink everything, assuming every consistent layout is equally
+// likely.  Knowledge states reached by different shot orders are solved
+// once, through a transposition table keyed on the shots taken and the
+// layouts still possible.
+//
+// If there are more than maxLayouts consistent layouts, or the search would
+// visit more than maxNodes nodes, bestShot gives up and the caller should
+// fall back on its usual strategy.  Counting nodes rather than time keeps
+// seeded games the same from run to run; a budgetMs above 0 also stops the
+// search after that many milliseconds, for callers that care more about a
+// deadline than about reproducing games.  After running out of budget it
+// does not search again until half as many layouts remain, so a game wastes
+// only a few budgets; call reset at the start of each game.
+class EndgameSolver
+{
+public:
+    EndgameSolver(const PlacementTable& table, int maxLayouts = 200,
+                  long long maxNodes = 50000, double budgetMs = 0);
+    void reset();
+
+    bool bestShot(const ShotKnowledge& k, Point& shot, double* expectedShots = nullptr);
+
+    // The layouts (one mask per ship) consistent with k, or false if there
+    // are more than maxLayouts of them
+    bool consistentLayouts(const ShotKnowledge& k, std::vector<Bitboard>& layouts);
+
+private:
+    // the state is kept beside its answer, since the map is keyed by a
+    // hash of it and two states may share one
+    struct Entry
+    {
+        Bitboard shots;
+        std::vector<int> layouts;
+        double value;
+        int cell;
+    };
+
+    bool enumerate(const std::vector<std::vector<Bitboard>>& candidates,
+                   const std::vector<int>& order, size_t depth, Bitboard used,
+                   Bitboard hits, std::vector<Bitboard>& current,
+                   std::vector<Bitboard>& layouts);
+    double solve(const std::vector<int>& layouts, Bitboard shots, int& bestCell);
+    bool outOfTime();
+
+    const PlacementTable& m_table;
+    int m_maxLayouts;
+    long long m_maxNodes;
+    double m_budgetMs;
+
+    // the layouts being searched: ship masks, and the union of each layout
+    std::vector<Bitboard> m_ships;
+    std::vector<Bitboard> m_fleets;
+    std::unordered_map<uint64_t, Entry> m_memo;   // the transposition table
+    int m_failedAt;             // number of layouts that last ran out of budget
+    long long m_nodes;
+    double m_deadline;
+    bool m_aborted;
+};
+
+#endif // ENDGAME_INCLUDED
@@ -0,0 +1,187 @@
+#include "ExternalBot.h"
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <vector>
+#include <cerrno>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+using namespace std;
+
+// a line longer than this is not a reply to anything we asked
+const size_t MAX_REPLY = 4096;
+
+BotProcess::BotProcess(string path)
+: m_path(path), m_fd(-1), m_pid(-1), m_ok(false)
+{
+    // a socket pair rather than two pipes: one descriptor each way, and
+    // writes to a bot that has died fail instead of raising SIGPIPE
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0)
+        return;
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], 0);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], 1);
+    char* argv[] = { const_cast<char*>(m_path.c_str()), nullptr };
+    int err = posix_spawn(&m_pid, m_path.c_str(), &actions, nullptr, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(fds[1]);
+    if (err != 0)
+    {
+        close(fds[0]);
+        m_pid = -1;
+        return;
+    }
+    m_fd = fds[0];
+    m_ok = true;
+}
+
+BotProcess::~BotProcess()
+{
+    if (m_fd >= 0)
+        close(m_fd);
+    if (m_pid > 0)
+    {
+        // a bot that ignores the end of its input is not waited for long
+        for (int tries = 0; tries < 100; tries++)
+        {
+            if (waitpid(m_pid, nullptr, WNOHANG) != 0)
+                return;
+            usleep(1000);
+        }
+        kill(m_pid, SIGKILL);
+        waitpid(m_pid, nullptr, 0);
+    }
+}
+
+void BotProcess::send(const string& line)
+{
+    m_out += line;
+    m_out += '\n';
+}
+
+bool BotProcess::flush()
+{
+    size_t done = 0;
+    while (done < m_out.size())
+    {
+        ssize_t n = ::send(m_fd, m_out.data() + done, m_out.size() - done, MSG_NOSIGNAL);
+        if (n < 0  &&  errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        done += n;
+    }
+    m_out.clear();
+    return true;
+}
+
+bool BotProcess::request(const string& line, string& reply, int timeoutMs)
+{
+    if (!m_ok)
+        return false;
+    send(line);
+    if (!flush())
+    {
+        m_ok = false;
+        return false;
+    }
+
+    auto deadline = chrono::steady_clock::now() + chrono::milliseconds(timeoutMs);
+    for (;;)
+    {
+        size_t end = m_in.find('\n');
+        if (end != string::npos)
+        {
+            reply = m_in.substr(0, end);
+            if (!reply.empty()  &&  reply.back() == '\r')
+                reply.pop_back();
+            m_in.erase(0, end + 1);
+            return true;
+        }
+        if (m_in.size() > MAX_REPLY)
+            break;
+
+        int left = (int)chrono::duration_cast<chrono::milliseconds>(
+                       deadline - chrono::steady_clock::now()).count();
+        if (left <= 0)
+            break;
+        pollfd pfd = { m_fd, POLLIN, 0 };
+        int ready = poll(&pfd, 1, left);
+        if (ready < 0  &&  errno == EINTR)
+            continue;
+        if (ready <= 0)
+            break;
+        char buf[512];
+        ssize_t n = read(m_fd, buf, sizeof(buf));
+        if (n < 0  &&  errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        m_in.append(buf, n);
+    }
+    m_ok = false;
+    return false;
+}
+
+//*********************************************************************
+//  The pool of idle bots
+//*********************************************************************
+
+static mutex& poolMutex()
+{
+    static mutex m;
+    return m;
+}
+
+static map<string, vector<unique_ptr<BotProcess>>>& pool()
+{
+    static map<string, vector<unique_ptr<BotProcess>>> bots;
+    return bots;
+}
+
+unique_ptr<BotProcess> BotProcess::acquire(string path)
+{
+    {
+        lock_guard<mutex> lock(poolMutex());
+        vector<unique_ptr<BotProcess>>& idle = pool()[path];
+        if (!idle.empty())
+        {
+            unique_ptr<BotProcess> bot = move(idle.back());
+            idle.pop_back();
+            return bot;
+        }
+    }
+    return unique_ptr<BotProcess>(new BotProcess(path));
+}
+
+void BotProcess::release(unique_ptr<BotProcess> bot)
+{
+    if (bot == nullptr  ||  !bot->ok())
+        return;
+    // anything queued belongs to the game that just ended
+    bot->m_out.clear();
+    bot->m_in.clear();
+    lock_guard<mutex> lock(poolMutex());
+    pool()[bot->path()].push_back(move(bot));
+}
+
+void BotProcess::forgetPool()
+{
+    // closing our copy of each socket leaves the parent's open, and the
+    // bots are not our children to wait for or kill
+    for (auto& entry : pool())
+        for (unique_ptr<BotProcess>& bot : entry.second)
+            bot->m_pid = -1;
+    pool().clear();
+}
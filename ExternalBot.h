@@ -0,0 +1,74 @@
+#ifndef EXTERNALBOT_INCLUDED
+#define EXTERNALBOT_INCLUDED
+
+#include <memory>
+#include <string>
+#include <sys/types.h>
+
+// A bot running as a separate program, which a Player can talk to over its
+// standard input and output, so engines built with other toolchains can
+// play in our games and tournaments.
+//
+// The protocol is one line per message.  To the bot:
+//
+//     game R C N len1 ... lenN    a new game on an RxC board with N ships
+//     place                       reply with the fleet's positions
+//     attack                      reply with the cell to attack
+//     result r c V H D id         the bot's attack at (r,c): valid, hit and
+//                                 destroyed as 0 or 1, and the id of the
+//                                 ship destroyed or -1
+//     opponent r c                the opponent attacked (r,c)
+//
+// and from the bot, one line for each place or attack:
+//
+//     r1 c1 d1 ... rN cN dN       each ship's top or left cell, d being h
+//                                 (horizontal) or v (vertical)
+//     r c                         the cell to attack
+//
+// Messages that need no reply are queued and written together with the
+// next one that does, so each move costs one write and one read.  A bot
+// serves one game after another, so tournaments keep a pool of running
+// bots rather than starting a process per game; a bot exits when its
+// input is closed.
+class BotProcess
+{
+public:
+    // Start the program at path; ok() is false if it could not be started
+    BotProcess(std::string path);
+    // Close the bot's input and wait for it to exit
+    ~BotProcess();
+    bool ok() const { return m_ok; }
+    const std::string& path() const { return m_path; }
+
+    // Queue a message that needs no reply
+    void send(const std::string& line);
+
+    // Write every queued message and this one, and read the reply, waiting
+    // at most timeoutMs.  On failure (the bot exited, timed out or sent
+    // something other than a line) the bot is no longer ok.
+    bool request(const std::string& line, std::string& reply, int timeoutMs = 5000);
+
+    // A running bot for the program at path, from the pool if there is one
+    static std::unique_ptr<BotProcess> acquire(std::string path);
+    // Put a bot that is still ok back in the pool
+    static void release(std::unique_ptr<BotProcess> bot);
+    // Empty the pool in a process just forked, whose idle bots are the
+    // parent's, without stopping them or touching the parent's sockets.
+    // Call it before any other thread starts in the new process.
+    static void forgetPool();
+
+    BotProcess(const BotProcess&) = delete;
+    BotProcess& operator=(const BotProcess&) = delete;
+
+private:
+    bool flush();
+
+    std::string m_path;
+    int m_fd;               // our end of the socket pair
+    pid_t m_pid;
+    bool m_ok;
+    std::string m_out;      // queued messages
+    std::string m_in;       // what has been read past the last reply
+};
+
+#endif // EXTERNALBOT_INCLUDED
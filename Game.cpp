@@ -1,9 +1,18 @@
 #include "Game.h"
 #include "Board.h"
 #include "Player.h"
+#include "Heatmap.h"
+#include "Placement.h"
+#include "Trace.h"
+#include "Tuning.h"
 
 #include <iostream>
 #include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
 #include <cstdlib>
 #include <cctype>
 #include <vector>
@@ -25,6 +34,29 @@ private:
     string m_name;
 };
 
+// The thread that chooses the second player's shots in simultaneous
+// turns, started once per game rather than once per turn.  It plays with
+// the tuning of the thread that started it, and with a generator seeded
+// from that thread's, so seedRandom still makes the game reproducible.
+class TurnHelper
+{
+public:
+    TurnHelper();
+    ~TurnHelper();
+    void start(function<void()> job);   // run job on the helper thread
+    void wait();                        // until that job is done
+    
+private:
+    void run(TuningConfig config, unsigned seed);
+    
+    mutex m_mutex;
+    condition_variable m_cv;
+    function<void()> m_job;
+    bool m_busy = false;    // a job is waiting or running
+    bool m_quit = false;
+    thread m_thread;        // last, so it starts after the rest is ready
+};
+
 class GameImpl
 {
 public:
@@ -38,9 +70,15 @@ public:
     int shipLength(int shipId) const;
     char shipSymbol(int shipId) const;
     string shipName(int shipId) const;
-    Player* play(Player* p1, Player* p2, Board& b1, Board& b2, bool shouldPause);
+    Player* play(Player* p1, Player* p2, Board& b1, Board& b2, bool shouldPause, int shotsPerTurn,
+                 bool simultaneous, bool* drawn);
     
 private:
+    bool salvoTurn(Player* attacker, Player* defender, Board& target, int shotsPerTurn, bool shouldPause);
+    bool simultaneousTurn(Player* p1, Player* p2, Board& b1, Board& b2, int shotsPerTurn, bool shouldPause,
+                          bool heat, int heat1, int heat2, TurnHelper* helper);
+    void reportSalvo(Player* attacker, Board& target, const vector<ShotResult>& results, bool shotsOnly);
+    
     int m_rows;
     int m_cols;
     int m_nShips;
@@ -74,6 +112,57 @@ string Ship::name() const {
     return m_name;
 }
 
+/////////////////////////////////////////////////////////////////////////
+// TurnHelper Functions
+TurnHelper::TurnHelper()
+: m_thread(&TurnHelper::run, this, currentTuning(), (unsigned)randomGenerator()())
+{}
+
+TurnHelper::~TurnHelper()
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_cv.notify_all();
+    m_thread.join();
+}
+
+void TurnHelper::start(function<void()> job)
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_job = move(job);
+        m_busy = true;
+    }
+    m_cv.notify_all();
+}
+
+void TurnHelper::wait()
+{
+    unique_lock<mutex> lock(m_mutex);
+    m_cv.wait(lock, [this]() { return !m_busy; });
+}
+
+void TurnHelper::run(TuningConfig config, unsigned seed)
+{
+    setTuning(config);
+    seedRandom(seed);
+    unique_lock<mutex> lock(m_mutex);
+    for (;;){
+        m_cv.wait(lock, [this]() { return m_busy || m_quit; });
+        if (!m_busy){
+            return;
+        }
+        function<void()> job = move(m_job);
+        lock.unlock();
+        job();
+        lock.lock();
+        m_busy = false;
+        m_cv.notify_all();
+    }
+}
+
 /////////////////////////////////////////////////////////////////////////
 // GameImpl Functions
 GameImpl::GameImpl(int nRows, int nCols)
@@ -133,9 +222,119 @@ string GameImpl::shipName(int shipId) const
     return shipcollection[shipId].name();
 }
 
+// attacker fires a salvo of shotsPerTurn shots at defender's board, target;
+// returns true if that destroyed defender's last ship
+bool GameImpl::salvoTurn(Player* attacker, Player* defender, Board& target, int shotsPerTurn, bool shouldPause)
+{
+    // if attacker is human, do not display undamaged segments
+    bool shotsOnly = attacker->isHuman();
+    
+    cout << attacker->name() << "'s turn. Board for " << defender->name() << ": " << endl;
+    TRACE_CALL("display", target.display(shotsOnly));
+    
+    vector<Point> shots = TRACE_CALL("recommendAttacks", attacker->recommendAttacks(shotsPerTurn));
+    
+    // the whole salvo lands at once
+    vector<ShotResult> results;
+    TRACE_CALL("attack", target.attack(shots, results));
+    reportSalvo(attacker, target, results, shotsOnly);
+    
+    if (shouldPause){
+        waitForEnter();
+    }
+    
+    // opponent needs to know where the salvo landed on his/her board
+    defender->recordAttacksByOpponent(shots);
+    
+    // attacker needs to know the results of the whole salvo
+    TRACE_CALL("recordAttackResults", attacker->recordAttackResults(results));
+    
+    return TRACE_CALL("allShipsDestroyed", target.allShipsDestroyed());
+}
+
+// p1 and p2 choose their shots at the same time, p2 on the helper thread
+// (there is none when a player is human), and then both salvos land;
+// returns true if either fleet was destroyed
+bool GameImpl::simultaneousTurn(Player* p1, Player* p2, Board& b1, Board& b2, int shotsPerTurn, bool shouldPause,
+                                bool heat, int heat1, int heat2, TurnHelper* helper)
+{
+    cout << p1->name() << " and " << p2->name() << " fire at the same time." << endl;
+    
+    vector<Point> shots1;
+    vector<Point> shots2;
+    
+    // a human is asked in turn, so two of them don't share the keyboard
+    if (helper == nullptr){
+        shots1 = TRACE_CALL("recommendAttacks", p1->recommendAttacks(shotsPerTurn));
+        shots2 = TRACE_CALL("recommendAttacks", p2->recommendAttacks(shotsPerTurn));
+    }
+    else {
+        helper->start([&]() {
+            shots2 = TRACE_CALL("recommendAttacks", p2->recommendAttacks(shotsPerTurn));
+        });
+        shots1 = TRACE_CALL("recommendAttacks", p1->recommendAttacks(shotsPerTurn));
+        helper->wait();
+    }
+    
+    vector<ShotResult> results1;
+    vector<ShotResult> results2;
+    if (heat){
+        setHeatmapChannel(heat1);
+    }
+    TRACE_CALL("attack", b2.attack(shots1, results1));
+    if (heat){
+        setHeatmapChannel(heat2);
+    }
+    TRACE_CALL("attack", b1.attack(shots2, results2));
+    
+    reportSalvo(p1, b2, results1, p1->isHuman());
+    reportSalvo(p2, b1, results2, p2->isHuman());
+    
+    if (shouldPause){
+        waitForEnter();
+    }
+    
+    // each needs to know where the other's shots landed, and what its own did
+    p2->recordAttacksByOpponent(shots1);
+    p1->recordAttacksByOpponent(shots2);
+    TRACE_CALL("recordAttackResults", p1->recordAttackResults(results1));
+    TRACE_CALL("recordAttackResults", p2->recordAttackResults(results2));
+    
+    return TRACE_CALL("allShipsDestroyed", b1.allShipsDestroyed()) || TRACE_CALL("allShipsDestroyed", b2.allShipsDestroyed());
+}
+
+// say what each shot of attacker's salvo did, and show target afterwards
+void GameImpl::reportSalvo(Player* attacker, Board& target, const vector<ShotResult>& results, bool shotsOnly)
+{
+    for (size_t i = 0; i < results.size(); i++){
+        const ShotResult& r = results[i];
+        if (!r.validShot){
+            cout << attacker->name() << " wasted a shot at (" << r.p.r << ", " << r.p.c << ")." << endl;
+        }
+        else if (r.shipDestroyed){
+            cout << attacker->name() << " attacked (" << r.p.r << "," << r.p.c << ") and destroyed the " << shipName(r.shipId) << endl;
+        }
+        else if (r.shotHit){
+            cout << attacker->name() << " attacked (" << r.p.r << "," << r.p.c << ") and hit something" << endl;
+        }
+        else {
+            cout << attacker->name() << " attacked (" << r.p.r << "," << r.p.c << ") and missed" << endl;
+        }
+    }
+    cout << "resulting in: " << endl;
+    TRACE_CALL("display", target.display(shotsOnly));
+}
+
 // shouldPause defaults to true if not included
-Player* GameImpl::play(Player* p1, Player* p2, Board& b1, Board& b2, bool shouldPause)
+Player* GameImpl::play(Player* p1, Player* p2, Board& b1, Board& b2, bool shouldPause, int shotsPerTurn,
+                       bool simultaneous, bool* drawn)
 {
+    TRACE_SPAN("play");
+    
+    if (drawn != nullptr){
+        *drawn = false;
+    }
+    
     // p1 will have b1
     // p2 will have b2
     
@@ -147,16 +346,29 @@ Player* GameImpl::play(Player* p1, Player* p2, Board& b1, Board& b2, bool should
      * if ships could not be placed on the board before the game began (placeShips from player class)
      */
     
-    if (!(p1->placeShips(b1))){
+    // while heatmaps are on, count each player's placements and shots under its name
+    bool heat = heatmapsEnabled();
+    int heat1 = heat ? heatmapChannel(p1->name()) : 0;
+    int heat2 = heat ? heatmapChannel(p2->name()) : 0;
+    
+    if (heat){
+        setHeatmapChannel(heat1);
+    }
+    
+    if (!(TRACE_CALL("placeShips", p1->placeShips(b1)))){
         // cout << endl << "b1: " << endl;
-        b1.display(false);
+        TRACE_CALL("display", b1.display(false));
         cout << "ERROR: Ships cannot be placed for P1, Game cannot start" << endl;
         return nullptr;
     }
     
-    if (!(p2->placeShips(b2))){
+    if (heat){
+        setHeatmapChannel(heat2);
+    }
+    
+    if (!(TRACE_CALL("placeShips", p2->placeShips(b2)))){
         // cout << endl << "b2: " << endl;
-        b2.display(false);
+        TRACE_CALL("display", b2.display(false));
         cout << "ERROR: Ships cannot be placed for P2, Game cannot start" << endl;
         return nullptr;
     }
@@ -174,22 +386,52 @@ Player* GameImpl::play(Player* p1, Player* p2, Board& b1, Board& b2, bool should
     int id = -1;
     Point P;
     
+    // simultaneous rules: both players fire each turn, both choosing their
+    // shots before either learns what the other's did
+    unique_ptr<TurnHelper> helper;
+    if (simultaneous && !p1->isHuman() && !p2->isHuman()){
+        helper.reset(new TurnHelper);
+    }
+    while (simultaneous && !TRACE_CALL("allShipsDestroyed", b1.allShipsDestroyed()) && !TRACE_CALL("allShipsDestroyed", b2.allShipsDestroyed())) {
+        simultaneousTurn(p1, p2, b1, b2, shotsPerTurn, shouldPause, heat, heat1, heat2, helper.get());
+    }
+    helper.reset();
+    
+    // salvo rules: turns of shotsPerTurn shots until someone wins; either
+    // loop leaves nothing for the one-shot loop below to do
+    while (shotsPerTurn > 1 && !TRACE_CALL("allShipsDestroyed", b1.allShipsDestroyed()) && !TRACE_CALL("allShipsDestroyed", b2.allShipsDestroyed())) {
+        if (heat){
+            setHeatmapChannel(heat1);
+        }
+        if (salvoTurn(p1, p2, b2, shotsPerTurn, shouldPause)){
+            break;
+        }
+        if (heat){
+            setHeatmapChannel(heat2);
+        }
+        salvoTurn(p2, p1, b1, shotsPerTurn, shouldPause);
+    }
+    
     // loop until someone wins (i.e., have no more ships)
     // while(p1->game().nShips() != 0 || p2->game().nShips() != 0){
-    while(!b1.allShipsDestroyed() && !b2.allShipsDestroyed()) {
+    while(!TRACE_CALL("allShipsDestroyed", b1.allShipsDestroyed()) && !TRACE_CALL("allShipsDestroyed", b2.allShipsDestroyed())) {
+        
+        if (heat){
+            setHeatmapChannel(heat1);
+        }
         
         // P1 = HUMAN
         // if p1 is human, do not display undamaged segments
         if (p1->isHuman()){
             
             cout << p1->name() << "'s turn. Board for " << p2->name() << ": " << endl;
-            b2.display(true);  // displaying p2's board
+            TRACE_CALL("display", b2.display(true));  // displaying p2's board
             
-            P = p1->recommendAttack();
+            P = TRACE_CALL("recommendAttack", p1->recommendAttack());
             
             // p1 attack p2
             // will say if attack is successful or not (i.e. if attack point is outside the board or attack is made on a previously attacked location)
-            if (b2.attack(P, hit, destroy, id)){
+            if (TRACE_CALL("attack", b2.attack(P, hit, destroy, id))){
                 if (!hit){
                     cout << p1->name() << " attacked (" << P.r << "," << P.c << ") and missed, resulting in: " << endl;
                 }
@@ -203,7 +445,7 @@ Player* GameImpl::play(Player* p1, Player* p2, Board& b1, Board& b2, bool should
                 }
                 // if attack was successfully made...
                 shot = true;
-                b2.display(true);  // displaying resulting attack
+                TRACE_CALL("display", b2.display(true));  // displaying resulting attack
             }
             
             else {
@@ -218,20 +460,20 @@ Player* GameImpl::play(Player* p1, Player* p2, Board& b1, Board& b2, bool should
             }
             
             // attacker needs to know the results of his/her attack
-            p1->recordAttackResult(P, shot, hit, destroy, id);
+            TRACE_CALL("recordAttackResult", p1->recordAttackResult(P, shot, hit, destroy, id));
             
         } // end of if Human
         
         // P1 != HUMAN
         if (!p1->isHuman()){
             cout << p1->name() << "'s turn. Board for " << p2->name() << ": " << endl;
-            b2.display(false);  // displaying p2's board
+            TRACE_CALL("display", b2.display(false));  // displaying p2's board
             
-            P = p1->recommendAttack();
+            P = TRACE_CALL("recommendAttack", p1->recommendAttack());
             
             // p1 attack p2
             // will say if attack is successful or not (i.e. if attack point is outside the board or attack is made on a previously attacked location)
-            if (b2.attack(P, hit, destroy, id)){
+            if (TRACE_CALL("attack", b2.attack(P, hit, destroy, id))){
                 if (!hit){
                     cout << p1->name() << " attacked (" << P.r << "," << P.c << ") and missed, resulting in: " << endl;
                 }
@@ -244,7 +486,7 @@ Player* GameImpl::play(Player* p1, Player* p2, Board& b1, Board& b2, bool should
                     cout << p1->name() << " attacked (" << P.r << "," << P.c << ") and hit something, resulting in: " << endl;
                 }
                 shot = true;
-                b2.display(false);  // displaying resulting attack
+                TRACE_CALL("display", b2.display(false));  // displaying resulting attack
             }
             else {
                 shot = false;
@@ -261,25 +503,29 @@ Player* GameImpl::play(Player* p1, Player* p2, Board& b1, Board& b2, bool should
             p2->recordAttackByOpponent(P);
             
             // attacker needs to know the results of his/her attack
-            p1->recordAttackResult(P, shot, hit, destroy, id);
+            TRACE_CALL("recordAttackResult", p1->recordAttackResult(P, shot, hit, destroy, id));
         }
         
-        if (b2.allShipsDestroyed()){
+        if (TRACE_CALL("allShipsDestroyed", b2.allShipsDestroyed())){
             break;
         };
         
         /////////////////////////////////////////////////////////////////////////
+        if (heat){
+            setHeatmapChannel(heat2);
+        }
+        
         // P2 = HUMAN
         if (p2->isHuman()){
             
             cout << p2->name() << "'s turn. Board for " << p1->name() << ": " << endl;
-            b1.display(true);  // displaying p1's board
+            TRACE_CALL("display", b1.display(true));  // displaying p1's board
             
-            P = p2->recommendAttack();
+            P = TRACE_CALL("recommendAttack", p2->recommendAttack());
             
             // p2 attack p1
             // will say if attack is successful or not (i.e. if attack point is outside the board or attack is made on a previously attacked location)
-            if (b1.attack(P, hit, destroy, id)){
+            if (TRACE_CALL("attack", b1.attack(P, hit, destroy, id))){
                 if (!hit){
                     cout << p2->name() << " attacked (" << P.r << "," << P.c << ") and missed, resulting in: " << endl;
                 }
@@ -290,7 +536,7 @@ Player* GameImpl::play(Player* p1, Player* p2, Board& b1, Board& b2, bool should
                     cout << p2->name() << " attacked (" << P.r << "," << P.c << ") and hit something, resulting in: " << endl;
                 }
                 shot = true;
-                b1.display(true);  // displaying resulting attack
+                TRACE_CALL("display", b1.display(true));  // displaying resulting attack
             }
             else {
                 shot = false;
@@ -307,7 +553,7 @@ Player* GameImpl::play(Player* p1, Player* p2, Board& b1, Board& b2, bool should
             p1->recordAttackByOpponent(P);
             
             // attacker needs to know the results of his/her attack
-            p2->recordAttackResult(P, shot, hit, destroy, id);
+            TRACE_CALL("recordAttackResult", p2->recordAttackResult(P, shot, hit, destroy, id));
             
         }
         
@@ -315,13 +561,13 @@ Player* GameImpl::play(Player* p1, Player* p2, Board& b1, Board& b2, bool should
         if (!p2->isHuman()){
             
             cout << p2->name() << "'s turn. Board for " << p1->name() << ": " << endl;
-            b1.display(false);  // displaying p1's board
+            TRACE_CALL("display", b1.display(false));  // displaying p1's board
             
-            P = p2->recommendAttack();
+            P = TRACE_CALL("recommendAttack", p2->recommendAttack());
             
             // p2 attack p1
             // will say if attack is successful or not (i.e. if attack point is outside the board or attack is made on a previously attacked location)
-            if (b1.attack(P, hit, destroy, id)){
+            if (TRACE_CALL("attack", b1.attack(P, hit, destroy, id))){
                 if (!hit){
                     cout << p2->name() << " attacked (" << P.r << "," << P.c << ") and missed, resulting in: " << endl;
                 }
@@ -332,7 +578,7 @@ Player* GameImpl::play(Player* p1, Player* p2, Board& b1, Board& b2, bool should
                     cout << p2->name() << " attacked (" << P.r << "," << P.c << ") and hit something, resulting in: " << endl;
                 }
                 shot = true;
-                b1.display(false);  // displaying resulting attack
+                TRACE_CALL("display", b1.display(false));  // displaying resulting attack
             }
             else {
                 shot = false;
@@ -349,29 +595,38 @@ Player* GameImpl::play(Player* p1, Player* p2, Board& b1, Board& b2, bool should
             p1->recordAttackByOpponent(P);
            
             // attacker needs to know the results of his/her attack
-            p2->recordAttackResult(P, shot, hit, destroy, id);
+            TRACE_CALL("recordAttackResult", p2->recordAttackResult(P, shot, hit, destroy, id));
         }
         
         
     } // end of while
     
+    // both fleets went down in the same simultaneous turn
+    if (TRACE_CALL("allShipsDestroyed", b1.allShipsDestroyed()) && TRACE_CALL("allShipsDestroyed", b2.allShipsDestroyed())){
+        cout << "Both fleets are destroyed: a draw!" << endl;
+        if (drawn != nullptr){
+            *drawn = true;
+        }
+        return nullptr;
+    }
+    
     // p1 is the winner
-    if (b2.allShipsDestroyed()){
+    if (TRACE_CALL("allShipsDestroyed", b2.allShipsDestroyed())){
         cout << p1->name() << " wins!" << endl;
         
         if (p2->isHuman()){
-            b2.display(false);
+            TRACE_CALL("display", b2.display(false));
         }
         
         return p1;
     }
     
     // p2 is the winner
-    if (b1.allShipsDestroyed()){
+    if (TRACE_CALL("allShipsDestroyed", b1.allShipsDestroyed())){
         cout << p2->name() << " wins!" << endl;
         
         if (p1->isHuman()){
-            b1.display(false);
+            TRACE_CALL("display", b1.display(false));
         }
         
         return p2;
@@ -455,10 +710,10 @@ bool Game::addShip(int length, char symbol, string name)
         << endl;
         return false;
     }
-    int totalOfLengths = 0;
+    vector<int> lengths;
     for (int s = 0; s < nShips(); s++)
     {
-        totalOfLengths += shipLength(s);
+        lengths.push_back(shipLength(s));
         if (shipSymbol(s) == symbol)
         {
             cout << "Ship symbol " << symbol
@@ -466,7 +721,11 @@ bool Game::addShip(int length, char symbol, string name)
             return false;
         }
     }
-    if (totalOfLengths + length > rows() * cols())
+    // the ships' total length is not enough: three 3x1 ships cover 9 of
+    // the 10 cells of a 2x5 board, but each row holds only one of them, so
+    // make sure some layout exists
+    lengths.push_back(length);
+    if (!fleetFits(rows(), cols(), lengths))
     {
         cout << "Board is too small to fit all ships" << endl;
         return false;
@@ -497,17 +756,21 @@ string Game::shipName(int shipId) const
     return m_impl->shipName(shipId);
 }
 
-Player* Game::play(Player* p1, Player* p2, bool shouldPause)
+Player* Game::play(Player* p1, Player* p2, bool shouldPause, int shotsPerTurn, bool simultaneous,
+                   bool* drawn)
 {
     // if either player is invalid or ships have not been placed yet
     if (p1 == nullptr  ||  p2 == nullptr  ||  nShips() == 0){
         cout << "NONE";
+        if (drawn != nullptr){
+            *drawn = false;
+        }
         return nullptr;
     }
     // creates 2 board objects
     Board b1(*this);
     Board b2(*this);
     
-    return m_impl->play(p1, p2, b1, b2, shouldPause);
+    return m_impl->play(p1, p2, b1, b2, shouldPause, shotsPerTurn, simultaneous, drawn);
 }
 
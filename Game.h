@@ -22,7 +22,17 @@ public:
     int shipLength(int shipId) const;
     char shipSymbol(int shipId) const;
     std::string shipName(int shipId) const;
-    Player* play(Player* p1, Player* p2, bool shouldPause = true);
+    
+    // With shotsPerTurn above 1 the game is played by the salvo rules:
+    // each turn the player fires that many shots at once and only then
+    // learns what they did.  With simultaneous, both players fire in every
+    // turn, choosing their shots at the same time on separate threads
+    // (unless one is human), so two slow players take about half as long;
+    // if both fleets go down in the same turn the game is a draw.  play
+    // returns the winner, or nullptr for a draw or a game that could not
+    // be played; *drawn, if given, says which of those two it was.
+    Player* play(Player* p1, Player* p2, bool shouldPause = true, int shotsPerTurn = 1,
+                 bool simultaneous = false, bool* drawn = nullptr);
     
     // We prevent a Game object from being copied or assigned
     Game(const Game&) = delete;
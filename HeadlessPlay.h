@@ -0,0 +1,154 @@
+#ifndef HEADLESSPLAY_INCLUDED
+#define HEADLESSPLAY_INCLUDED
+
+#include "Game.h"
+#include "Board.h"
+#include "globals.h"
+#include "Heatmap.h"
+#include "Trace.h"
+#include "PerfCounters.h"
+#include <string>
+#include <vector>
+
+class Player;
+
+// What happened in one headless game.  Index 0 is the player who moved first.
+struct GameRecord
+{
+    int winner = -1;        // 0 or 1, or -1 if nobody won
+    int shots[2] = { 0, 0 };
+    int hits[2] = { 0, 0 };
+};
+
+// One attack, as reported to the attacker by recordAttackResult
+struct ShotRecord
+{
+    int player;             // 0 for the player who moved first, 1 otherwise
+    Point p;
+    bool validShot;
+    bool shotHit;
+    bool shipDestroyed;
+    int shipId;             // -1 unless shipDestroyed
+};
+
+// Something that follows a headless game as it is played, such as a
+// spectator display.  The boards are only valid during each call.
+class GameObserver
+{
+public:
+    virtual ~GameObserver() {}
+    // both fleets are in place; b1 belongs to the player who moves first
+    virtual void gameStarted(const std::string& name1, const Board& b1,
+                             const std::string& name2, const Board& b2) = 0;
+    // an attack was made on target
+    virtual void shotFired(const ShotRecord& shot, const Board& target) = 0;
+    virtual void gameEnded(const GameRecord& rec) = 0;
+};
+
+// Play one game between two computer players without displaying anything,
+// following the same rules as Game::play.  If log is not null, every
+// attack is appended to it, and if observer is not null, it is told of
+// the start, every attack and the end.  While heatmaps are enabled, each player's
+// placements and shots are counted under the player's name, and while this
+// thread has region counters (PerfCounters.h), the calls are counted too.
+//
+// P1 and P2 may be Player, in which case every strategy call goes through
+// the virtual functions, or concrete (final) player classes, in which case
+// the calls are resolved at compile time and can be inlined into the loop.
+// A game that has not ended after 4*rows*cols shots is abandoned.
+template <class P1, class P2>
+int playHeadless(const Game& g, P1& p1, P2& p2, GameRecord& rec,
+                 std::vector<ShotRecord>* log = nullptr,
+                 GameObserver* observer = nullptr)
+{
+    TRACE_SPAN("game");
+    rec = GameRecord();
+    PerfCounters* perf = regionCounters();
+
+    const bool heat = heatmapsEnabled();
+    int heat1 = 0;
+    int heat2 = 0;
+    if (heat)
+    {
+        heat1 = heatmapChannel(p1.name());
+        heat2 = heatmapChannel(p2.name());
+    }
+
+    Board b1(g);
+    Board b2(g);
+    if (heat)
+        setHeatmapChannel(heat1);
+    if (!TRACE_CALL("placeShips", PERF_CALL(perf, REGION_PLACE, p1.placeShips(b1))))
+        return -1;
+    if (heat)
+        setHeatmapChannel(heat2);
+    if (!TRACE_CALL("placeShips", PERF_CALL(perf, REGION_PLACE, p2.placeShips(b2))))
+        return -1;
+    if (observer != nullptr)
+        observer->gameStarted(p1.name(), b1, p2.name(), b2);
+
+    const int maxShots = 4 * g.rows() * g.cols();
+    bool hit;
+    bool destroy;
+    int id;
+
+    for (int shot = 0; shot < maxShots; shot += 2)
+    {
+        hit = false;
+        destroy = false;
+        id = -1;
+        if (heat)
+            setHeatmapChannel(heat1);
+        Point p = TRACE_CALL("recommendAttack", PERF_CALL(perf, REGION_RECOMMEND, p1.recommendAttack()));
+        bool valid = TRACE_CALL("attack", PERF_CALL(perf, REGION_ATTACK, b2.attack(p, hit, destroy, id)));
+        p2.recordAttackByOpponent(p);
+        TRACE_CALL("recordAttackResult", PERF_CALL(perf, REGION_RECORD, p1.recordAttackResult(p, valid, hit, destroy, id)));
+        rec.shots[0]++;
+        rec.hits[0] += hit;
+        if (log != nullptr)
+            log->push_back(ShotRecord{ 0, p, valid, hit, destroy, destroy ? id : -1 });
+        if (observer != nullptr)
+            observer->shotFired(ShotRecord{ 0, p, valid, hit, destroy, destroy ? id : -1 }, b2);
+        if (hit  &&  TRACE_CALL("allShipsDestroyed", b2.allShipsDestroyed()))
+        {
+            rec.winner = 0;
+            break;
+        }
+
+        hit = false;
+        destroy = false;
+        id = -1;
+        if (heat)
+            setHeatmapChannel(heat2);
+        p = TRACE_CALL("recommendAttack", PERF_CALL(perf, REGION_RECOMMEND, p2.recommendAttack()));
+        valid = TRACE_CALL("attack", PERF_CALL(perf, REGION_ATTACK, b1.attack(p, hit, destroy, id)));
+        p1.recordAttackByOpponent(p);
+        TRACE_CALL("recordAttackResult", PERF_CALL(perf, REGION_RECORD, p2.recordAttackResult(p, valid, hit, destroy, id)));
+        rec.shots[1]++;
+        rec.hits[1] += hit;
+        if (log != nullptr)
+            log->push_back(ShotRecord{ 1, p, valid, hit, destroy, destroy ? id : -1 });
+        if (observer != nullptr)
+            observer->shotFired(ShotRecord{ 1, p, valid, hit, destroy, destroy ? id : -1 }, b1);
+        if (hit  &&  TRACE_CALL("allShipsDestroyed", b1.allShipsDestroyed()))
+        {
+            rec.winner = 1;
+            break;
+        }
+    }
+
+    if (observer != nullptr)
+        observer->gameEnded(rec);
+    return rec.winner;
+}
+
+// Play one headless game between computer players of the given types (as
+// for createPlayer), with the player types fixed at compile time; log and
+// observer are as for playHeadless.  Returns false if either type is
+// unknown or is not a computer player.
+bool playHeadlessGame(std::string firstType, std::string secondType,
+                      const Game& g, GameRecord& rec,
+                      std::vector<ShotRecord>* log = nullptr,
+                      GameObserver* observer = nullptr);
+
+#endif // HEADLESSPLAY_INCLUDED
@@ -0,0 +1,173 @@
+#include "Heatmap.h"
+
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+
+using namespace std;
+
+atomic<bool> g_heatmapsEnabled(false);
+
+// One thread's counts.  Buffers belong to the registry so that they outlive
+// the threads that filled them.
+struct ThreadHeat
+{
+    vector<long long> placements;   // [channel][cell]
+    vector<long long> shots;
+};
+
+static mutex s_registryMutex;
+static vector<unique_ptr<ThreadHeat>> s_buffers;
+static vector<string> s_channelNames;
+static map<string, int> s_channels;
+
+static thread_local ThreadHeat* t_heat = nullptr;
+static thread_local int t_channel = 0;
+
+static ThreadHeat& threadHeat()
+{
+    if (t_heat == nullptr)
+    {
+        lock_guard<mutex> lock(s_registryMutex);
+        s_buffers.push_back(unique_ptr<ThreadHeat>(new ThreadHeat));
+        t_heat = s_buffers.back().get();
+    }
+    
+    // make room for channels created since this thread last counted
+    size_t needed = (size_t)(t_channel + 1) * MAXROWS * MAXCOLS;
+    if (t_heat->placements.size() < needed)
+    {
+        t_heat->placements.resize(needed, 0);
+        t_heat->shots.resize(needed, 0);
+    }
+    return *t_heat;
+}
+
+void enableHeatmaps(bool enable)
+{
+    g_heatmapsEnabled.store(enable);
+}
+
+int heatmapChannel(const string& name)
+{
+    lock_guard<mutex> lock(s_registryMutex);
+    map<string, int>::iterator it = s_channels.find(name);
+    if (it != s_channels.end())
+        return it->second;
+    int channel = (int)s_channelNames.size();
+    s_channelNames.push_back(name);
+    s_channels[name] = channel;
+    return channel;
+}
+
+void setHeatmapChannel(int channel)
+{
+    t_channel = channel;
+}
+
+void recordPlacementHeat(Bitboard cells, int delta)
+{
+    ThreadHeat& heat = threadHeat();
+    long long* counts = &heat.placements[(size_t)t_channel * MAXROWS * MAXCOLS];
+    while (!cells.empty())
+        counts[cells.popLowest()] += delta;
+}
+
+void recordShotHeat(Point p)
+{
+    ThreadHeat& heat = threadHeat();
+    heat.shots[(size_t)t_channel * MAXROWS * MAXCOLS + Bitboard::index(p)]++;
+}
+
+vector<Heatmap> collectHeatmaps()
+{
+    lock_guard<mutex> lock(s_registryMutex);
+    vector<Heatmap> maps(s_channelNames.size());
+    for (size_t ch = 0; ch < maps.size(); ch++)
+    {
+        maps[ch].name = s_channelNames[ch];
+        for (int i = 0; i < MAXROWS * MAXCOLS; i++)
+        {
+            maps[ch].placements[i] = 0;
+            maps[ch].shots[i] = 0;
+        }
+    }
+    
+    for (size_t b = 0; b < s_buffers.size(); b++)
+    {
+        const ThreadHeat& heat = *s_buffers[b];
+        for (size_t i = 0; i < heat.placements.size(); i++)
+        {
+            maps[i / (MAXROWS * MAXCOLS)].placements[i % (MAXROWS * MAXCOLS)] += heat.placements[i];
+            maps[i / (MAXROWS * MAXCOLS)].shots[i % (MAXROWS * MAXCOLS)] += heat.shots[i];
+        }
+    }
+    return maps;
+}
+
+void resetHeatmaps()
+{
+    lock_guard<mutex> lock(s_registryMutex);
+    for (size_t b = 0; b < s_buffers.size(); b++)
+    {
+        s_buffers[b]->placements.assign(s_buffers[b]->placements.size(), 0);
+        s_buffers[b]->shots.assign(s_buffers[b]->shots.size(), 0);
+    }
+}
+
+static void writeMatrix(ofstream& out, const string& name, const char* kind,
+                        const long long counts[], int nRows, int nCols)
+{
+    out << name << ' ' << kind << ' ' << nRows << ' ' << nCols << '\n';
+    for (int r = 0; r < nRows; r++)
+    {
+        for (int c = 0; c < nCols; c++)
+            out << (c == 0 ? "" : " ") << counts[r * MAXCOLS + c];
+        out << '\n';
+    }
+}
+
+bool writeHeatmaps(string path, const vector<Heatmap>& maps, int nRows, int nCols)
+{
+    ofstream out(path.c_str());
+    if (!out)
+        return false;
+    for (size_t m = 0; m < maps.size(); m++)
+    {
+        writeMatrix(out, maps[m].name, "placements", maps[m].placements, nRows, nCols);
+        writeMatrix(out, maps[m].name, "shots", maps[m].shots, nRows, nCols);
+    }
+    return bool(out);
+}
+
+void printHeatmap(const long long counts[], int nRows, int nCols)
+{
+    static const char shades[] = " .:-=+*#%@";
+    const int nShades = sizeof(shades) - 1;
+    
+    long long most = 0;
+    for (int r = 0; r < nRows; r++)
+        for (int c = 0; c < nCols; c++)
+            if (counts[r * MAXCOLS + c] > most)
+                most = counts[r * MAXCOLS + c];
+    
+    string frame = "  ";
+    for (int c = 0; c < nCols; c++)
+        frame += char('0' + c % 10);
+    frame += '\n';
+    for (int r = 0; r < nRows; r++)
+    {
+        frame += char('0' + r % 10);
+        frame += ' ';
+        for (int c = 0; c < nCols; c++)
+        {
+            long long n = counts[r * MAXCOLS + c];
+            int shade = (most == 0 || n <= 0) ? 0 : (int)(1 + n * (nShades - 2) / most);
+            frame += shades[shade];
+        }
+        frame += '\n';
+    }
+    cout << frame;
+}
@@ -0,0 +1,61 @@
+#ifndef HEATMAP_INCLUDED
+#define HEATMAP_INCLUDED
+
+#include "Bitboard.h"
+#include <atomic>
+#include <string>
+#include <vector>
+
+// Per-cell counts of where ships end up and where shots land, kept
+// separately for each channel (normally a player's name, which tournaments
+// set to the player's type).
+//
+// Board::placeShip, Board::unplaceShip and Board::attack report to the
+// channel most recently selected on the calling thread.  Each thread counts
+// into its own buffer, and collectHeatmaps adds the buffers together, so
+// the counting takes no locks.  While heatmaps are disabled the hooks cost
+// one relaxed load and a branch.
+
+extern std::atomic<bool> g_heatmapsEnabled;
+
+inline bool heatmapsEnabled()
+{
+    return g_heatmapsEnabled.load(std::memory_order_relaxed);
+}
+
+void enableHeatmaps(bool enable);
+
+// The channel with the given name, creating it if needed
+int heatmapChannel(const std::string& name);
+
+// Send this thread's heatmap counts to channel until it is changed
+void setHeatmapChannel(int channel);
+
+// a ship covering cells was placed (delta 1) or removed (delta -1)
+void recordPlacementHeat(Bitboard cells, int delta);
+
+// a valid shot landed on p
+void recordShotHeat(Point p);
+
+struct Heatmap
+{
+    std::string name;
+    long long placements[MAXROWS * MAXCOLS];
+    long long shots[MAXROWS * MAXCOLS];
+};
+
+// The counts from all threads so far, one Heatmap per channel.  Call this
+// when no thread is still counting.
+std::vector<Heatmap> collectHeatmaps();
+
+// Discard all counts (channels are kept)
+void resetHeatmaps();
+
+// Write heatmaps to path as plain matrices: for each channel a line
+// "<name> placements|shots <rows> <cols>" followed by one line per row
+bool writeHeatmaps(std::string path, const std::vector<Heatmap>& maps, int nRows, int nCols);
+
+// Draw one matrix using characters from light (rarely) to dark (often)
+void printHeatmap(const long long counts[], int nRows, int nCols);
+
+#endif // HEATMAP_INCLUDED
@@ -0,0 +1,162 @@
+#include "Hunter.h"
+#include "globals.h"
+#include <algorithm>
+
+using namespace std;
+
+// how much more a position counts for each unexplained hit it covers
+const double HIT_BONUS = 50;
+
+// the endgame solver is only tried when the ships' possible positions
+// multiply out to no more than this
+const double ENDGAME_GATE = 20000;
+
+DensityHunter::DensityHunter(const PlacementTable& table, long long endgameNodes,
+                             double endgameBudgetMs)
+: m_table(table), m_inference(table)
+{
+    if (endgameNodes > 0)
+        m_endgame.reset(new EndgameSolver(table, 200, endgameNodes, endgameBudgetMs));
+}
+
+void DensityHunter::reset()
+{
+    m_inference.reset();
+    if (m_endgame)
+        m_endgame->reset();
+}
+
+double DensityHunter::density(double density[MAXROWS * MAXCOLS]) const
+{
+    const Bitboard& shots = m_inference.knowledge().shots;
+    Bitboard unexplained = m_inference.unsunkHits();
+    double nLayouts = 1;
+    
+    for (int s = 0; s < m_table.nShips(); s++)
+    {
+        if (m_inference.isSunk(s))
+            continue;
+        const vector<ShipPlacement>& list = m_table.placements(s);
+        const vector<int>& candidates = m_inference.candidates(s);
+        for (size_t k = 0; k < candidates.size(); k++)
+        {
+            Bitboard mask = list[candidates[k]].mask;
+            double weight = 1;
+            for (int n = (mask & unexplained).count(); n > 0; n--)
+                weight *= HIT_BONUS;
+            Bitboard open = mask.without(shots);
+            while (!open.empty())
+                density[open.popLowest()] += weight;
+        }
+        nLayouts *= candidates.size();
+    }
+    return nLayouts;
+}
+
+Point DensityHunter::recommendAttack()
+{
+    const ShotKnowledge& knowledge = m_inference.knowledge();
+    const Bitboard& shots = knowledge.shots;
+    double density[MAXROWS * MAXCOLS] = {};
+    double nLayouts = this->density(density);
+    
+    Point p;
+    if (m_endgame  &&  nLayouts <= ENDGAME_GATE  &&  m_endgame->bestShot(knowledge, p))
+        return p;
+    
+    // the densest unshot cell, picking uniformly among ties
+    double best = -1;
+    int bestCell = -1;
+    int nBest = 0;
+    Bitboard open = m_table.allCells().without(shots);
+    while (!open.empty())
+    {
+        int i = open.popLowest();
+        if (density[i] > best)
+        {
+            best = density[i];
+            bestCell = i;
+            nBest = 1;
+        }
+        else if (density[i] == best  &&  randInt(++nBest) == 0)
+            bestCell = i;
+    }
+    
+    if (bestCell < 0)
+        return Point(0, 0);
+    return Bitboard::point(bestCell);
+}
+
+vector<Point> DensityHunter::recommendAttacks(int k)
+{
+    if (k == 1)
+        return vector<Point>(1, recommendAttack());
+    
+    double density[MAXROWS * MAXCOLS] = {};
+    this->density(density);
+    
+    // the k densest unshot cells, with ties broken by a random key
+    typedef pair<double, pair<uint32_t, int>> Ranked;
+    vector<Ranked> order;
+    Bitboard open = m_table.allCells().without(m_inference.knowledge().shots);
+    while (!open.empty())
+    {
+        int i = open.popLowest();
+        order.push_back(Ranked(density[i], make_pair(uint32_t(randomGenerator()()), i)));
+    }
+    size_t n = min(order.size(), size_t(max(k, 0)));
+    partial_sort(order.begin(), order.begin() + n, order.end(),
+                 [](const Ranked& a, const Ranked& b) {
+                     return a.first > b.first  ||  (a.first == b.first  &&  a.second < b.second);
+                 });
+    
+    vector<Point> salvo;
+    for (size_t j = 0; j < n; j++)
+        salvo.push_back(Bitboard::point(order[j].second.second));
+    return salvo;
+}
+
+void DensityHunter::recordAttackResult(Point p, bool validShot, bool shotHit,
+                                       bool shipDestroyed, int shipId)
+{
+    m_inference.record(p, validShot, shotHit, shipDestroyed, shipId);
+}
+
+int huntFleet(DensityHunter& hunter, const PlacementTable& table,
+              const vector<Bitboard>& ships)
+{
+    Bitboard occupied;
+    for (size_t s = 0; s < ships.size(); s++)
+        occupied |= ships[s];
+    
+    hunter.reset();
+    Bitboard shots;
+    int nShots = 0;
+    const int maxShots = 4 * table.rows() * table.cols();
+    while (!shots.contains(occupied)  &&  nShots < maxShots)
+    {
+        Point p = hunter.recommendAttack();
+        nShots++;
+        bool onBoard = p.r >= 0  &&  p.r < table.rows()  &&  p.c >= 0  &&  p.c < table.cols();
+        Bitboard cell = onBoard ? Bitboard::cell(p) : Bitboard();
+        if (!onBoard  ||  shots.intersects(cell))
+        {
+            hunter.recordAttackResult(p, false, false, false, -1);
+            continue;
+        }
+        shots |= cell;
+        bool hit = occupied.intersects(cell);
+        bool destroyed = false;
+        int shipId = -1;
+        if (hit)
+            for (size_t s = 0; s < ships.size(); s++)
+                if (ships[s].intersects(cell))
+                {
+                    destroyed = shots.contains(ships[s]);
+                    shipId = destroyed ? (int)s : -1;
+                    break;
+                }
+        hunter.recordAttackResult(p, true, hit, destroyed, shipId);
+    }
+    return nShots;
+}
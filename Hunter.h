@@ -0,0 +1,60 @@
+#ifndef HUNTER_INCLUDED
+#define HUNTER_INCLUDED
+
+#include "Placement.h"
+#include "Endgame.h"
+#include "Inference.h"
+#include <memory>
+#include <vector>
+
+// A strong attacking strategy that works directly on bitmasks.
+//
+// For every ship not yet sunk it counts, for each unshot cell, the
+// positions of that ship that are still possible (see ShipInference) and
+// cover the cell, and
+// shoots where the count is highest (ties are broken at random).
+// Positions that cover hits not yet explained by a sunk ship count far
+// more, so after a hit it finishes the ship off before hunting again.
+//
+// With an endgame budget, once few enough layouts remain it lets an
+// EndgameSolver pick the shot instead, searching at most that many nodes
+// (and, if endgameBudgetMs is above 0, at most that many milliseconds) on
+// each move.
+//
+// It needs no Board or Game at play time, so it can be used both by a
+// Player and by fast simulations such as huntFleet.
+class DensityHunter
+{
+public:
+    DensityHunter(const PlacementTable& table, long long endgameNodes = 0,
+                  double endgameBudgetMs = 0);
+    void reset();
+    Point recommendAttack();
+
+    // The k densest cells, all from the density the shots so far give, for
+    // a salvo; the endgame solver only chooses single shots
+    std::vector<Point> recommendAttacks(int k);
+
+    void recordAttackResult(Point p, bool validShot, bool shotHit,
+                            bool shipDestroyed, int shipId);
+
+    Bitboard shots() const { return m_inference.knowledge().shots; }
+    Bitboard hits() const { return m_inference.knowledge().hits; }
+    const ShipInference& inference() const { return m_inference; }
+
+private:
+    // Fill in the density of every unshot cell and return the number of
+    // layouts the ships' possible positions multiply out to
+    double density(double density[MAXROWS * MAXCOLS]) const;
+
+    const PlacementTable& m_table;
+    ShipInference m_inference;
+    std::unique_ptr<EndgameSolver> m_endgame;
+};
+
+// Let hunter attack a fleet given as the cells of each ship until every
+// ship is sunk, and return the number of shots it took
+int huntFleet(DensityHunter& hunter, const PlacementTable& table,
+              const std::vector<Bitboard>& ships);
+
+#endif // HUNTER_INCLUDED
@@ -0,0 +1,146 @@
+#include "Inference.h"
+
+using namespace std;
+
+ShipInference::ShipInference(const PlacementTable& table)
+: m_table(table)
+{
+    reset();
+}
+
+void ShipInference::reset()
+{
+    m_knowledge = ShotKnowledge();
+    m_sunk.assign(m_table.nShips(), false);
+    m_candidates.assign(m_table.nShips(), vector<int>());
+    for (int s = 0; s < m_table.nShips(); s++)
+        for (size_t k = 0; k < m_table.placements(s).size(); k++)
+            m_candidates[s].push_back((int)k);
+    m_sunkCells = Bitboard();
+    m_unsunkHits = Bitboard();
+}
+
+int ShipInference::position(int s) const
+{
+    return m_candidates[s].size() == 1 ? m_candidates[s][0] : -1;
+}
+
+template <class F>
+bool ShipInference::filter(int s, F keep)
+{
+    const vector<ShipPlacement>& list = m_table.placements(s);
+    vector<int>& cands = m_candidates[s];
+    size_t n = 0;
+    for (size_t k = 0; k < cands.size(); k++)
+        if (keep(list[cands[k]].mask))
+            n++;
+    if (n == cands.size()  ||  n == 0)
+        return false;
+    n = 0;
+    for (size_t k = 0; k < cands.size(); k++)
+        if (keep(list[cands[k]].mask))
+            cands[n++] = cands[k];
+    cands.resize(n);
+    return true;
+}
+
+void ShipInference::record(Point p, bool validShot, bool shotHit,
+                           bool shipDestroyed, int shipId)
+{
+    if (!validShot  ||  p.r < 0  ||  p.r >= m_table.rows()  ||  p.c < 0  ||  p.c >= m_table.cols())
+        return;
+    const Bitboard cell = Bitboard::cell(p);
+    const Bitboard hitsBefore = m_knowledge.hits;
+    m_knowledge.shots |= cell;
+
+    if (!shotHit)
+    {
+        for (int s = 0; s < m_table.nShips(); s++)
+            filter(s, [&](Bitboard mask) { return !mask.intersects(cell); });
+        propagate();
+        return;
+    }
+
+    m_knowledge.hits |= cell;
+    const Bitboard hits = m_knowledge.hits;
+    if (shipDestroyed  &&  shipId >= 0  &&  shipId < m_table.nShips())
+    {
+        m_knowledge.sinks.push_back(ShotKnowledge::Sink{ shipId, p });
+        m_sunk[shipId] = true;
+        // the ship covers p, and every other cell of it was already hit
+        Bitboard allowed = hitsBefore | cell;
+        filter(shipId, [&](Bitboard mask) {
+            return mask.intersects(cell)  &&  allowed.contains(mask);
+        });
+    }
+    // a ship still afloat cannot have been hit everywhere
+    for (int s = 0; s < m_table.nShips(); s++)
+        if (!m_sunk[s])
+            filter(s, [&](Bitboard mask) { return !hits.contains(mask); });
+    propagate();
+}
+
+void ShipInference::propagate()
+{
+    const int nShips = m_table.nShips();
+    vector<Bitboard> certain(nShips);
+    vector<Bitboard> possible(nShips);
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (int s = 0; s < nShips; s++)
+        {
+            const vector<ShipPlacement>& list = m_table.placements(s);
+            certain[s] = m_table.allCells();
+            possible[s] = Bitboard();
+            for (size_t k = 0; k < m_candidates[s].size(); k++)
+            {
+                certain[s] &= list[m_candidates[s][k]].mask;
+                possible[s] |= list[m_candidates[s][k]].mask;
+            }
+        }
+
+        // cells some ship must cover are closed to the others
+        for (int s = 0; s < nShips; s++)
+        {
+            Bitboard taken;
+            for (int t = 0; t < nShips; t++)
+                if (t != s)
+                    taken |= certain[t];
+            if (filter(s, [&](Bitboard mask) { return !mask.intersects(taken); }))
+                changed = true;
+        }
+        if (changed)
+            continue;
+
+        // a hit only one ship can cover is covered by that ship
+        Bitboard hits = m_knowledge.hits;
+        while (!hits.empty())
+        {
+            int i = hits.popLowest();
+            Bitboard cell = Bitboard::bit(i);
+            int owner = -1;
+            int nOwners = 0;
+            for (int s = 0; s < nShips; s++)
+                if (possible[s].intersects(cell))
+                {
+                    owner = s;
+                    nOwners++;
+                }
+            if (nOwners == 1  &&  !certain[owner].intersects(cell)  &&
+                filter(owner, [&](Bitboard mask) { return mask.intersects(cell); }))
+                changed = true;
+        }
+    }
+
+    m_sunkCells = Bitboard();
+    Bitboard sunkPossible;
+    for (int s = 0; s < nShips; s++)
+        if (m_sunk[s])
+        {
+            m_sunkCells |= certain[s];
+            sunkPossible |= possible[s];
+        }
+    m_unsunkHits = m_knowledge.hits.without(sunkPossible);
+}
@@ -0,0 +1,63 @@
+#ifndef INFERENCE_INCLUDED
+#define INFERENCE_INCLUDED
+
+#include "Placement.h"
+#include "Endgame.h"
+#include <vector>
+
+// What the results of an attacker's shots say about where each ship is.
+//
+// For every ship it keeps the positions (indexes into the table's
+// placements) still consistent with every result so far: no position covers
+// a miss; a ship still afloat is not hit everywhere; a sunk ship lies on
+// hits and covers the cell of the shot that sank it, every other cell of
+// it having been hit before that.  After each result the lists are pruned
+// against each other until nothing changes: cells that every remaining
+// position of a ship covers are taken away from the other ships, and a hit
+// that only one ship can still cover must be covered by that ship.  This
+// pins down sunk ships whose cells were ambiguous, and sometimes ships
+// still afloat, and tells which hits must belong to ships still afloat.
+//
+// The lists only ever shrink, so each result costs one pass over the
+// positions it can affect plus the pruning.  A result that contradicts the
+// others (the opponent's board is not the table's game, say) never empties
+// a list; the part of the reasoning that would is skipped.
+class ShipInference
+{
+public:
+    ShipInference(const PlacementTable& table);
+    void reset();
+
+    // Update with the result of a shot, as reported to recordAttackResult
+    void record(Point p, bool validShot, bool shotHit, bool shipDestroyed, int shipId);
+
+    const ShotKnowledge& knowledge() const { return m_knowledge; }
+    bool isSunk(int s) const { return m_sunk[s]; }
+
+    // The positions of ship s still possible
+    const std::vector<int>& candidates(int s) const { return m_candidates[s]; }
+
+    // Ship s's position if only one is left, otherwise -1
+    int position(int s) const;
+
+    // Cells that belong to a sunk ship however the ships lie
+    Bitboard sunkCells() const { return m_sunkCells; }
+
+    // Hits that no sunk ship can cover, so belong to ships still afloat
+    Bitboard unsunkHits() const { return m_unsunkHits; }
+
+private:
+    // keep only the positions of ship s whose masks pass keep; false if
+    // nothing was removed (or everything would have been)
+    template <class F> bool filter(int s, F keep);
+    void propagate();
+
+    const PlacementTable& m_table;
+    ShotKnowledge m_knowledge;
+    std::vector<bool> m_sunk;
+    std::vector<std::vector<int>> m_candidates;
+    Bitboard m_sunkCells;
+    Bitboard m_unsunkHits;
+};
+
+#endif // INFERENCE_INCLUDED
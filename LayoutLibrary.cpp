@@ -0,0 +1,152 @@
+#include "LayoutLibrary.h"
+#include "Board.h"
+#include "Game.h"
+
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+
+using namespace std;
+
+LayoutLibrary::LayoutLibrary(const Game& g)
+: m_table(g), m_nLayouts(0)
+{}
+
+void LayoutLibrary::add(const vector<int>& layout)
+{
+    for (int s = 0; s < m_table.nShips(); s++)
+    {
+        const ShipPlacement& sp = m_table.placements(s)[layout[s]];
+        m_layouts.push_back(Bitboard::index(sp.topOrLeft) | (sp.dir == VERTICAL ? 128 : 0));
+    }
+    m_nLayouts++;
+}
+
+vector<int> LayoutLibrary::layout(int k) const
+{
+    vector<int> result(m_table.nShips(), 0);
+    for (int s = 0; s < m_table.nShips(); s++)
+    {
+        unsigned char code = m_layouts[(size_t)k * m_table.nShips() + s];
+        Point p = Bitboard::point(code & 127);
+        Direction dir = (code & 128) ? VERTICAL : HORIZONTAL;
+        const vector<ShipPlacement>& list = m_table.placements(s);
+        for (size_t i = 0; i < list.size(); i++)
+            if (list[i].topOrLeft.r == p.r  &&  list[i].topOrLeft.c == p.c  &&
+                (list[i].dir == dir  ||  m_table.shipLength(s) == 1))
+            {
+                result[s] = (int)i;
+                break;
+            }
+    }
+    return result;
+}
+
+bool LayoutLibrary::place(Board& b) const
+{
+    if (m_nLayouts == 0)
+        return false;
+    const unsigned char* codes = &m_layouts[(size_t)randInt(m_nLayouts) * m_table.nShips()];
+    for (int s = 0; s < m_table.nShips(); s++)
+        if (!b.placeShip(Bitboard::point(codes[s] & 127), s,
+                         (codes[s] & 128) ? VERTICAL : HORIZONTAL))
+            return false;
+    return true;
+}
+
+bool LayoutLibrary::save(string path) const
+{
+    FILE* f = fopen(path.c_str(), "wb");
+    if (f == nullptr)
+        return false;
+    
+    vector<unsigned char> header;
+    header.push_back('B');
+    header.push_back('S');
+    header.push_back('L');
+    header.push_back('L');
+    header.push_back(m_table.rows());
+    header.push_back(m_table.cols());
+    header.push_back(m_table.nShips());
+    for (int s = 0; s < m_table.nShips(); s++)
+        header.push_back(m_table.shipLength(s));
+    for (int i = 0; i < 4; i++)
+        header.push_back((m_nLayouts >> (8 * i)) & 0xFF);
+    
+    bool ok = fwrite(&header[0], 1, header.size(), f) == header.size();
+    if (ok  &&  !m_layouts.empty())
+        ok = fwrite(&m_layouts[0], 1, m_layouts.size(), f) == m_layouts.size();
+    return fclose(f) == 0  &&  ok;
+}
+
+bool LayoutLibrary::load(string path)
+{
+    FILE* f = fopen(path.c_str(), "rb");
+    if (f == nullptr)
+        return false;
+    
+    unsigned char header[7];
+    bool ok = fread(header, 1, 7, f) == 7  &&  memcmp(header, "BSLL", 4) == 0  &&
+              header[4] == m_table.rows()  &&  header[5] == m_table.cols()  &&
+              header[6] == m_table.nShips();
+    for (int s = 0; ok  &&  s < m_table.nShips(); s++)
+        ok = (fgetc(f) == m_table.shipLength(s));
+    
+    unsigned char count[4];
+    ok = ok  &&  fread(count, 1, 4, f) == 4;
+    
+    // the count must agree with what is left of the file before anything
+    // is allocated for it, so a corrupt count cannot ask for gigabytes
+    long start = ok ? ftell(f) : -1;
+    ok = ok  &&  start >= 0  &&  fseek(f, 0, SEEK_END) == 0;
+    long end = ok ? ftell(f) : -1;
+    ok = ok  &&  end >= start  &&  fseek(f, start, SEEK_SET) == 0;
+    if (ok)
+    {
+        uint32_t n = count[0] | count[1] << 8 | count[2] << 16 | uint32_t(count[3]) << 24;
+        size_t remaining = (size_t)(end - start);
+        ok = n <= (uint32_t)INT_MAX  &&  m_table.nShips() > 0  &&
+             n <= remaining / m_table.nShips();
+        vector<unsigned char> layouts;
+        if (ok)
+            layouts.resize((size_t)n * m_table.nShips());
+        ok = ok  &&  (layouts.empty()  ||
+                      fread(&layouts[0], 1, layouts.size(), f) == layouts.size());
+        if (ok)
+        {
+            m_layouts.swap(layouts);
+            m_nLayouts = (int)n;
+        }
+    }
+    fclose(f);
+    return ok;
+}
+
+const LayoutLibrary* LayoutLibrary::shared(string path, const Game& g)
+{
+    static mutex libraryMutex;
+    static map<string, unique_ptr<LayoutLibrary>> libraries;
+    
+    lock_guard<mutex> lock(libraryMutex);
+    unique_ptr<LayoutLibrary>& lib = libraries[path];
+    if (!lib)
+    {
+        lib.reset(new LayoutLibrary(g));
+        if (!lib->load(path))
+            lib->m_nLayouts = 0;
+    }
+    
+    // a library made for another fleet is no use to this game
+    const PlacementTable& t = lib->m_table;
+    if (lib->m_nLayouts == 0  ||  t.rows() != g.rows()  ||  t.cols() != g.cols()  ||
+        t.nShips() != g.nShips())
+        return nullptr;
+    for (int s = 0; s < g.nShips(); s++)
+        if (t.shipLength(s) != g.shipLength(s))
+            return nullptr;
+    return lib.get();
+}
@@ -0,0 +1,45 @@
+#ifndef LAYOUTLIBRARY_INCLUDED
+#define LAYOUTLIBRARY_INCLUDED
+
+#include "Placement.h"
+#include <string>
+#include <vector>
+
+class Game;
+class Board;
+
+// A set of fleet layouts to draw from at the start of a game, such as the
+// hard-to-find layouts made by tools/optimize_layouts.cpp.
+//
+// The file format is compact: "BSLL", the board size, the number of ships
+// and their lengths, the number of layouts, and then one byte per ship per
+// layout holding the top or leftmost cell r*MAXCOLS+c, plus 128 if the ship
+// is vertical.
+class LayoutLibrary
+{
+public:
+    LayoutLibrary(const Game& g);
+    const PlacementTable& table() const { return m_table; }
+
+    int size() const { return m_nLayouts; }
+    void add(const std::vector<int>& layout);
+    std::vector<int> layout(int k) const;
+
+    // Put a layout chosen at random on b; false if the library is empty
+    bool place(Board& b) const;
+
+    // false if the file is missing or was made for another board or fleet
+    bool load(std::string path);
+    bool save(std::string path) const;
+
+    // The library at path for games set up like g, loaded the first time it
+    // is asked for and shared after that; nullptr if it cannot be loaded
+    static const LayoutLibrary* shared(std::string path, const Game& g);
+
+private:
+    PlacementTable m_table;
+    std::vector<unsigned char> m_layouts;
+    int m_nLayouts;
+};
+
+#endif // LAYOUTLIBRARY_INCLUDED
@@ -0,0 +1,190 @@
+#include "OpponentModel.h"
+#include "Board.h"
+#include "Game.h"
+
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+OpponentModel::OpponentModel(const Game& g, double coldness)
+: m_table(g), m_coldness(coldness), m_data(new Data()), m_mapped(false)
+{
+    memcpy(m_data->magic, "BSOM", 4);
+    m_data->rows = g.rows();
+    m_data->cols = g.cols();
+}
+
+OpponentModel::OpponentModel(string path, const Game& g, double coldness)
+: m_table(g), m_coldness(coldness), m_data(nullptr), m_mapped(true)
+{
+    int fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+        return;
+    
+    struct stat st;
+    bool fresh = (fstat(fd, &st) != 0  ||  st.st_size != sizeof(Data));
+    if (fresh  &&  ftruncate(fd, sizeof(Data)) != 0)
+    {
+        close(fd);
+        return;
+    }
+    
+    void* p = mmap(nullptr, sizeof(Data), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        return;
+    m_data = static_cast<Data*>(p);
+    
+    // start over if the file is new or was made for another board size
+    if (fresh  ||  memcmp(m_data->magic, "BSOM", 4) != 0  ||
+        m_data->rows != (uint32_t)g.rows()  ||  m_data->cols != (uint32_t)g.cols())
+    {
+        memset(m_data, 0, sizeof(Data));
+        memcpy(m_data->magic, "BSOM", 4);
+        m_data->rows = g.rows();
+        m_data->cols = g.cols();
+    }
+}
+
+OpponentModel::~OpponentModel()
+{
+    if (!m_mapped)
+        delete m_data;
+    else if (m_data != nullptr)
+        munmap(m_data, sizeof(Data));
+}
+
+void OpponentModel::recordShot(Point p)
+{
+    if (m_data == nullptr  ||  p.r < 0  ||  p.r >= m_table.rows()  ||
+        p.c < 0  ||  p.c >= m_table.cols())
+        return;
+    // several games may share a file, so count atomically
+    __atomic_fetch_add(&m_data->counts[Bitboard::index(p)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&m_data->total, 1, __ATOMIC_RELAXED);
+}
+
+long long OpponentModel::shots(Point p) const
+{
+    return m_data == nullptr ? 0 : m_data->counts[Bitboard::index(p)];
+}
+
+long long OpponentModel::totalShots() const
+{
+    return m_data == nullptr ? 0 : m_data->total;
+}
+
+bool OpponentModel::placeShips(Board& b) const
+{
+    const int nCells = m_table.rows() * m_table.cols();
+    
+    // how much hotter than average each cell is, in units of the average
+    double heat[MAXROWS * MAXCOLS] = {};
+    long long total = totalShots();
+    if (total > 0)
+        for (int r = 0; r < m_table.rows(); r++)
+            for (int c = 0; c < m_table.cols(); c++)
+            {
+                int i = Bitboard::index(r, c);
+                heat[i] = double(m_data->counts[i]) * nCells / total - 1;
+            }
+    
+    // weight of every position of every ship
+    vector<vector<double>> weights(m_table.nShips());
+    for (int s = 0; s < m_table.nShips(); s++)
+    {
+        const vector<ShipPlacement>& list = m_table.placements(s);
+        weights[s].resize(list.size());
+        for (size_t k = 0; k < list.size(); k++)
+        {
+            double h = 0;
+            Bitboard cells = list[k].mask;
+            while (!cells.empty())
+                h += heat[cells.popLowest()];
+            weights[s][k] = exp(-m_coldness * h / m_table.shipLength(s));
+        }
+    }
+    
+    // place ships one at a time among the positions still free; a draw that
+    // leaves some ship nowhere to go is thrown away and tried again
+    vector<int> chosen(m_table.nShips());
+    uniform_real_distribution<double> unit(0, 1);
+    for (int attempt = 0; attempt < 100; attempt++)
+    {
+        Bitboard used;
+        bool stuck = false;
+        for (int s = 0; s < m_table.nShips() && !stuck; s++)
+        {
+            const vector<ShipPlacement>& list = m_table.placements(s);
+            double sum = 0;
+            for (size_t k = 0; k < list.size(); k++)
+                if (!list[k].mask.intersects(used))
+                    sum += weights[s][k];
+            if (sum <= 0)
+            {
+                stuck = true;
+                break;
+            }
+            
+            double x = unit(randomGenerator()) * sum;
+            int pick = -1;
+            for (size_t k = 0; k < list.size(); k++)
+                if (!list[k].mask.intersects(used))
+                {
+                    pick = (int)k;
+                    x -= weights[s][k];
+                    if (x < 0)
+                        break;
+                }
+            chosen[s] = pick;
+            used |= list[pick].mask;
+        }
+        
+        if (stuck)
+            continue;
+        for (int s = 0; s < m_table.nShips(); s++)
+        {
+            const ShipPlacement& sp = m_table.placements(s)[chosen[s]];
+            b.placeShip(sp.topOrLeft, s, sp.dir);
+        }
+        return true;
+    }
+    
+    return false;
+}
+
+//*********************************************************************
+//  MatchModels
+//*********************************************************************
+
+static thread_local MatchModels* t_match = nullptr;
+
+MatchModels::MatchModels()
+: m_outer(t_match)
+{
+    t_match = this;
+}
+
+MatchModels::~MatchModels()
+{
+    t_match = m_outer;
+}
+
+OpponentModel& MatchModels::model(const string& name, const Game& g)
+{
+    unique_ptr<OpponentModel>& m = m_models[name];
+    if (m == nullptr)
+        m.reset(new OpponentModel(g));
+    return *m;
+}
+
+MatchModels* MatchModels::current()
+{
+    return t_match;
+}
@@ -0,0 +1,85 @@
+#ifndef OPPONENTMODEL_INCLUDED
+#define OPPONENTMODEL_INCLUDED
+
+#include "Placement.h"
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+class Game;
+class Board;
+
+// Where an opponent tends to shoot, learned across games.
+//
+// The per-cell shot counts live in memory owned by the model, or, given a
+// path, in a small file that is memory-mapped, so they survive from one
+// game (and one run) to the next and are shared by every model mapping the
+// same file.  Recording a shot is a single increment either way.  placeShips draws a fleet layout ship by ship,
+// choosing each position with probability proportional to
+// exp(-coldness * (how much more than average the opponent shoots there)),
+// so ships drift toward the cells the opponent neglects.
+class OpponentModel
+{
+public:
+    // A model of its own, starting with no shots, for games set up like g
+    OpponentModel(const Game& g, double coldness = 3.0);
+
+    // Map (creating if necessary) the model stored at path for games set up like g
+    OpponentModel(std::string path, const Game& g, double coldness = 3.0);
+    ~OpponentModel();
+    bool ok() const { return m_data != nullptr; }
+
+    void recordShot(Point p);
+    bool placeShips(Board& b) const;
+
+    long long shots(Point p) const;
+    long long totalShots() const;
+
+    OpponentModel(const OpponentModel&) = delete;
+    OpponentModel& operator=(const OpponentModel&) = delete;
+
+private:
+    struct Data
+    {
+        char magic[4];
+        uint32_t rows;
+        uint32_t cols;
+        uint32_t reserved;
+        uint64_t total;
+        uint64_t counts[MAXROWS * MAXCOLS];
+    };
+
+    PlacementTable m_table;
+    double m_coldness;
+    Data* m_data;
+    bool m_mapped;          // m_data is a mapping of a file rather than our own
+};
+
+// The in-memory models of one match: a run of games played one after
+// another on one thread.  While a MatchModels is open on a thread, an
+// adaptive player made there without a model file learns into the match's
+// model for its name, so it keeps what it learned in the match's earlier
+// games; with none open, it only learns within its own game.  Two players
+// of the same name in a match (a type against itself) learn together.
+class MatchModels
+{
+public:
+    MatchModels();          // open it on the calling thread
+    ~MatchModels();         // and close it again
+
+    // The model for the player named name, for games set up like g
+    OpponentModel& model(const std::string& name, const Game& g);
+
+    // The match open on the calling thread, or nullptr
+    static MatchModels* current();
+
+    MatchModels(const MatchModels&) = delete;
+    MatchModels& operator=(const MatchModels&) = delete;
+
+private:
+    std::map<std::string, std::unique_ptr<OpponentModel>> m_models;
+    MatchModels* m_outer;   // the match it hides, if any
+};
+
+#endif // OPPONENTMODEL_INCLUDED
@@ -0,0 +1,212 @@
+#include "PerfCounters.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace std;
+
+atomic<int> g_perfMode(PERF_OFF);
+
+static thread_local PerfCounters* t_regionCounters = nullptr;
+
+static const char* const EVENT_NAMES[NPERFEVENTS] = {
+    "cycles", "instructions", "cache misses", "branch misses", "task clock ns"
+};
+
+static const char* const REGION_NAMES[NPERFREGIONS] = {
+    "placeShips", "recommendAttack", "attack", "recordAttackResult"
+};
+
+void setPerfMode(PerfMode mode)
+{
+    g_perfMode.store(mode);
+}
+
+PerfCounters* regionCounters()
+{
+    return t_regionCounters;
+}
+
+void setRegionCounters(PerfCounters* pc)
+{
+    t_regionCounters = pc;
+}
+
+void PerfCounts::add(const PerfCounts& other)
+{
+    for (int e = 0; e < NPERFEVENTS; e++)
+        count[e] += other.count[e];
+    n += other.n;
+}
+
+bool PerfReport::available() const
+{
+    for (int e = 0; e < NPERFEVENTS; e++)
+        if (open[e])
+            return true;
+    return false;
+}
+
+void PerfReport::add(const PerfReport& other)
+{
+    for (int e = 0; e < NPERFEVENTS; e++)
+        open[e] = open[e]  ||  other.open[e];
+    if (error.empty())
+        error = other.error;
+    games.add(other.games);
+    for (int r = 0; r < NPERFREGIONS; r++)
+        regions[r].add(other.regions[r]);
+}
+
+//*********************************************************************
+//  PerfCounters
+//*********************************************************************
+
+static int openEvent(uint32_t type, uint64_t config, int groupFd)
+{
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+    attr.disabled = (groupFd == -1);
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, 0);
+}
+
+PerfCounters::PerfCounters()
+: m_leader(-1), m_nOpen(0)
+{
+    static const uint32_t types[NPERFEVENTS] = {
+        PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+        PERF_TYPE_SOFTWARE
+    };
+    static const uint64_t configs[NPERFEVENTS] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES, PERF_COUNT_SW_TASK_CLOCK
+    };
+
+    // the first counter that opens leads the group, so one read gets them all
+    for (int e = 0; e < NPERFEVENTS; e++)
+    {
+        m_fd[e] = openEvent(types[e], configs[e], m_leader);
+        m_slot[e] = -1;
+        if (m_fd[e] < 0)
+        {
+            if (m_report.error.empty())
+                m_report.error = string(EVENT_NAMES[e]) + ": " + strerror(errno);
+            continue;
+        }
+        if (m_leader == -1)
+            m_leader = m_fd[e];
+        m_slot[e] = m_nOpen++;
+        m_report.open[e] = true;
+    }
+    if (m_leader != -1)
+    {
+        ioctl(m_leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(m_leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+}
+
+PerfCounters::~PerfCounters()
+{
+    for (int e = 0; e < NPERFEVENTS; e++)
+        if (m_fd[e] >= 0)
+            close(m_fd[e]);
+}
+
+void PerfCounters::read(long long values[NPERFEVENTS]) const
+{
+    uint64_t buf[1 + NPERFEVENTS] = {};
+    if (m_leader == -1  ||  ::read(m_leader, buf, sizeof(buf)) <= 0)
+    {
+        for (int e = 0; e < NPERFEVENTS; e++)
+            values[e] = 0;
+        return;
+    }
+    for (int e = 0; e < NPERFEVENTS; e++)
+        values[e] = m_slot[e] >= 0 ? (long long)buf[1 + m_slot[e]] : 0;
+}
+
+void PerfCounters::addSince(const long long start[NPERFEVENTS], PerfCounts& to) const
+{
+    long long now[NPERFEVENTS];
+    read(now);
+    for (int e = 0; e < NPERFEVENTS; e++)
+        to.count[e] += now[e] - start[e];
+    to.n++;
+}
+
+void PerfCounters::startGame()
+{
+    read(m_gameStart);
+}
+
+void PerfCounters::endGame()
+{
+    addSince(m_gameStart, m_report.games);
+}
+
+PerfCounters::RegionScope::RegionScope(PerfCounters& pc, int region)
+: m_pc(pc), m_region(region)
+{
+    pc.read(m_start);
+}
+
+PerfCounters::RegionScope::~RegionScope()
+{
+    m_pc.addSince(m_start, m_pc.m_report.regions[m_region]);
+}
+
+//*********************************************************************
+//  Reporting
+//*********************************************************************
+
+static void printRow(ostream& out, const string& name, const PerfReport& report,
+                     const PerfCounts& counts)
+{
+    out << setw(24) << left << name << right << setw(10) << counts.n;
+    for (int e = 0; e < NPERFEVENTS; e++)
+    {
+        out << setw(15);
+        if (!report.open[e])
+            out << "-";
+        else if (counts.n == 0)
+            out << 0;
+        else
+            out << fixed << setprecision(0) << double(counts.count[e]) / counts.n;
+    }
+    out << endl;
+}
+
+void printPerfReport(ostream& out, const PerfReport& report)
+{
+    if (!report.available())
+    {
+        out << "Performance counters are not available (" << report.error << ")" << endl;
+        return;
+    }
+    if (!report.error.empty())
+        out << "Some counters are not available (" << report.error << ")" << endl;
+
+    ios::fmtflags flags = out.flags();
+    out << setw(24) << left << "average per" << right << setw(10) << "count";
+    for (int e = 0; e < NPERFEVENTS; e++)
+        out << setw(15) << EVENT_NAMES[e];
+    out << endl;
+    printRow(out, "game", report, report.games);
+    for (int r = 0; r < NPERFREGIONS; r++)
+        if (report.regions[r].n > 0)
+            printRow(out, string(REGION_NAMES[r]) + " call", report, report.regions[r]);
+    out.flags(flags);
+}
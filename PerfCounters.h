@@ -0,0 +1,124 @@
+#ifndef PERFCOUNTERS_INCLUDED
+#define PERFCOUNTERS_INCLUDED
+
+#include <atomic>
+#include <iosfwd>
+#include <string>
+
+// Hardware performance counters (Linux perf_event_open) for tournaments:
+// cycles, instructions, cache misses and branch misses, and the task clock,
+// a software counter that works even where the hardware ones are not
+// available (in most virtual machines and containers, for example).
+//
+// While counting is enabled, runTournament reads each thread's counters
+// before and after every game, and, if regions are asked for too, around
+// every placeShips, recommendAttack, Board::attack and recordAttackResult
+// call in the headless game loop.  Reading the counters is a system call,
+// so counting regions slows a tournament down several times, and the
+// counts of a region include a little of the reading itself; counting games
+// costs next to nothing.  Counters that cannot be opened are reported as
+// unavailable rather than failing anything.
+
+enum PerfEvent {
+    PERF_CYCLES, PERF_INSTRUCTIONS, PERF_CACHE_MISSES, PERF_BRANCH_MISSES, PERF_TASK_CLOCK,
+    NPERFEVENTS
+};
+
+enum PerfRegion {
+    REGION_PLACE, REGION_RECOMMEND, REGION_ATTACK, REGION_RECORD,
+    NPERFREGIONS
+};
+
+// What is counted: nothing, whole games, or whole games and regions
+enum PerfMode {
+    PERF_OFF, PERF_GAMES, PERF_REGIONS
+};
+
+extern std::atomic<int> g_perfMode;
+
+inline PerfMode perfMode()
+{
+    return PerfMode(g_perfMode.load(std::memory_order_relaxed));
+}
+
+void setPerfMode(PerfMode mode);
+
+// Counts summed over a number of games or calls
+struct PerfCounts
+{
+    long long count[NPERFEVENTS] = {};
+    long long n = 0;
+
+    void add(const PerfCounts& other);
+};
+
+// Everything one tournament counted
+struct PerfReport
+{
+    bool open[NPERFEVENTS] = {};    // the counters that could be read
+    std::string error;              // why the others could not
+    PerfCounts games;
+    PerfCounts regions[NPERFREGIONS];
+
+    bool available() const;
+    void add(const PerfReport& other);
+};
+
+// The counters of the thread that creates it, which must be the only
+// thread that uses it
+class PerfCounters
+{
+public:
+    PerfCounters();
+    ~PerfCounters();
+
+    void read(long long values[NPERFEVENTS]) const;
+
+    void startGame();
+    void endGame();
+
+    // Call f, adding what it counts to region
+    template <class F>
+    auto measure(int region, F f) -> decltype(f())
+    {
+        RegionScope scope(*this, region);
+        return f();
+    }
+
+    const PerfReport& report() const { return m_report; }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+private:
+    struct RegionScope
+    {
+        RegionScope(PerfCounters& pc, int region);
+        ~RegionScope();
+        PerfCounters& m_pc;
+        int m_region;
+        long long m_start[NPERFEVENTS];
+    };
+
+    void addSince(const long long start[NPERFEVENTS], PerfCounts& to) const;
+
+    int m_leader;                   // the group's file descriptor, or -1
+    int m_fd[NPERFEVENTS];
+    int m_slot[NPERFEVENTS];        // where each counter is in a group read
+    int m_nOpen;
+    long long m_gameStart[NPERFEVENTS];
+    PerfReport m_report;
+};
+
+// The counters measuring regions on the calling thread, or nullptr
+PerfCounters* regionCounters();
+void setRegionCounters(PerfCounters* pc);
+
+// Call call, counting it in region of perf unless perf is null
+#define PERF_CALL(perf, region, call) \
+    ((perf) == nullptr ? (call) : (perf)->measure(region, [&]() -> decltype(call) { return call; }))
+
+// Print the averages per game and per call, or why there are none
+void printPerfReport(std::ostream& out, const PerfReport& report);
+
+#endif // PERFCOUNTERS_INCLUDED
@@ -0,0 +1,441 @@
+#include "Placement.h"
+#include "Game.h"
+#include "Board.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+using namespace std;
+
+PlacementTable::PlacementTable(const Game& g)
+: m_rows(g.rows()), m_cols(g.cols()), m_allCells(boardMask(g.rows(), g.cols())),
+  m_lengths(g.nShips()), m_placements(g.nShips())
+{
+    for (int s = 0; s < g.nShips(); s++)
+    {
+        int len = g.shipLength(s);
+        m_lengths[s] = len;
+        vector<ShipPlacement>& list = m_placements[s];
+        for (int r = 0; r < m_rows; r++)
+            for (int c = 0; c + len <= m_cols; c++)
+                list.push_back(ShipPlacement{ shipMask(r, c, len, HORIZONTAL), Point(r, c), HORIZONTAL });
+        // a length 1 ship looks the same both ways
+        if (len > 1)
+            for (int r = 0; r + len <= m_rows; r++)
+                for (int c = 0; c < m_cols; c++)
+                    list.push_back(ShipPlacement{ shipMask(r, c, len, VERTICAL), Point(r, c), VERTICAL });
+    }
+}
+
+// the search for covers gives up after visiting this many nodes, and the
+// covers of one hit fewer are kept
+const long long MAX_COVER_NODES = 100000;
+
+LayoutSampler::LayoutSampler(const PlacementTable& t, Bitboard blocked, Bitboard hits)
+: m_table(t), m_blocked(blocked), m_hits(hits & t.allCells()),
+  m_impossible(hits.intersects(blocked))
+{
+    for (int s = 0; s < t.nShips(); s++)
+        m_order.push_back(s);
+    stable_sort(m_order.begin(), m_order.end(), [&](int a, int b) {
+        return t.shipLength(a) > t.shipLength(b);
+    });
+
+    int totalLength = 0;
+    m_indexes.resize(m_order.size());
+    m_masks.resize(m_order.size());
+    for (size_t k = 0; k < m_order.size(); k++)
+    {
+        int len = t.shipLength(m_order[k]);
+        totalLength += len;
+        m_startsAcross.push_back(boardMask(t.rows(), max(t.cols() - len + 1, 0)));
+        m_startsDown.push_back(boardMask(max(t.rows() - len + 1, 0), t.cols()));
+        const vector<ShipPlacement>& list = t.placements(m_order[k]);
+        for (size_t i = 0; i < list.size(); i++)
+            if (!list[i].mask.intersects(blocked))
+            {
+                m_indexes[k].push_back((int)i);
+                m_masks[k].push_back(list[i].mask);
+            }
+        if (m_indexes[k].empty())
+            m_impossible = true;
+    }
+
+    // the open positions through each hit, for listing the covers
+    m_through.assign(m_order.size() * MAXROWS * MAXCOLS, vector<int>());
+    for (size_t k = 0; k < m_order.size(); k++)
+        for (size_t i = 0; i < m_masks[k].size(); i++)
+            for (Bitboard h = m_masks[k][i] & m_hits; !h.empty(); )
+                m_through[k * MAXROWS * MAXCOLS + h.popLowest()].push_back((int)i);
+    if (m_hits.count() > totalLength)
+        m_impossible = true;
+    if (m_impossible)
+        return;
+
+    // cover as many of the hits as can be listed, lowest first; the covers
+    // of no hits, one empty cover, can always be listed
+    vector<int> chosen(m_order.size(), -1);
+    long long nodes = 0;
+    listCovers(m_covers, Bitboard(), Bitboard(), chosen, nodes);
+    for (Bitboard rest = m_hits; !rest.empty()  &&  !m_covers.weight.empty(); )
+    {
+        Covers more;
+        more.covered = m_covers.covered | Bitboard::bit(rest.popLowest());
+        nodes = 0;
+        if (!listCovers(more, more.covered, Bitboard(), chosen, nodes))
+            break;
+        swap(m_covers, more);
+    }
+    if (m_covers.weight.empty())
+        m_impossible = true;
+}
+
+// Add to out every cover of its hits that places the ships in chosen on
+// cells and covers the uncovered hits with others, or return false if
+// there are too many to list
+bool LayoutSampler::listCovers(Covers& out, Bitboard uncovered, Bitboard cells,
+                               vector<int>& chosen, long long& nodes) const
+{
+    if (++nodes > MAX_COVER_NODES)
+        return false;
+    if (uncovered.empty())
+    {
+        // the free ships' positions that avoid the cover, the covered hits
+        // and the blocked cells: the starts whose next len - 1 cells right
+        // (or down) are open too.  Ships of one length have the same
+        // positions, and come together.  At most 100 ships with at most
+        // 200 positions each cannot overflow a double.
+        Bitboard open = m_table.allCells().without(cells | out.covered | m_blocked);
+        double weight = 1;
+        int lastLength = -1;
+        double positions = 0;
+        for (size_t k = 0; k < m_order.size()  &&  weight > 0; k++)
+        {
+            if (chosen[k] >= 0)
+                continue;
+            int len = m_table.shipLength(m_order[k]);
+            if (len != lastLength)
+            {
+                lastLength = len;
+                Bitboard across = m_startsAcross[k];
+                Bitboard down = m_startsDown[k];
+                for (int j = 0; j < len; j++)
+                {
+                    across &= open.lowered(j);
+                    down &= open.lowered(j * MAXCOLS);
+                }
+                // a length 1 ship looks the same both ways
+                positions = across.count() + (len > 1 ? down.count() : 0);
+            }
+            weight *= positions;
+        }
+        if (weight > 0)
+        {
+            out.cells.push_back(cells);
+            out.chosen.insert(out.chosen.end(), chosen.begin(), chosen.end());
+            out.weight.push_back(weight + (out.weight.empty() ? 0 : out.weight.back()));
+        }
+        return true;
+    }
+
+    // the lowest hit not yet covered is covered by exactly one of the
+    // ships not yet placed, so each cover is listed once
+    int target = uncovered.lowest();
+    int freeLength = 0;
+    for (size_t k = 0; k < m_order.size(); k++)
+        if (chosen[k] < 0)
+            freeLength += m_table.shipLength(m_order[k]);
+    if (uncovered.count() > freeLength)
+        return true;
+    for (size_t k = 0; k < m_order.size(); k++)
+    {
+        if (chosen[k] >= 0)
+            continue;
+        const vector<int>& through = m_through[k * MAXROWS * MAXCOLS + target];
+        for (size_t j = 0; j < through.size(); j++)
+        {
+            Bitboard mask = m_masks[k][through[j]];
+            if (mask.intersects(cells))
+                continue;
+            chosen[k] = m_indexes[k][through[j]];
+            bool ok = listCovers(out, uncovered.without(mask), cells | mask, chosen, nodes);
+            chosen[k] = -1;
+            if (!ok)
+                return false;
+        }
+    }
+    return true;
+}
+
+bool LayoutSampler::draw(int* chosen, Bitboard& fleet)
+{
+    // a cover, by weight
+    size_t c = 0;
+    const vector<double>& weight = m_covers.weight;
+    if (weight.size() > 1)
+    {
+        double u = (m_random.next() >> 11) * (1.0 / 9007199254740992.0) * weight.back();
+        c = upper_bound(weight.begin(), weight.end(), u) - weight.begin();
+        if (c == weight.size())
+            c--;
+    }
+    const int* cover = &m_covers.chosen[c * m_order.size()];
+    fleet = m_covers.cells[c];
+    Bitboard taken = fleet | m_covers.covered;
+
+    // and the free ships around it
+    for (size_t k = 0; k < m_order.size(); k++)
+    {
+        if (cover[k] >= 0)
+        {
+            chosen[k] = cover[k];
+            continue;
+        }
+        // the cover's weight counted only the positions that avoid taken,
+        // and there is at least one
+        int i;
+        do
+            i = (int)m_random.below((uint32_t)m_masks[k].size());
+        while (m_masks[k][i].intersects(taken));
+        Bitboard mask = m_masks[k][i];
+        if (mask.intersects(fleet))
+            return false;
+        fleet |= mask;
+        chosen[k] = m_indexes[k][i];
+    }
+    // the hits the covers left out must be covered by a free ship
+    return fleet.contains(m_hits);
+}
+
+bool LayoutSampler::sample(vector<int>& layout, int maxTries)
+{
+    if (m_impossible)
+        return false;
+    int chosen[MAXROWS * MAXCOLS];
+    Bitboard fleet;
+    for (int attempt = 0; attempt < maxTries; attempt++)
+    {
+        if (!draw(chosen, fleet))
+            continue;
+        layout.resize(m_order.size());
+        for (size_t k = 0; k < m_order.size(); k++)
+            layout[m_order[k]] = chosen[k];
+        return true;
+    }
+    return false;
+}
+
+bool LayoutSampler::sampleCells(Bitboard& fleet, int maxTries)
+{
+    if (m_impossible)
+        return false;
+    int chosen[MAXROWS * MAXCOLS];
+    for (int attempt = 0; attempt < maxTries; attempt++)
+        if (draw(chosen, fleet))
+            return true;
+    return false;
+}
+
+bool randomLayout(const PlacementTable& t, vector<int>& layout, int maxTries)
+{
+    LayoutSampler sampler(t);
+    return sampler.sample(layout, maxTries);
+}
+
+void placeLayout(const PlacementTable& t, const vector<int>& layout, Board& b)
+{
+    for (int s = 0; s < t.nShips(); s++)
+    {
+        const ShipPlacement& sp = t.placements(s)[layout[s]];
+        b.placeShip(sp.topOrLeft, s, sp.dir);
+    }
+}
+
+vector<Bitboard> layoutShips(const PlacementTable& t, const vector<int>& layout)
+{
+    vector<Bitboard> ships(t.nShips());
+    for (int s = 0; s < t.nShips(); s++)
+        ships[s] = t.placements(s)[layout[s]].mask;
+    return ships;
+}
+
+namespace {
+
+// a state of FleetFitter's search: the decided cells, and how many ships
+// of each length are left
+struct FitState
+{
+    Bitboard decided;
+    uint64_t shipsLeft;
+    bool operator==(const FitState& o) const
+    {
+        return decided == o.decided  &&  shipsLeft == o.shipsLeft;
+    }
+};
+
+struct FitStateHash
+{
+    size_t operator()(const FitState& f) const
+    {
+        return f.decided.hash() ^ (f.shipsLeft * 0x9E3779B97F4A7C15ULL);
+    }
+};
+
+// The exact search behind fleetFits.  Open cells are decided in order: the
+// lowest undecided cell either starts one of the ships still to be placed
+// (running right or down from it, since every cell before it is already
+// decided) or is left empty, which only a board with spare cells can
+// afford.  States known to fail are remembered.
+class FleetFitter
+{
+public:
+    FleetFitter(int nRows, int nCols, const vector<int>& lengths, Bitboard blocked);
+    bool fits() { return !m_impossible  &&  fit(Bitboard(), m_spare); }
+private:
+    bool fit(Bitboard decided, int spare);
+
+    Bitboard m_open;
+    vector<int> m_lengths;                  // the distinct lengths, longest first
+    vector<int> m_counts;                   // ships of each length still to place
+    vector<int> m_totals;                   // ships of each length in the fleet
+    vector<vector<Bitboard>> m_starts;      // [length][2*cell + dir], empty if off the board
+    vector<vector<Bitboard>> m_positions;   // [length] every open position
+    int m_spare;
+    bool m_impossible;
+    unordered_set<FitState, FitStateHash> m_failed;
+};
+
+FleetFitter::FleetFitter(int nRows, int nCols, const vector<int>& lengths, Bitboard blocked)
+: m_open(boardMask(nRows, nCols).without(blocked)), m_spare(0), m_impossible(false)
+{
+    vector<int> sorted(lengths);
+    sort(sorted.begin(), sorted.end(), greater<int>());
+    int totalLength = 0;
+    for (size_t k = 0; k < sorted.size(); k++)
+    {
+        if (sorted[k] < 1  ||  sorted[k] > max(nRows, nCols))
+            m_impossible = true;
+        totalLength += sorted[k];
+        if (k > 0  &&  sorted[k] == sorted[k - 1])
+            m_counts.back()++;
+        else
+        {
+            m_lengths.push_back(sorted[k]);
+            m_counts.push_back(1);
+        }
+    }
+    m_totals = m_counts;
+    m_spare = m_open.count() - totalLength;
+    if (m_spare < 0)
+        m_impossible = true;
+
+    m_starts.resize(m_lengths.size());
+    m_positions.resize(m_lengths.size());
+    for (size_t i = 0; i < m_lengths.size(); i++)
+    {
+        int len = m_lengths[i];
+        m_starts[i].assign(2 * MAXROWS * MAXCOLS, Bitboard());
+        for (int r = 0; r < nRows; r++)
+            for (int c = 0; c < nCols; c++)
+            {
+                int cell = Bitboard::index(r, c);
+                // a mask is only made for a position on the board
+                if (c + len <= nCols)
+                {
+                    Bitboard h = shipMask(r, c, len, HORIZONTAL);
+                    if (m_open.contains(h))
+                        m_starts[i][2 * cell] = h;
+                }
+                // a length 1 ship looks the same both ways
+                if (len > 1  &&  r + len <= nRows)
+                {
+                    Bitboard v = shipMask(r, c, len, VERTICAL);
+                    if (m_open.contains(v))
+                        m_starts[i][2 * cell + 1] = v;
+                }
+                for (int dir = 0; dir < 2; dir++)
+                    if (!m_starts[i][2 * cell + dir].empty())
+                        m_positions[i].push_back(m_starts[i][2 * cell + dir]);
+            }
+        if (m_positions[i].empty())
+            m_impossible = true;
+    }
+}
+
+bool FleetFitter::fit(Bitboard decided, int spare)
+{
+    // the counts left as one number; a fleet on a board of at most 100
+    // cells has few enough length classes that this cannot overflow
+    uint64_t shipsLeft = 0;
+    for (size_t i = 0; i < m_counts.size(); i++)
+        shipsLeft = shipsLeft * (m_totals[i] + 1) + m_counts[i];
+    if (shipsLeft == 0)
+        return true;
+    FitState state{ decided, shipsLeft };
+    if (m_failed.count(state) != 0)
+        return false;
+
+    // give up as soon as some ship has nowhere left to go
+    for (size_t i = 0; i < m_lengths.size(); i++)
+    {
+        if (m_counts[i] == 0)
+            continue;
+        size_t k;
+        for (k = 0; k < m_positions[i].size()  &&  m_positions[i][k].intersects(decided); k++)
+            ;
+        if (k == m_positions[i].size())
+        {
+            m_failed.insert(state);
+            return false;
+        }
+    }
+
+    int cell = m_open.without(decided).lowest();
+    for (size_t i = 0; i < m_lengths.size(); i++)
+    {
+        if (m_counts[i] == 0)
+            continue;
+        for (int dir = 0; dir < 2; dir++)
+        {
+            Bitboard ship = m_starts[i][2 * cell + dir];
+            if (ship.empty()  ||  ship.intersects(decided))
+                continue;
+            m_counts[i]--;
+            bool ok = fit(decided | ship, spare);
+            m_counts[i]++;
+            if (ok)
+                return true;
+        }
+    }
+    if (spare > 0  &&  fit(decided | Bitboard::bit(cell), spare - 1))
+        return true;
+
+    m_failed.insert(state);
+    return false;
+}
+
+}
+
+bool fleetFits(int nRows, int nCols, const vector<int>& lengths, Bitboard blocked)
+{
+    FleetFitter fitter(nRows, nCols, lengths, blocked);
+    return fitter.fits();
+}
+
+bool fleetFits(const Game& g, Bitboard blocked)
+{
+    vector<int> lengths(g.nShips());
+    for (int s = 0; s < g.nShips(); s++)
+        lengths[s] = g.shipLength(s);
+    return fleetFits(g.rows(), g.cols(), lengths, blocked);
+}
+
+Bitboard blockedCells(const Game& g, const Board& b)
+{
+    Bitboard blocked;
+    for (int r = 0; r < g.rows(); r++)
+        for (int c = 0; c < g.cols(); c++)
+            if (b.isBlocked(Point(r, c)))
+                blocked |= Bitboard::cell(r, c);
+    return blocked;
+}
@@ -0,0 +1,128 @@
+#ifndef PLACEMENT_INCLUDED
+#define PLACEMENT_INCLUDED
+
+#include "Bitboard.h"
+#include <vector>
+
+class Game;
+class Board;
+
+// One position of a ship: the cells it covers and how to place it on a Board
+struct ShipPlacement
+{
+    Bitboard mask;
+    Point topOrLeft;
+    Direction dir;
+};
+
+// Every position of each of a game's ships on an empty board.  This is the
+// run-time counterpart of StaticGame's placement tables, for games whose
+// size and fleet are only known when the program runs.
+class PlacementTable
+{
+public:
+    PlacementTable(const Game& g);
+    int nShips() const { return (int)m_placements.size(); }
+    int rows() const { return m_rows; }
+    int cols() const { return m_cols; }
+    Bitboard allCells() const { return m_allCells; }
+    int shipLength(int shipId) const { return m_lengths[shipId]; }
+    const std::vector<ShipPlacement>& placements(int shipId) const { return m_placements[shipId]; }
+private:
+    int m_rows;
+    int m_cols;
+    Bitboard m_allCells;
+    std::vector<int> m_lengths;
+    std::vector<std::vector<ShipPlacement>> m_placements;
+};
+
+// A layout gives each ship s a position, as an index into placements(s).
+
+// Draws layouts uniformly at random from those that avoid the blocked
+// cells (misses, say) and cover every one of the hits.
+//
+// A layout splits into the ships that cover hits (a "cover") and the free
+// ships, which avoid the hits.  The sampler lists every cover when it is
+// made, weighing each by the product, over the free ships, of the
+// positions that avoid the cover, the hits and the blocked cells.  A draw
+// picks a cover by weight, then gives each free ship, longest first, one of
+// those positions uniformly, and starts over as soon as a free ship
+// overlaps one placed before it.  Every layout comes from exactly one cover
+// and is drawn with probability 1 / (total weight), so the layouts it
+// returns are exactly uniform, and hits cost few more draws than an open
+// board: the standard fleet on a 10x10 board takes about 2.6 draws per
+// layout, and millions of layouts a second.
+//
+// Scattered hits can have too many covers to list.  Then only the lowest
+// hits are covered by the list, the free ships may cover the others, and a
+// draw also starts over if one of those is left uncovered, which is still
+// exact but takes more draws.  The random numbers come from a FastRandom
+// seeded when the sampler is made.
+class LayoutSampler
+{
+public:
+    LayoutSampler(const PlacementTable& t, Bitboard blocked = Bitboard(),
+                  Bitboard hits = Bitboard());
+
+    // Draw a layout into layout, giving up (and returning false) after
+    // maxTries draws; a fleet with no legal layout always gives up
+    bool sample(std::vector<int>& layout, int maxTries = 100000);
+
+    // The same, for a caller that only needs the cells the fleet covers
+    bool sampleCells(Bitboard& fleet, int maxTries = 100000);
+
+private:
+    // the covers of some of the hits: their cells, their positions
+    // (m_order.size() per cover, a placement index or -1 for a free ship)
+    // and their running weights
+    struct Covers
+    {
+        Bitboard covered;
+        std::vector<Bitboard> cells;
+        std::vector<int> chosen;
+        std::vector<double> weight;
+    };
+
+    bool listCovers(Covers& out, Bitboard uncovered, Bitboard cells,
+                    std::vector<int>& chosen, long long& nodes) const;
+    bool draw(int* chosen, Bitboard& fleet);
+
+    const PlacementTable& m_table;
+    Bitboard m_blocked;
+    Bitboard m_hits;
+    bool m_impossible;
+    std::vector<int> m_order;                   // ships, longest first
+    std::vector<std::vector<int>> m_indexes;    // [k] open positions of m_order[k]
+    std::vector<std::vector<Bitboard>> m_masks; // [k] their cells
+    std::vector<Bitboard> m_startsAcross;       // [k] where m_order[k] fits running right
+    std::vector<Bitboard> m_startsDown;         // [k] and running down
+    std::vector<std::vector<int>> m_through;    // [k * cells + hit] open positions of m_order[k] through it
+    Covers m_covers;
+    FastRandom m_random;
+};
+
+// Choose a position for every ship uniformly at random so that no two
+// overlap, giving up after maxTries draws
+bool randomLayout(const PlacementTable& t, std::vector<int>& layout, int maxTries = 1000);
+
+// Put every ship of a layout on b (which should be empty)
+void placeLayout(const PlacementTable& t, const std::vector<int>& layout, Board& b);
+
+// The cells of each ship of a layout
+std::vector<Bitboard> layoutShips(const PlacementTable& t, const std::vector<int>& layout);
+
+// Can ships of the given lengths all be placed, without overlapping, on an
+// nRows x nCols board without covering any blocked cell?  This is an exact
+// search that decides the open cells in order, each either starting a ship
+// or left empty, and it remembers the states that fail, so it answers in
+// microseconds even for fleets that pack the board tightly.
+bool fleetFits(int nRows, int nCols, const std::vector<int>& lengths,
+               Bitboard blocked = Bitboard());
+
+// The same for g's fleet
+bool fleetFits(const Game& g, Bitboard blocked = Bitboard());
+
+// The cells of b that are blocked
+Bitboard blockedCells(const Game& g, const Board& b);
+
+#endif // PLACEMENT_INCLUDED
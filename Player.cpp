@@ -2,20 +2,79 @@
 #include "Board.h"
 #include "Game.h"
 #include "globals.h"
+#include "HeadlessPlay.h"
+#include "OpponentModel.h"
+#include "Hunter.h"
+#include "LayoutLibrary.h"
+#include "Policy.h"
+#include "Targeting.h"
+#include "ExternalBot.h"
+#include "Tuning.h"
 #include <iostream>
 #include <string>
+#include <cctype>
 
 #include <random>
 #include <vector>
 #include <list>
+#include <deque>
+#include <algorithm>
+#include <memory>
+#include <sstream>
 
 using namespace std;
 
+//*********************************************************************
+//  Player
+//*********************************************************************
+
+// how many times recommendAttacks asks again for a cell already in the salvo
+const int SALVO_RETRIES = 4;
+
+vector<Point> Player::recommendAttacks(int k)
+{
+    vector<Point> shots;
+    for (int i = 0; i < k; i++){
+        Point p = recommendAttack();
+        for (int tries = 0; tries < SALVO_RETRIES; tries++){
+            bool repeated = false;
+            for (size_t j = 0; j < shots.size(); j++){
+                if (shots[j].r == p.r && shots[j].c == p.c){
+                    repeated = true;
+                }
+            }
+            if (!repeated){
+                break;
+            }
+            p = recommendAttack();
+        }
+        
+        // a cell that is still repeated is fired anyway, and wasted
+        shots.push_back(p);
+    }
+    return shots;
+}
+
+void Player::recordAttackResults(const vector<ShotResult>& results)
+{
+    for (size_t i = 0; i < results.size(); i++){
+        const ShotResult& r = results[i];
+        recordAttackResult(r.p, r.validShot, r.shotHit, r.shipDestroyed, r.shipId);
+    }
+}
+
+void Player::recordAttacksByOpponent(const vector<Point>& shots)
+{
+    for (size_t i = 0; i < shots.size(); i++){
+        recordAttackByOpponent(shots[i]);
+    }
+}
+
 //*********************************************************************
 //  AwfulPlayer
 //*********************************************************************
 
-class AwfulPlayer : public Player
+class AwfulPlayer final : public Player
 {
 public:
     AwfulPlayer(string nm, const Game& g);
@@ -208,7 +267,7 @@ void HumanPlayer::recordAttackByOpponent(Point /* p */)
 //  MediocrePlayer
 //*********************************************************************
 
-class MediocrePlayer : public Player
+class MediocrePlayer final : public Player
 {
 public:
     MediocrePlayer(string nm, const Game& g);
@@ -220,47 +279,47 @@ public:
     virtual void recordAttackByOpponent(Point p);
     bool pathExists(vector<Point>&all, Board& b, int ship);
     bool backtrack(vector<Point>&all, Board& b, int ship);
-    bool repeat(Point rand);
     
     // Return a uniformly distributed random int from 0 to limit-1
     int randInt(int start, int limit);
     
 private:
-    Point m_lastCellAttacked;
-    Point m_transition;
     int m_state = 1;
-    vector <Point> m_points;
-    vector <Point> cross;
+    CellPool m_unshot;          // cells not chosen yet
+    deque <Point> cross;        // cross cells still to try, in random order
 };
 
 MediocrePlayer::MediocrePlayer(string nm, const Game& g)
-: Player(nm, g), m_lastCellAttacked(0, 0), m_transition(0, 0)
+: Player(nm, g), m_unshot(g.rows(), g.cols())
 {}
 
 int MediocrePlayer::randInt(int start, int limit){
-    static std::random_device rd;
-    static std::mt19937 generator(rd());
+    // draw from the shared generator so seedRandom covers this player too
     std::uniform_int_distribution<> distro(start, limit-1);
-    return distro(generator);
+    return distro(randomGenerator());
 }
 
 bool MediocrePlayer::placeShips(Board& b)
 {
     // Remember that Mediocre::placeShips(Board& b) must start by calling
     // b.block(), and must call b.unblock() just before returning.
-    b.block();
-    vector <Point> all;
-    all.clear();
-    
-    int ship = 0;
-    for (int i = 0; i < 50; i++){
-        if (pathExists(all, b, ship)){
-            b.unblock();
-            return true;
+    int retries = tuned(TUNE_PLACE_RETRIES);
+    for (int i = 0; i < retries; i++){
+        b.block();
+        
+        // only search for a layout if one exists with these cells blocked
+        if (fleetFits(game(), blockedCells(game(), b))){
+            vector <Point> all;
+            if (pathExists(all, b, 0)){
+                b.unblock();
+                return true;
+            }
         }
+        
+        // start over with a fresh set of blocked cells
+        b.clear();
     }
     
-    // b.unblock();
     return false;
 }
 
@@ -390,124 +449,63 @@ bool MediocrePlayer::pathExists(vector<Point>&all, Board& b, int ship){
     
 }
 
-bool MediocrePlayer::repeat(Point rand){
-    for (int i = 0; i < m_points.size(); i++){
-        if (rand.r == m_points[i].r && rand.c == m_points[i].c){
-            return true;
-        }
-    }
-    
-    return false;
-}
-
 Point MediocrePlayer::recommendAttack()
 {
-    for (int a = 0; a < game().nShips(); a++){
-        if (game().shipLength(a) > 5){
-            m_state = 2;
-            break;
-        }
-    }
-    
-    // NOTE: STATE 2 CHECK FOR NO REPEATS EITHER (IN THE CASE OF LENGTH 6 SHIPS)
+    // state 2: a cell of the cross that has not been chosen before
     if (m_state == 2){
-        Point randinbounds(-1, -1);
-        
-        // try every row
-        for (int mr = m_transition.r-4; mr < 8; mr++){
-            randinbounds.r = mr;
-            randinbounds.c = m_transition.c;
-            if (game().isValid(randinbounds)){
-                cross.push_back(randinbounds);
+        while (!cross.empty()){
+            Point p = cross.front();
+            cross.pop_front();
+            if (m_unshot.contains(p)){
+                m_unshot.remove(p);
+                return p;
             }
         }
         
-        // try every col
-        for (int mc = m_transition.c-4; mc < 8; mc++){
-            randinbounds.c = mc;
-            randinbounds.r = m_transition.r;
-            if (game().isValid(randinbounds)){
-                cross.push_back(randinbounds);
-            }
-        }
-        
-        /* Testing
-         for (int k = 0; k < cross.size(); k++){
-         cout << "cross " << cross[k].r << cross[k].c << " ";
-         }
-         
-         cout << endl << endl;
-         
-         for (int h = 0; h < m_points.size(); h++){
-         cout << "points " << m_points[h].r << m_points[h].c << " ";
-         }
-         */
-        
-        for (int j = 0; j < cross.size(); j++){
-            if (!repeat(cross[j])){
-                m_points.push_back(cross[j]);
-                return cross[j];
-            }
-        }
-    }
-    
-    cross.clear();
-    
-    // if state 1, return a random point that has not been chosen before
-    // if everything in the cross was hit, revert to state 1
-    // if (m_state == 1) {
-    Point rand = game().randomPoint();
-    int counter = 0;
-    
-    for (int i = 0; i < m_points.size(); i++){
-        // keeps generating a new point if point is already present
-        while (rand.r == m_points[i].r && rand.c == m_points[i].c){
-            rand = game().randomPoint();
-            i = 0;
-            counter++;
-        }
+        // everything in the cross was chosen, so revert to state 1
+        m_state = 1;
     }
     
-    m_points.push_back(rand);
-    
-    return rand;
-    
-    // return m_lastCellAttacked;
-    
+    // state 1: a random point that has not been chosen before
+    if (m_unshot.empty())
+        return Point(0, 0);
+    return m_unshot.draw();
 }
 
 void MediocrePlayer::recordAttackResult(Point p, bool validShot, bool shotHit, bool shipDestroyed, int shipId)
 {
     // P would be the rand point returned from recommendAttack
     
-    // if it is a valid shot and it missed
-    if (validShot && !shotHit){
-        m_state = 1;
-    }
+    // a miss leaves the state as it is; state 2 goes on through the cross
     
     if (validShot && shotHit && shipDestroyed){
         m_state = 1;
+        cross.clear();
     }
     
     // hit a ship but did not destroy it
     if (validShot && shotHit && !shipDestroyed){
         
-        // point that caused the transition from state 1 to state 2
+        // the hit that moves us from state 1 to state 2; the cross is built
+        // once, here, clipped to the board
         if (m_state == 1){
-            m_transition = p;
+            cross.clear();
+            int radius = tuned(TUNE_CROSS_RADIUS);
+            for (int d = -radius; d <= radius; d++){
+                if (d == 0)
+                    continue;
+                Point vertical(p.r + d, p.c);
+                Point horizontal(p.r, p.c + d);
+                if (game().isValid(vertical))
+                    cross.push_back(vertical);
+                if (game().isValid(horizontal))
+                    cross.push_back(horizontal);
+            }
+            shuffle(cross.begin(), cross.end(), randomGenerator());
         }
         
         m_state = 2;
     }
-    
-    // as long as there is one ship with length 6, follow this procedure
-    // only after each position within a radius of 4 was hit, switch to case 1
-    for (int i = 0; i < game().nShips(); i++){
-        if (game().shipLength(i) > 5){
-            
-        }
-    }
-    
 }
 
 void MediocrePlayer::recordAttackByOpponent(Point /* p */)
@@ -520,36 +518,7 @@ void MediocrePlayer::recordAttackByOpponent(Point /* p */)
 //*********************************************************************
 //  GoodPlayer
 //*********************************************************************
-//========================================================================
-// Timer t;                 // create a timer and start it
-// t.start();               // start the timer
-// double d = t.elapsed();  // milliseconds since timer was last started
-//========================================================================
-
-#include <chrono>
-
-class Timer
-{
-public:
-    Timer()
-    {
-        start();
-    }
-    void start()
-    {
-        m_time = std::chrono::high_resolution_clock::now();
-    }
-    double elapsed() const
-    {
-        std::chrono::duration<double,std::milli> diff =
-        std::chrono::high_resolution_clock::now() - m_time;
-        return diff.count();
-    }
-private:
-    std::chrono::high_resolution_clock::time_point m_time;
-};
-
-class GoodPlayer : public Player
+class GoodPlayer final : public Player
 {
 public:
     GoodPlayer(string nm, const Game& g);
@@ -560,93 +529,71 @@ public:
                                     bool shipDestroyed, int shipId);
     virtual void recordAttackByOpponent(Point p);
     
-    bool putintoquad(int quad, int midrow, int midcol, int rows, int cols, int shipid, Board& b);
     int randInt(int start, int limit);
-    bool repeat(Point rand);
-    int getEvenNum (int randStart, int randEnd);
-    Point generateEvenPoint (int rStart, int rEnd, int cStart, int cEnd);
-    int findDirection (Point one, Point two);
+    bool generateEvenPoint (int quad, Point& p);
 private:
-    Point m_lastCellAttacked;
-    Point m_lastCellTried;
-    Point m_transition;
-    vector <Point> m_points;
-    vector <Point> cross;
-    bool switchdir;
     int m_state;
     int nextPoint;
-    
-    /*
-    int m_try;
-    int m_firsttry;
-    bool firstattempt;
-    Point middle;
-    Point consecutivepoint;
-    bool didhit;
-    */
+    PlacementTable m_table;
+    LayoutSampler m_sampler;
+    CellPool m_unshot;
+    vector <int> m_even[4];     // checkerboard cells of each quadrant, not yet shot
+    TargetFrontier m_frontier;
 };
 
 GoodPlayer::GoodPlayer(string nm, const Game& g)
-: Player(nm, g), m_lastCellAttacked(0, 0), m_lastCellTried(0,0), m_state(1), nextPoint(1), m_transition(0, 0), switchdir(false)
-{}
+: Player(nm, g), m_state(1), nextPoint(1),
+  m_table(g), m_sampler(m_table), m_unshot(g.rows(), g.cols()),
+  m_frontier(g.rows(), g.cols())
+{
+    // think of board as a checkerboard, and split the cells of one color
+    // into the four quadrants
+    int midrow = (g.rows() / 2);
+    int midcol = (g.cols() / 2);
+    for (int r = 0; r < g.rows(); r++){
+        for (int c = 0; c < g.cols(); c++){
+            if ((r + c) % 2 != 0)
+                continue;
+            int quad;
+            if (r < midrow)
+                quad = (c < midcol ? 1 : 4);
+            else
+                quad = (c < midcol ? 2 : 3);
+            m_even[quad - 1].push_back(Bitboard::index(r, c));
+        }
+    }
+}
 
 int GoodPlayer::randInt(int start, int limit){
-    static std::random_device rd;
-    static std::mt19937 generator(rd());
+    // draw from the shared generator so seedRandom covers this player too
     std::uniform_int_distribution<> distro(start, limit-1);
-    return distro(generator);
+    return distro(randomGenerator());
 }
 
 // a call to recommendAttack, then Board::attack, then recordAttackResult must not take more than 5 seconds
 
 bool GoodPlayer::placeShips(Board& b)
 {
-    int rows = game().rows();
-    int cols = game().cols();
-    int ships = game().nShips();
-    Direction dir;
-    list <int> quad;
-    bool check = 0;
-    int count = 0;
-
-    // ?
-    int num = 0;
-    int midrow = (rows / 2);
-    int midcol = (cols / 2);
-    
-    for (int i = 1; i < 5; i ++){
-        quad.push_back(i);  // 4 quads
-    }
-    
-    for (int i = 0; i < game().nShips(); i++){
-        check = 0;
-        
-        if (count < 100){
-            while (!check){
-                Point initialPlacement(randInt(0, rows), randInt(0, cols));
-                int d = randInt(0, 2);
-                if (d == 0){
-                    dir = HORIZONTAL;
-                }
-                else if (d == 1){
-                    dir = VERTICAL;
-                }
-                
-                if (b.placeShip(initialPlacement, i, dir)){
-                    check = 1;
-                }
-                count++;
-            }
-        }
-        
-    }
-    
+    // a uniformly random layout, rather than ships placed one at a time by
+    // retrying, which favored some layouts and spun forever when a ship no
+    // longer fit
+    vector<int> layout;
+    if (!m_sampler.sample(layout))
+        return false;
+    placeLayout(m_table, layout, b);
     return true;
 }
 
-bool GoodPlayer::repeat(Point rand){
-    for (int i = 0; i < m_points.size(); i++){
-        if (rand.r == m_points[i].r && rand.c == m_points[i].c){
+bool GoodPlayer::generateEvenPoint (int quad, Point& p) {
+    // draw from the quadrant's checkerboard cells, crossing off any that
+    // were shot while targeting a ship
+    vector<int>& cells = m_even[quad - 1];
+    while (!cells.empty()) {
+        int k = randInt(0, (int)cells.size());
+        p = Bitboard::point(cells[k]);
+        cells[k] = cells.back();
+        cells.pop_back();
+        if (m_unshot.contains(p)) {
             return true;
         }
     }
@@ -654,210 +601,465 @@ bool GoodPlayer::repeat(Point rand){
     return false;
 }
 
-int GoodPlayer::findDirection (Point one, Point two){
-    if (one.c == two.c && one.r < two.r){
-        // NORTH
-        return 1;
-    }
+Point GoodPlayer::recommendAttack()
+{
+    Point p(0, 0);
     
-    else if (one.r == two.r && one.c > two.c){
-        //EAST
-        return 2;
+    // hit ship but not destroyed: follow the frontier around the hits
+    if (m_state == 2 && m_frontier.nextTarget(p)) {
+        m_unshot.remove(p);
+        return p;
     }
     
-    else if (one.c == two.c && one.r > two.c){
-        // SOUTH
-        return 3;
+    // valid shot but missed or just destroyed a ship: pick checkerboard
+    // cells, moving on the tuned number of quadrants after each shot and
+    // skipping any that are used up
+    for (int k = 0; k < 4; k++) {
+        int quad = nextPoint;
+        if (generateEvenPoint(quad, p)) {
+            nextPoint = (quad - 1 + tuned(TUNE_QUADRANT_STEP)) % 4 + 1;
+            m_unshot.remove(p);
+            return p;
+        }
+        nextPoint = nextPoint % 4 + 1;
     }
     
-    else if (one.r == two.r && one.c < two.c){
-        // WEST
-        return 4;
-    }
+    // every checkerboard cell has been shot
+    if (m_unshot.empty())
+        return p;
+    return m_unshot.draw();
 }
 
-int GoodPlayer::getEvenNum (int randStart, int randEnd) {
-    int num = 1;
+
+void GoodPlayer::recordAttackResult(Point p, bool validShot, bool shotHit, bool shipDestroyed, int shipId )
+{
+    if (!validShot)
+        return;
     
-    while (num % 2 != 0 ) {
-        num = randInt(randStart, randEnd);
-    }
+    int sunkLength = 0;
+    if (shipDestroyed && shipId >= 0 && shipId < game().nShips())
+        sunkLength = game().shipLength(shipId);
+    m_frontier.record(p, shotHit, shipDestroyed, sunkLength);
     
-    return num;
+    // state 2 while some hit is not yet part of a sunk ship
+    m_state = (m_frontier.active() ? 2 : 1);
 }
 
-Point GoodPlayer::generateEvenPoint (int rStart, int rEnd, int cStart, int cEnd) {
-    Point temp(getEvenNum(rStart, rEnd), getEvenNum(cStart, cEnd));
-    
-    while (repeat(temp)) {
-        temp.r = getEvenNum(rStart, rEnd);
-        temp.c = getEvenNum(cStart, cEnd);
+void GoodPlayer::recordAttackByOpponent(Point p)
+{
+
+}
+
+
+
+
+//*********************************************************************
+//  AdaptivePlayer
+//*********************************************************************
+
+// Attacks like a MediocrePlayer, but learns where its opponent shoots and
+// places its ships where the opponent has shot least.  What it learns lasts
+// for the match open on its thread (MatchModels in OpponentModel.h), as
+// tournaments open one every MATCH_GAMES games, or else for the one game;
+// either way a seeded tournament plays the same every time.  The type
+// "adaptive:" followed by a path keeps what it learns in that file instead,
+// so every player given the path learns together, across games and runs
+// (and tournaments with it no longer repeat).
+
+const string ADAPTIVE_PREFIX = "adaptive:";
+
+static bool isAdaptiveFileType(const string& type)
+{
+    return type.compare(0, ADAPTIVE_PREFIX.size(), ADAPTIVE_PREFIX) == 0;
+}
+
+class AdaptivePlayer final : public Player
+{
+public:
+    // modelPath is the file to learn into, or empty to learn in memory
+    AdaptivePlayer(string nm, const Game& g, string modelPath = "");
+    virtual ~AdaptivePlayer() {}
+    virtual bool placeShips(Board& b);
+    virtual Point recommendAttack();
+    virtual void recordAttackResult(Point p, bool validShot, bool shotHit,
+                                    bool shipDestroyed, int shipId);
+    virtual void recordAttackByOpponent(Point p);
+private:
+    MediocrePlayer m_attacker;
+    unique_ptr<OpponentModel> m_ownModel;   // when there is no match to learn in
+    OpponentModel* m_model;
+};
+
+AdaptivePlayer::AdaptivePlayer(string nm, const Game& g, string modelPath)
+: Player(nm, g), m_attacker(nm, g), m_model(nullptr)
+{
+    if (modelPath.empty()  &&  MatchModels::current() != nullptr)
+        m_model = &MatchModels::current()->model(nm, g);
+    else
+    {
+        m_ownModel.reset(modelPath.empty() ? new OpponentModel(g) : new OpponentModel(modelPath, g));
+        m_model = m_ownModel.get();
     }
-    
-    return temp;
 }
 
-Point GoodPlayer::recommendAttack()
+bool AdaptivePlayer::placeShips(Board& b)
+{
+    // if the model file could not be mapped, or the model finds no layout,
+    // place ships the way the mediocre player does
+    if (m_model->ok()  &&  m_model->placeShips(b))
+        return true;
+    return m_attacker.placeShips(b);
+}
+
+Point AdaptivePlayer::recommendAttack()
+{
+    return m_attacker.recommendAttack();
+}
+
+void AdaptivePlayer::recordAttackResult(Point p, bool validShot, bool shotHit,
+                                        bool shipDestroyed, int shipId)
+{
+    m_attacker.recordAttackResult(p, validShot, shotHit, shipDestroyed, shipId);
+}
+
+void AdaptivePlayer::recordAttackByOpponent(Point p)
+{
+    m_model->recordShot(p);
+}
+
+
+
+//*********************************************************************
+//  DensityPlayer
+//*********************************************************************
+
+// nodes the endgame search may visit a move, in the density, optimal and
+// equilibrium players; a node budget rather than a time budget keeps
+// seeded games the same however busy the machine is
+const long long ENDGAME_NODES = 20000;
+
+// Attacks with a DensityHunter, which plays the endgame exactly once few
+// layouts remain (searching up to ENDGAME_NODES nodes a move, about 20ms).
+// If there is a layout library made for this game in layouts.bsl (see
+// tools/optimize_layouts.cpp), it places one of those layouts; otherwise it
+// places its ships at random.
+
+class DensityPlayer final : public Player
+{
+public:
+    DensityPlayer(string nm, const Game& g);
+    virtual ~DensityPlayer() {}
+    virtual bool placeShips(Board& b);
+    virtual Point recommendAttack();
+    virtual vector<Point> recommendAttacks(int k);
+    virtual void recordAttackResult(Point p, bool validShot, bool shotHit,
+                                    bool shipDestroyed, int shipId);
+    virtual void recordAttackByOpponent(Point p);
+private:
+    PlacementTable m_table;
+    DensityHunter m_hunter;
+};
+
+DensityPlayer::DensityPlayer(string nm, const Game& g)
+: Player(nm, g), m_table(g), m_hunter(m_table, ENDGAME_NODES)
+{}
+
+bool DensityPlayer::placeShips(Board& b)
 {
-    // think of board as a checkerboard, pick even coords
-    int midrow = (game().rows() / 2);
-    int midcol = (game().cols() / 2);
-    int row = game().rows();
-    int col = game().cols();
+    const LayoutLibrary* library = LayoutLibrary::shared("layouts.bsl", game());
+    if (library != nullptr  &&  library->place(b))
+        return true;
     
-    // valid shot but missed or just destroyed a ship
-    if (m_state == 1) {
+    vector<int> layout;
+    if (!randomLayout(m_table, layout))
+        return false;
+    placeLayout(m_table, layout, b);
+    return true;
+}
 
-        Point inQuad(0, 0);
-        
-        switch (nextPoint) {
-            case 1:
-                inQuad = generateEvenPoint(0, midrow, 0, midcol);
-                nextPoint = 2;
-                break;
-                
-            case 2:
-                inQuad = generateEvenPoint(midrow, row, 0, midcol);
-                nextPoint = 3;
-                break;
-                
-            case 3:
-                inQuad = generateEvenPoint(midrow, row, midcol, col);
-                nextPoint = 4;
-                break;
-                
-            case 4:
-                inQuad = generateEvenPoint(0, midrow, midcol, col);
-                nextPoint = 1;
-                break;
-                
-            default:
-                cout << "Error: GoodPlayer recommendAttack() nextPoint out of bounds" << endl;
-                break;
-        }
-        
-        m_points.push_back(inQuad);
-        return inQuad;
+Point DensityPlayer::recommendAttack()
+{
+    return m_hunter.recommendAttack();
+}
+
+vector<Point> DensityPlayer::recommendAttacks(int k)
+{
+    return m_hunter.recommendAttacks(k);
+}
+
+void DensityPlayer::recordAttackResult(Point p, bool validShot, bool shotHit,
+                                       bool shipDestroyed, int shipId)
+{
+    m_hunter.recordAttackResult(p, validShot, shotHit, shipDestroyed, shipId);
+}
+
+void DensityPlayer::recordAttackByOpponent(Point /* p */)
+{
+    // DensityPlayer ignores what the opponent does
+}
+
+
+
+//*********************************************************************
+//  OptimalPlayer
+//*********************************************************************
+
+// Plays perfectly on boards solved by tools/solve_small.cpp: if policy.bsp
+// holds a policy for this game, it tracks its knowledge state and shoots
+// where the policy says.  Otherwise (or if it somehow reaches a state the
+// policy does not know) it attacks like DensityPlayer.  It places its ships
+// uniformly at random, as the policy assumes its opponent does.
+
+class OptimalPlayer final : public Player
+{
+public:
+    OptimalPlayer(string nm, const Game& g);
+    virtual ~OptimalPlayer() {}
+    virtual bool placeShips(Board& b);
+    virtual Point recommendAttack();
+    virtual vector<Point> recommendAttacks(int k);
+    virtual void recordAttackResult(Point p, bool validShot, bool shotHit,
+                                    bool shipDestroyed, int shipId);
+    virtual void recordAttackByOpponent(Point p);
+private:
+    PlacementTable m_table;
+    DensityHunter m_hunter;
+    const PolicyTable* m_policy;
+    StateKey m_state;
+};
+
+OptimalPlayer::OptimalPlayer(string nm, const Game& g)
+: Player(nm, g), m_table(g), m_hunter(m_table, ENDGAME_NODES),
+  m_policy(PolicyTable::shared("policy.bsp", g))
+{
+    if (m_policy != nullptr)
+        m_state = m_policy->space().initialState();
+}
+
+bool OptimalPlayer::placeShips(Board& b)
+{
+    vector<int> layout;
+    if (!randomLayout(m_table, layout))
+        return false;
+    placeLayout(m_table, layout, b);
+    return true;
+}
+
+Point OptimalPlayer::recommendAttack()
+{
+    if (m_policy != nullptr)
+    {
+        int cell = m_policy->bestCell(m_state);
+        if (cell >= 0)
+            return Bitboard::point(cell);
     }
-    
-    // hit ship but not destroyed
-    else if (m_state == 2) { }
-    Point temp(0, 0);
-    
-    return temp;
-    
+    return m_hunter.recommendAttack();
 }
 
+vector<Point> OptimalPlayer::recommendAttacks(int k)
+{
+    // the policy was solved for one shot a turn, so a salvo is chosen by
+    // density alone
+    if (k == 1)
+        return vector<Point>(1, recommendAttack());
+    return m_hunter.recommendAttacks(k);
+}
 
-void GoodPlayer::recordAttackResult(Point p, bool validShot, bool shotHit, bool shipDestroyed, int shipId )
+void OptimalPlayer::recordAttackResult(Point p, bool validShot, bool shotHit,
+                                       bool shipDestroyed, int shipId)
 {
-    // P would be the rand point returned from recommendAttack
-    
-    // if it is a valid shot and it missed
-    if (validShot && !shotHit){
-        m_state = 1;
+    m_hunter.recordAttackResult(p, validShot, shotHit, shipDestroyed, shipId);
+    if (m_policy != nullptr  &&  validShot)
+        m_state = m_policy->space().observe(m_state, p, shotHit, shipDestroyed, shipId);
+}
+
+void OptimalPlayer::recordAttackByOpponent(Point /* p */)
+{
+    // OptimalPlayer ignores what the opponent does
+}
+
+
+
+//*********************************************************************
+//  EquilibriumPlayer
+//*********************************************************************
+
+// Plays the equilibrium of a small board made by
+// tools/solve_equilibrium.cpp: if equilibrium.bse holds one for this game,
+// it places a layout drawn from the equilibrium distribution and attacks
+// with a policy drawn from the equilibrium mix, seen through a random
+// symmetry of the board.  Otherwise it plays like DensityPlayer with random
+// placement.
+
+class EquilibriumPlayer final : public Player
+{
+public:
+    EquilibriumPlayer(string nm, const Game& g);
+    virtual ~EquilibriumPlayer() {}
+    virtual bool placeShips(Board& b);
+    virtual Point recommendAttack();
+    virtual vector<Point> recommendAttacks(int k);
+    virtual void recordAttackResult(Point p, bool validShot, bool shotHit,
+                                    bool shipDestroyed, int shipId);
+    virtual void recordAttackByOpponent(Point p);
+private:
+    PlacementTable m_table;
+    DensityHunter m_hunter;
+    const MixedStrategy* m_strategy;
+    int m_policy;
+    int m_symmetry;
+    StateKey m_state;
+};
+
+EquilibriumPlayer::EquilibriumPlayer(string nm, const Game& g)
+: Player(nm, g), m_table(g), m_hunter(m_table, ENDGAME_NODES),
+  m_strategy(MixedStrategy::shared("equilibrium.bse", g)), m_policy(-1), m_symmetry(0)
+{
+    if (m_strategy != nullptr)
+    {
+        m_policy = m_strategy->drawPolicy();
+        m_symmetry = randInt(m_strategy->space().nSymmetries());
+        m_state = m_strategy->space().initialState();
     }
-    
-    if (validShot && shotHit && shipDestroyed){
-        m_state = 1;
+}
+
+bool EquilibriumPlayer::placeShips(Board& b)
+{
+    if (m_strategy != nullptr  &&  m_strategy->place(b))
+        return true;
+    vector<int> layout;
+    if (!randomLayout(m_table, layout))
+        return false;
+    placeLayout(m_table, layout, b);
+    return true;
+}
+
+Point EquilibriumPlayer::recommendAttack()
+{
+    if (m_strategy != nullptr)
+    {
+        int cell = m_strategy->bestCell(m_policy, m_symmetry, m_state);
+        if (cell >= 0)
+            return Bitboard::point(cell);
     }
- 
-    // hit a ship but did not destroy it
-    if (validShot && shotHit && !shipDestroyed){
-        
-        // point that caused the transition from state 1 to state 2 (first hit of a ship)
-        if (m_state == 1){
-            // record point and test for direction
-            m_transition = p;
-            
-            // up
-            p.c + 1
-            
-            // down
-            p.c - 1
-            
-            // left
-            p.r - 1
-            
-            // right
-            p.r + 1
-        }
-        
-        if (m_state == 2) {
-            firstattempt = true;
-            didhit = true;
-            // DO NOT CHANGE DIRECTIONS
-            consecutivepoint = p;
+    return m_hunter.recommendAttack();
+}
+
+vector<Point> EquilibriumPlayer::recommendAttacks(int k)
+{
+    // the equilibrium was solved for one shot a turn, so a salvo is chosen by
+    // density alone
+    if (k == 1)
+        return vector<Point>(1, recommendAttack());
+    return m_hunter.recommendAttacks(k);
+}
+
+void EquilibriumPlayer::recordAttackResult(Point p, bool validShot, bool shotHit,
+                                           bool shipDestroyed, int shipId)
+{
+    m_hunter.recordAttackResult(p, validShot, shotHit, shipDestroyed, shipId);
+    if (m_strategy != nullptr  &&  validShot)
+        m_state = m_strategy->space().observe(m_state, p, shotHit, shipDestroyed, shipId);
+}
+
+void EquilibriumPlayer::recordAttackByOpponent(Point /* p */)
+{
+    // EquilibriumPlayer ignores what the opponent does
+}
+
+
+
+//*********************************************************************
+//  ExternalPlayer
+//*********************************************************************
+
+// Plays through a bot program (see ExternalBot.h).  The type "external:"
+// followed by the program's path makes one.  If the bot cannot be
+// started, exits or answers nonsense, placeShips fails and its attacks
+// are invalid.
+
+const string EXTERNAL_PREFIX = "external:";
+
+bool isExternalType(const string& type)
+{
+    return type.compare(0, EXTERNAL_PREFIX.size(), EXTERNAL_PREFIX) == 0;
+}
+
+class ExternalPlayer final : public Player
+{
+public:
+    ExternalPlayer(string nm, const Game& g, string path);
+    virtual ~ExternalPlayer();
+    virtual bool placeShips(Board& b);
+    virtual Point recommendAttack();
+    virtual void recordAttackResult(Point p, bool validShot, bool shotHit,
+                                    bool shipDestroyed, int shipId);
+    virtual void recordAttackByOpponent(Point p);
+private:
+    unique_ptr<BotProcess> m_bot;
+};
+
+ExternalPlayer::ExternalPlayer(string nm, const Game& g, string path)
+: Player(nm, g), m_bot(BotProcess::acquire(path))
+{
+    string header = "game " + to_string(g.rows()) + " " + to_string(g.cols()) +
+                    " " + to_string(g.nShips());
+    for (int i = 0; i < g.nShips(); i++)
+        header += " " + to_string(g.shipLength(i));
+    m_bot->send(header);
+}
+
+ExternalPlayer::~ExternalPlayer()
+{
+    BotProcess::release(move(m_bot));
+}
+
+bool ExternalPlayer::placeShips(Board& b)
+{
+    string reply;
+    if (!m_bot->request("place", reply))
+        return false;
+    istringstream in(reply);
+    for (int i = 0; i < game().nShips(); i++)
+    {
+        int r;
+        int c;
+        char d;
+        if (!(in >> r >> c >> d)  ||  (d != 'h'  &&  d != 'v')  ||
+            !b.placeShip(Point(r, c), i, d == 'h' ? HORIZONTAL : VERTICAL))
+        {
+            b.clear();
+            return false;
         }
-        
-        m_state = 2;
     }
-    
-    // ----------------------------------------------------
-    /*
-     // hit before, missed next
-     if (m_state == 2){
-     // go back and try another direction
-     p = m_lastCellAttacked;
-     m_try++;
-     switchdir = true;
-     return;
-     }
-     
-     if (m_firsttry > 12){
-     m_firsttry = 0;
-     }
-     
-     m_state = 1;
-     firstattempt = false;
-     m_firsttry++;
-     }
-     
-     // if it hit and destroyed a ship
-     if (validShot && shotHit && shipDestroyed){
-     m_state = 3;
-     // reset middle, cause will be going back to state 1
-     middle = m_lastCellTried;
-     m_try = 0;
-     }
-     
-     // hit a ship but did not destroy it
-     if (validShot && shotHit && !shipDestroyed){
-     
-     if (m_try > 3){
-     m_try = 0;
-     }
-     
-     // point that caused the transition from state 1 to state 2
-     if (m_state == 1 || m_state == 3){
-     m_transition = p;
-     }
-     
-     if (m_state == 2) {
-     firstattempt = true;
-     didhit = true;
-     // DO NOT CHANGE DIRECTIONS
-     consecutivepoint = p;
-     }
-     
-     m_state = 2;
-     // if came from state 1 --> lastcelltried is the one that was from the formation???
-     // we basically need the last point returned before the call
-     m_lastCellTried = p;
-     // reset
-     m_try = 0;
-     firstattempt = true;
-     switchdir = false;
-
-     }
-     */
+    return true;
 }
 
-void GoodPlayer::recordAttackByOpponent(Point p)
+Point ExternalPlayer::recommendAttack()
 {
+    string reply;
+    Point p(-1, -1);
+    if (m_bot->request("attack", reply))
+    {
+        istringstream in(reply);
+        if (!(in >> p.r >> p.c))
+            p = Point(-1, -1);
+    }
+    return p;
+}
 
+void ExternalPlayer::recordAttackResult(Point p, bool validShot, bool shotHit,
+                                        bool shipDestroyed, int shipId)
+{
+    m_bot->send("result " + to_string(p.r) + " " + to_string(p.c) + " " +
+                to_string(validShot) + " " + to_string(shotHit) + " " +
+                to_string(shipDestroyed) + " " + to_string(shipDestroyed ? shipId : -1));
 }
 
+void ExternalPlayer::recordAttackByOpponent(Point p)
+{
+    m_bot->send("opponent " + to_string(p.r) + " " + to_string(p.c));
+}
 
 
 
@@ -865,22 +1067,96 @@ void GoodPlayer::recordAttackByOpponent(Point p)
 //  createPlayer
 //*********************************************************************
 
+// Every computer player type and its class, in one list, from which
+// createPlayer, the static dispatch below and computerPlayerTypes are all
+// made, so a type cannot be missing from any of them
+#define COMPUTER_PLAYERS(X)                 \
+    X("awful",       AwfulPlayer)           \
+    X("mediocre",    MediocrePlayer)        \
+    X("good",        GoodPlayer)            \
+    X("adaptive",    AdaptivePlayer)        \
+    X("density",     DensityPlayer)         \
+    X("optimal",     OptimalPlayer)         \
+    X("equilibrium", EquilibriumPlayer)
+
+const vector<string>& computerPlayerTypes()
+{
+#define PLAYER_NAME(type, Class) type,
+    static const vector<string> types = { COMPUTER_PLAYERS(PLAYER_NAME) };
+#undef PLAYER_NAME
+    return types;
+}
+
 Player* createPlayer(string type, string nm, const Game& g)
 {
-    static string types[] = {
-        "human", "awful", "mediocre", "good"
-    };
-    
-    int pos;
-    for (pos = 0; pos != sizeof(types)/sizeof(types[0])  &&
-         type != types[pos]; pos++)
-        ;
-    switch (pos)
+    if (type == "human")
+        return new HumanPlayer(nm, g);
+#define CREATE_PLAYER(name, Class)          \
+    if (type == name)                       \
+        return new Class(nm, g);
+    COMPUTER_PLAYERS(CREATE_PLAYER)
+#undef CREATE_PLAYER
+    if (isAdaptiveFileType(type))
+        return new AdaptivePlayer(nm, g, type.substr(ADAPTIVE_PREFIX.size()));
+    if (isExternalType(type))
+        return new ExternalPlayer(nm, g, type.substr(EXTERNAL_PREFIX.size()));
+    return nullptr;
+}
+
+
+
+//*********************************************************************
+//  playHeadlessGame
+//*********************************************************************
+
+// Each player object lives on the stack with its exact type known, so
+// playHeadless<P1, P2> is instantiated once per pairing and calls the
+// strategies directly.
+
+template <class P1>
+bool playHeadlessAgainst(P1& p1, string secondType, const Game& g, GameRecord& rec,
+                         vector<ShotRecord>* log, GameObserver* observer)
+{
+#define PLAY_AGAINST(name, Class)                           \
+    if (secondType == name)                                 \
+    {                                                       \
+        Class p2(secondType, g);                            \
+        playHeadless(g, p1, p2, rec, log, observer);        \
+        return true;                                        \
+    }
+    COMPUTER_PLAYERS(PLAY_AGAINST)
+#undef PLAY_AGAINST
+    if (isAdaptiveFileType(secondType))
     {
-        case 0:  return new HumanPlayer(nm, g);
-        case 1:  return new AwfulPlayer(nm, g);
-        case 2:  return new MediocrePlayer(nm, g);
-        case 3:  return new GoodPlayer(nm, g);
-        default: return nullptr;
+        AdaptivePlayer p2(secondType, g, secondType.substr(ADAPTIVE_PREFIX.size()));
+        playHeadless(g, p1, p2, rec, log, observer);
+        return true;
     }
+    if (!isExternalType(secondType))
+        return false;
+    ExternalPlayer p2(secondType, g, secondType.substr(EXTERNAL_PREFIX.size()));
+    playHeadless(g, p1, p2, rec, log, observer);
+    return true;
+}
+
+bool playHeadlessGame(string firstType, string secondType, const Game& g, GameRecord& rec,
+                      vector<ShotRecord>* log, GameObserver* observer)
+{
+#define PLAY_FIRST(name, Class)                                                 \
+    if (firstType == name)                                                      \
+    {                                                                           \
+        Class p1(firstType, g);                                                 \
+        return playHeadlessAgainst(p1, secondType, g, rec, log, observer);      \
+    }
+    COMPUTER_PLAYERS(PLAY_FIRST)
+#undef PLAY_FIRST
+    if (isAdaptiveFileType(firstType))
+    {
+        AdaptivePlayer p1(firstType, g, firstType.substr(ADAPTIVE_PREFIX.size()));
+        return playHeadlessAgainst(p1, secondType, g, rec, log, observer);
+    }
+    if (!isExternalType(firstType))
+        return false;
+    ExternalPlayer p1(firstType, g, firstType.substr(EXTERNAL_PREFIX.size()));
+    return playHeadlessAgainst(p1, secondType, g, rec, log, observer);
 }
@@ -2,10 +2,12 @@
 #define PLAYER_INCLUDED
 
 #include <string>
+#include <vector>
 
 class Point;
 class Board;
 class Game;
+struct ShotResult;
 
 class Player
 {
@@ -27,6 +29,16 @@ public:
                                     bool shipDestroyed, int shipId) = 0;
     virtual void recordAttackByOpponent(Point p) = 0;
     
+    // Salvo play, where a turn is k shots fired at once.  By default a
+    // salvo is k calls of recommendAttack, asking again (a few times) for
+    // a cell already in the salvo, since the results of the salvo's shots
+    // only come once it has been fired; and the results, and the
+    // opponent's shots, are passed on one at a time in the order fired.
+    // A player that can choose its shots better together overrides these.
+    virtual std::vector<Point> recommendAttacks(int k);
+    virtual void recordAttackResults(const std::vector<ShotResult>& results);
+    virtual void recordAttacksByOpponent(const std::vector<Point>& shots);
+    
     // We prevent any kind of Player object from being copied or assigned
     Player(const Player&) = delete;
     Player& operator=(const Player&) = delete;
@@ -38,4 +50,9 @@ private:
 
 Player* createPlayer(std::string type, std::string nm, const Game& g);
 
+// The computer player types createPlayer knows by name, which it and the
+// static dispatch of playHeadlessGame share; besides these it makes
+// "human", "adaptive:path" and "external:path" players
+const std::vector<std::string>& computerPlayerTypes();
+
 #endif // PLAYER_INCLUDED
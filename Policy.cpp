@@ -0,0 +1,1072 @@
+#include "Policy.h"
+#include "Game.h"
+#include "Board.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+using namespace std;
+
+namespace {
+
+struct StateKeyHash
+{
+    size_t operator()(const StateKey& k) const
+    {
+        uint64_t h = 0x9E3779B97F4A7C15ULL;
+        for (size_t i = 0; i < k.size(); i++)
+            h = (h ^ k[i]) * 0x100000001B3ULL + (h >> 29);
+        return h;
+    }
+};
+
+// Call f(thread, i) for every i < n on nThreads threads
+template <class F>
+void parallelFor(size_t n, int nThreads, F f)
+{
+    atomic<size_t> next(0);
+    auto worker = [&](int t) {
+        for (size_t i = next++; i < n; i = next++)
+            f(t, i);
+    };
+    vector<thread> threads;
+    for (int t = 1; t < nThreads; t++)
+        threads.push_back(thread(worker, t));
+    worker(0);
+    for (size_t t = 0; t < threads.size(); t++)
+        threads[t].join();
+}
+
+// The position of k in keys, which holds sorted keys of nWords words each,
+// or -1 if it is not there
+int findKey(const vector<uint64_t>& keys, size_t nWords, const StateKey& k)
+{
+    if (k.size() != nWords)
+        return -1;
+    int lo = 0;
+    int hi = (int)(keys.size() / nWords);
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        const uint64_t* key = &keys[mid * nWords];
+        if (lexicographical_compare(key, key + nWords, k.begin(), k.end()))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo < (int)(keys.size() / nWords)  &&  equal(k.begin(), k.end(), &keys[lo * nWords]))
+        return lo;
+    return -1;
+}
+
+void writeWord(vector<unsigned char>& out, uint64_t n, int nBytes)
+{
+    for (int i = 0; i < nBytes; i++)
+        out.push_back((n >> (8 * i)) & 0xFF);
+}
+
+uint64_t readWord(const unsigned char* p, int nBytes)
+{
+    uint64_t n = 0;
+    for (int i = nBytes - 1; i >= 0; i--)
+        n = n << 8 | p[i];
+    return n;
+}
+
+void writeDouble(vector<unsigned char>& out, double d)
+{
+    uint64_t n;
+    memcpy(&n, &d, 8);
+    writeWord(out, n, 8);
+}
+
+double readDouble(const unsigned char* p)
+{
+    uint64_t n = readWord(p, 8);
+    double d;
+    memcpy(&d, &n, 8);
+    return d;
+}
+
+// Does the file's header (board size, fleet and number of layouts) match
+// space?  Leaves f just past the header.
+bool readHeader(FILE* f, const char* magic, const LayoutSpace& space)
+{
+    const PlacementTable& t = space.table();
+    unsigned char header[7];
+    bool ok = fread(header, 1, 7, f) == 7  &&  memcmp(header, magic, 4) == 0  &&
+              header[4] == t.rows()  &&  header[5] == t.cols()  &&
+              header[6] == t.nShips();
+    for (int s = 0; ok  &&  s < t.nShips(); s++)
+        ok = (fgetc(f) == t.shipLength(s));
+    unsigned char count[4];
+    return ok  &&  fread(count, 1, 4, f) == 4  &&  (int)readWord(count, 4) == space.nLayouts();
+}
+
+void writeHeader(vector<unsigned char>& out, const char* magic, const LayoutSpace& space)
+{
+    const PlacementTable& t = space.table();
+    out.insert(out.end(), magic, magic + 4);
+    out.push_back(t.rows());
+    out.push_back(t.cols());
+    out.push_back(t.nShips());
+    for (int s = 0; s < t.nShips(); s++)
+        out.push_back(t.shipLength(s));
+    writeWord(out, space.nLayouts(), 4);
+}
+
+}
+
+//*********************************************************************
+//  LayoutSpace
+//*********************************************************************
+
+LayoutSpace::LayoutSpace(const Game& g, int maxLayouts)
+: m_table(g), m_ok(true)
+{
+    int nShips = m_table.nShips();
+    if (nShips == 0)
+    {
+        m_ok = false;
+        return;
+    }
+
+    // every layout, with ship 0's position varying slowest; a layout's
+    // placement indices are also kept as one number so that symmetric
+    // images can be looked up
+    unordered_map<uint64_t, int> layoutByCode;
+    vector<int> current(nShips, 0);
+    vector<Bitboard> used(nShips + 1);
+    int s = 0;
+    for (;;)
+    {
+        if (s == nShips)
+        {
+            if (nLayouts() >= maxLayouts)
+            {
+                m_ok = false;
+                break;
+            }
+            uint64_t code = 0;
+            for (int k = 0; k < nShips; k++)
+            {
+                code = code * m_table.placements(k).size() + current[k];
+                m_ships.push_back(m_table.placements(k)[current[k]].mask);
+                m_placements.push_back(current[k]);
+            }
+            layoutByCode[code] = nLayouts();
+            m_fleets.push_back(used[nShips]);
+            s--;
+            current[s]++;
+            continue;
+        }
+
+        // find the next position of ship s clear of the ships before it
+        const vector<ShipPlacement>& list = m_table.placements(s);
+        while (current[s] < (int)list.size()  &&  list[current[s]].mask.intersects(used[s]))
+            current[s]++;
+        if (current[s] < (int)list.size())
+        {
+            used[s + 1] = used[s] | list[current[s]].mask;
+            s++;
+            if (s < nShips)
+                current[s] = 0;
+        }
+        else if (s == 0)
+            break;
+        else
+        {
+            s--;
+            current[s]++;
+        }
+    }
+    if (!m_ok)
+        return;
+
+    // the reflections of the board, and its rotations and transposes too if
+    // it is square
+    int R = m_table.rows();
+    int C = m_table.cols();
+    int nSym = (R == C ? 8 : 4);
+    for (int gi = 0; gi < nSym; gi++)
+    {
+        vector<int> cellMap(MAXROWS * MAXCOLS);
+        vector<int> unmap(MAXROWS * MAXCOLS);
+        for (int i = 0; i < MAXROWS * MAXCOLS; i++)
+            cellMap[i] = unmap[i] = i;
+        for (int r = 0; r < R; r++)
+            for (int c = 0; c < C; c++)
+            {
+                int rr = (gi & 2) ? R - 1 - r : r;
+                int cc = (gi & 1) ? C - 1 - c : c;
+                int to = (gi & 4) ? Bitboard::index(cc, rr) : Bitboard::index(rr, cc);
+                cellMap[Bitboard::index(r, c)] = to;
+                unmap[to] = Bitboard::index(r, c);
+            }
+        m_cellMaps.push_back(cellMap);
+        m_cellUnmaps.push_back(unmap);
+    }
+
+    vector<map<pair<uint64_t, uint64_t>, int>> placementByMask(nShips);
+    for (int k = 0; k < nShips; k++)
+        for (size_t i = 0; i < m_table.placements(k).size(); i++)
+        {
+            Bitboard m = m_table.placements(k)[i].mask;
+            placementByMask[k][make_pair(m.lo(), m.hi())] = (int)i;
+        }
+    for (int gi = 0; gi < nSym; gi++)
+    {
+        vector<int> layoutMap(nLayouts());
+        for (int L = 0; L < nLayouts(); L++)
+        {
+            uint64_t code = 0;
+            for (int k = 0; k < nShips; k++)
+            {
+                Bitboard from = ship(L, k);
+                Bitboard to;
+                while (!from.empty())
+                    to |= Bitboard::bit(m_cellMaps[gi][from.popLowest()]);
+                code = code * m_table.placements(k).size() +
+                       placementByMask[k][make_pair(to.lo(), to.hi())];
+            }
+            layoutMap[L] = layoutByCode[code];
+        }
+        m_layoutMaps.push_back(layoutMap);
+    }
+}
+
+vector<int> LayoutSpace::layout(int L) const
+{
+    int nShips = m_table.nShips();
+    return vector<int>(m_placements.begin() + (size_t)L * nShips,
+                       m_placements.begin() + (size_t)(L + 1) * nShips);
+}
+
+StateKey LayoutSpace::initialState() const
+{
+    vector<int> all(nLayouts());
+    for (int L = 0; L < nLayouts(); L++)
+        all[L] = L;
+    return makeState(Bitboard(), all);
+}
+
+vector<int> LayoutSpace::layouts(const StateKey& k) const
+{
+    vector<int> result;
+    for (size_t w = 2; w < k.size(); w++)
+        for (uint64_t bits = k[w]; bits != 0; bits &= bits - 1)
+            result.push_back((int)(w - 2) * 64 + __builtin_ctzll(bits));
+    return result;
+}
+
+int LayoutSpace::outcome(int L, Bitboard after, int cell) const
+{
+    if (!m_fleets[L].testBit(cell))
+        return 0;
+    for (int s = 0; s < m_table.nShips(); s++)
+        if (ship(L, s).testBit(cell))
+        {
+            if (!after.contains(ship(L, s)))
+                return 1;
+            return 2 + 2 * s + (after.contains(m_fleets[L]) ? 1 : 0);
+        }
+    return 1;
+}
+
+StateKey LayoutSpace::makeState(Bitboard shots, const vector<int>& layouts) const
+{
+    StateKey k(nWords(), 0);
+    Bitboard covered;
+    for (size_t i = 0; i < layouts.size(); i++)
+    {
+        covered |= m_fleets[layouts[i]];
+        k[2 + layouts[i] / 64] |= uint64_t(1) << (layouts[i] % 64);
+    }
+    shots &= covered;
+    k[0] = shots.lo();
+    k[1] = shots.hi();
+    return k;
+}
+
+StateKey LayoutSpace::observe(const StateKey& k, Point p, bool shotHit,
+                              bool shipDestroyed, int shipId) const
+{
+    if (p.r < 0  ||  p.r >= m_table.rows()  ||  p.c < 0  ||  p.c >= m_table.cols())
+        return k;
+    int cell = Bitboard::index(p);
+    Bitboard after = shots(k) | Bitboard::bit(cell);
+    int seen = !shotHit ? 0 : (shipDestroyed ? 2 + 2 * shipId : 1);
+
+    vector<int> all = layouts(k);
+    vector<int> kept;
+    for (size_t i = 0; i < all.size(); i++)
+    {
+        int o = outcome(all[i], after, cell);
+        if ((o >= 2 ? o & ~1 : o) == seen)
+            kept.push_back(all[i]);
+    }
+    return makeState(after, kept);
+}
+
+StateKey LayoutSpace::shoot(const StateKey& k, int L, int cell, bool& gameOver) const
+{
+    Bitboard after = shots(k) | Bitboard::bit(cell);
+    int o = outcome(L, after, cell);
+    gameOver = o >= 2  &&  (o & 1) != 0;
+    return observe(k, Bitboard::point(cell), o != 0, o >= 2, o >= 2 ? (o - 2) / 2 : -1);
+}
+
+StateKey LayoutSpace::image(const StateKey& k, int g) const
+{
+    StateKey result(k.size(), 0);
+    Bitboard from = shots(k);
+    Bitboard to;
+    while (!from.empty())
+        to |= Bitboard::bit(m_cellMaps[g][from.popLowest()]);
+    result[0] = to.lo();
+    result[1] = to.hi();
+    for (size_t w = 2; w < k.size(); w++)
+        for (uint64_t bits = k[w]; bits != 0; bits &= bits - 1)
+        {
+            int L = m_layoutMaps[g][(w - 2) * 64 + __builtin_ctzll(bits)];
+            result[2 + L / 64] |= uint64_t(1) << (L % 64);
+        }
+    return result;
+}
+
+StateKey LayoutSpace::canonical(const StateKey& k, int* symmetry) const
+{
+    StateKey best = k;
+    if (symmetry != nullptr)
+        *symmetry = 0;
+    for (int g = 1; g < nSymmetries(); g++)
+    {
+        StateKey candidate = image(k, g);
+        if (candidate < best)
+        {
+            best.swap(candidate);
+            if (symmetry != nullptr)
+                *symmetry = g;
+        }
+    }
+    return best;
+}
+
+//*********************************************************************
+//  PolicyTable
+//*********************************************************************
+
+PolicyTable::PolicyTable(const Game& g)
+: m_space(g), m_expectedShots(0)
+{}
+
+void PolicyTable::assign(const vector<StateKey>& states, const vector<int>& cells,
+                         double expectedShots)
+{
+    vector<int> order(states.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = (int)i;
+    sort(order.begin(), order.end(), [&states](int a, int b) {
+        return states[a] < states[b];
+    });
+
+    m_keys.clear();
+    m_cells.clear();
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        m_keys.insert(m_keys.end(), states[order[i]].begin(), states[order[i]].end());
+        m_cells.push_back(cells[order[i]]);
+    }
+    m_expectedShots = expectedShots;
+}
+
+int PolicyTable::bestCell(const StateKey& k) const
+{
+    int symmetry;
+    int i = findKey(m_keys, m_space.nWords(), m_space.canonical(k, &symmetry));
+    if (i < 0)
+        return -1;
+    return m_space.unmapCell(symmetry, m_cells[i]);
+}
+
+bool PolicyTable::save(string path) const
+{
+    FILE* f = fopen(path.c_str(), "wb");
+    if (f == nullptr)
+        return false;
+
+    vector<unsigned char> out;
+    writeHeader(out, "BSOP", m_space);
+    writeWord(out, size(), 4);
+    writeWord(out, (uint64_t)(m_expectedShots * 1e6 + 0.5), 8);
+    for (int i = 0; i < size(); i++)
+    {
+        for (int w = 0; w < m_space.nWords(); w++)
+            writeWord(out, m_keys[(size_t)i * m_space.nWords() + w], 8);
+        out.push_back(m_cells[i]);
+    }
+
+    bool ok = fwrite(&out[0], 1, out.size(), f) == out.size();
+    return fclose(f) == 0  &&  ok;
+}
+
+bool PolicyTable::load(string path)
+{
+    if (!m_space.ok())
+        return false;
+    FILE* f = fopen(path.c_str(), "rb");
+    if (f == nullptr)
+        return false;
+
+    unsigned char counts[12];
+    bool ok = readHeader(f, "BSOP", m_space)  &&  fread(counts, 1, 12, f) == 12;
+    if (ok)
+    {
+        size_t n = readWord(counts, 4);
+        size_t entrySize = 8 * m_space.nWords() + 1;
+        vector<unsigned char> data(n * entrySize);
+        ok = data.empty()  ||  fread(&data[0], 1, data.size(), f) == data.size();
+        if (ok)
+        {
+            m_keys.clear();
+            m_cells.clear();
+            for (size_t i = 0; i < n; i++)
+            {
+                const unsigned char* p = &data[i * entrySize];
+                for (int w = 0; w < m_space.nWords(); w++)
+                    m_keys.push_back(readWord(p + 8 * w, 8));
+                m_cells.push_back(p[entrySize - 1]);
+            }
+            m_expectedShots = readWord(counts + 4, 8) / 1e6;
+        }
+    }
+    fclose(f);
+    return ok;
+}
+
+// Is t set up for the same board and fleet as g?
+static bool sameGame(const PlacementTable& t, const Game& g)
+{
+    if (t.rows() != g.rows()  ||  t.cols() != g.cols()  ||  t.nShips() != g.nShips())
+        return false;
+    for (int s = 0; s < g.nShips(); s++)
+        if (t.shipLength(s) != g.shipLength(s))
+            return false;
+    return true;
+}
+
+// What a table or strategy loaded from path for games set up like g is
+// cached under: the file is read once for each board and fleet, so a game
+// it failed to load for does not make it fail for another
+static string sharedKey(const string& path, const Game& g)
+{
+    ostringstream key;
+    key << g.rows() << "x" << g.cols();
+    for (int s = 0; s < g.nShips(); s++)
+        key << " " << g.shipLength(s);
+    key << " " << path;
+    return key.str();
+}
+
+const PolicyTable* PolicyTable::shared(string path, const Game& g)
+{
+    static mutex policyMutex;
+    static map<string, unique_ptr<PolicyTable>> policies;
+    static map<string, bool> loaded;
+
+    lock_guard<mutex> lock(policyMutex);
+    string key = sharedKey(path, g);
+    unique_ptr<PolicyTable>& policy = policies[key];
+    if (!policy)
+    {
+        policy.reset(new PolicyTable(g));
+        loaded[key] = policy->load(path);
+    }
+
+    // a policy made for another fleet is no use to this game
+    if (!loaded[key]  ||  !sameGame(policy->m_space.table(), g))
+        return nullptr;
+    return policy.get();
+}
+
+//*********************************************************************
+//  KnowledgeGraph
+//*********************************************************************
+
+KnowledgeGraph::KnowledgeGraph(const LayoutSpace& space, int nThreads, size_t maxStates)
+: m_space(space), m_nThreads(nThreads), m_ok(false)
+{
+    if (m_nThreads <= 0)
+        m_nThreads = max(1u, thread::hardware_concurrency());
+    if (!space.ok()  ||  space.nLayouts() == 0)
+        return;
+
+    // The shots worth taking in each state, and the canonical states they
+    // can lead to.  A cell no layout covers is a certain miss, and never
+    // worth a shot.  Outcomes that end the game lead nowhere.
+    struct Move
+    {
+        int cell;
+        vector<StateKey> next;
+    };
+    auto expand = [&space](const StateKey& k, vector<Move>& moves) {
+        moves.clear();
+        vector<int> layouts = space.layouts(k);
+        Bitboard shots = space.shots(k);
+        Bitboard covered;
+        for (size_t i = 0; i < layouts.size(); i++)
+            covered |= space.fleet(layouts[i]);
+        Bitboard candidates = covered.without(shots);
+        vector<pair<int, int>> outcomes(layouts.size());
+        while (!candidates.empty())
+        {
+            int cell = candidates.popLowest();
+            Bitboard after = shots | Bitboard::bit(cell);
+            for (size_t i = 0; i < layouts.size(); i++)
+                outcomes[i] = make_pair(space.outcome(layouts[i], after, cell), layouts[i]);
+            sort(outcomes.begin(), outcomes.end());
+
+            Move m;
+            m.cell = cell;
+            for (size_t i = 0; i < outcomes.size(); )
+            {
+                size_t j = i;
+                vector<int> group;
+                while (j < outcomes.size()  &&  outcomes[j].first == outcomes[i].first)
+                    group.push_back(outcomes[j++].second);
+                int o = outcomes[i].first;
+                if (o < 2  ||  (o & 1) == 0)
+                    m.next.push_back(space.canonical(space.makeState(after, group)));
+                i = j;
+            }
+            moves.push_back(m);
+        }
+    };
+
+    // find every reachable canonical state, a wave at a time, recording
+    // each state's moves as the wave is merged
+    unordered_map<StateKey, int, StateKeyHash> index;
+    m_states.push_back(space.canonical(space.initialState()));
+    index[m_states[0]] = 0;
+    m_moveStart.push_back(0);
+    m_nextStart.push_back(0);
+    size_t waveStart = 0;
+    while (waveStart < m_states.size())
+    {
+        size_t waveEnd = m_states.size();
+        vector<vector<Move>> found(waveEnd - waveStart);
+        parallelFor(waveEnd - waveStart, m_nThreads, [&](int, size_t i) {
+            expand(m_states[waveStart + i], found[i]);
+        });
+        for (size_t i = 0; i < found.size(); i++)
+        {
+            for (size_t m = 0; m < found[i].size(); m++)
+            {
+                const Move& move = found[i][m];
+                for (size_t j = 0; j < move.next.size(); j++)
+                {
+                    unordered_map<StateKey, int, StateKeyHash>::const_iterator it =
+                        index.find(move.next[j]);
+                    if (it != index.end())
+                    {
+                        m_next.push_back(it->second);
+                        continue;
+                    }
+                    if (m_states.size() >= maxStates)
+                        return;
+                    index[move.next[j]] = (int)m_states.size();
+                    m_next.push_back((int)m_states.size());
+                    m_states.push_back(move.next[j]);
+                }
+                m_moveCell.push_back(move.cell);
+                m_nextStart.push_back((int)m_next.size());
+            }
+            m_moveStart.push_back((int)m_moveCell.size());
+            found[i].clear();
+        }
+        waveStart = waveEnd;
+    }
+
+    m_sorted.resize(m_states.size());
+    for (size_t i = 0; i < m_sorted.size(); i++)
+        m_sorted[i] = (int)i;
+    sort(m_sorted.begin(), m_sorted.end(), [this](int a, int b) {
+        return m_states[a] < m_states[b];
+    });
+
+    // states with the same number of unshot ship cells can be valued at once
+    vector<int> unshot(m_states.size());
+    parallelFor(m_states.size(), m_nThreads, [&](int, size_t i) {
+        vector<int> layouts = space.layouts(m_states[i]);
+        int total = 0;
+        for (size_t j = 0; j < layouts.size(); j++)
+            total += space.fleet(layouts[j]).without(space.shots(m_states[i])).count();
+        unshot[i] = total;
+    });
+    m_order = m_sorted;
+    sort(m_order.begin(), m_order.end(), [&unshot](int a, int b) {
+        return unshot[a] < unshot[b];
+    });
+    for (size_t i = 0; i < m_order.size(); i++)
+        if (i == 0  ||  unshot[m_order[i]] != unshot[m_order[i - 1]])
+            m_waves.push_back((int)i);
+    m_waves.push_back((int)m_order.size());
+    m_ok = true;
+}
+
+int KnowledgeGraph::find(const StateKey& canonicalState) const
+{
+    int lo = 0;
+    int hi = size();
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        if (m_states[m_sorted[mid]] < canonicalState)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo < size()  &&  m_states[m_sorted[lo]] == canonicalState)
+        return m_sorted[lo];
+    return -1;
+}
+
+void KnowledgeGraph::successors(int s, int cell, vector<int>& next) const
+{
+    next.clear();
+    for (int m = m_moveStart[s]; m < m_moveStart[s + 1]; m++)
+        if (m_moveCell[m] == cell)
+            next.assign(m_next.begin() + m_nextStart[m], m_next.begin() + m_nextStart[m + 1]);
+}
+
+double KnowledgeGraph::solve(const vector<double>& weights, vector<int>& cells) const
+{
+    cells.assign(size(), -1);
+    if (!m_ok)
+        return 0;
+
+    // a state's weight is its layouts' total; one that cannot happen under
+    // these weights is valued as if its layouts were equally likely
+    vector<double> total(size());
+    vector<double> count(size());
+    parallelFor(size(), m_nThreads, [&](int, size_t s) {
+        vector<int> layouts = m_space.layouts(m_states[s]);
+        double sum = 0;
+        for (size_t i = 0; i < layouts.size(); i++)
+            sum += weights[layouts[i]];
+        total[s] = sum;
+        count[s] = (double)layouts.size();
+    });
+
+    vector<double> values(size(), 0);
+    for (size_t w = 0; w + 1 < m_waves.size(); w++)
+    {
+        int first = m_waves[w];
+        parallelFor(m_waves[w + 1] - first, m_nThreads, [&](int, size_t i) {
+            int s = m_order[first + i];
+            bool weighted = total[s] > 0;
+            double best = 1e18;
+            for (int m = m_moveStart[s]; m < m_moveStart[s + 1]; m++)
+            {
+                double value = 1;
+                for (int j = m_nextStart[m]; j < m_nextStart[m + 1]; j++)
+                {
+                    int next = m_next[j];
+                    value += (weighted ? total[next] / total[s] : count[next] / count[s]) *
+                             values[next];
+                }
+                if (value < best - 1e-12)
+                {
+                    best = value;
+                    cells[s] = m_moveCell[m];
+                }
+            }
+            values[s] = best;
+        });
+    }
+    return values[0];
+}
+
+bool solveOptimalPolicy(PolicyTable& policy, int nThreads, size_t maxStates)
+{
+    KnowledgeGraph graph(policy.space(), nThreads, maxStates);
+    if (!graph.ok())
+        return false;
+    vector<int> cells;
+    double value = graph.solve(vector<double>(policy.space().nLayouts(), 1.0), cells);
+    vector<StateKey> states(graph.size());
+    for (int s = 0; s < graph.size(); s++)
+        states[s] = graph.state(s);
+    policy.assign(states, cells, value);
+    return true;
+}
+
+//*********************************************************************
+//  MixedStrategy
+//*********************************************************************
+
+MixedStrategy::MixedStrategy(const Game& g)
+: m_space(g), m_lower(0), m_upper(0)
+{}
+
+void MixedStrategy::assign(const vector<double>& placement,
+                           const vector<vector<pair<StateKey, int>>>& policies,
+                           const vector<double>& policyWeights, double lower, double upper)
+{
+    m_placement = placement;
+    m_lower = lower;
+    m_upper = upper;
+
+    double total = 0;
+    for (size_t p = 0; p < policyWeights.size(); p++)
+        total += policyWeights[p];
+    m_policies.clear();
+    for (size_t p = 0; p < policies.size(); p++)
+    {
+        vector<pair<StateKey, int>> entries = policies[p];
+        sort(entries.begin(), entries.end());
+        Policy policy;
+        policy.probability = policyWeights[p] / total;
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            policy.keys.insert(policy.keys.end(), entries[i].first.begin(), entries[i].first.end());
+            policy.cells.push_back(entries[i].second);
+        }
+        m_policies.push_back(policy);
+    }
+}
+
+bool MixedStrategy::place(Board& b) const
+{
+    if (m_placement.empty())
+        return false;
+    double x = uniform_real_distribution<double>(0, 1)(randomGenerator());
+    int L = 0;
+    for ( ; L + 1 < (int)m_placement.size(); L++)
+    {
+        x -= m_placement[L];
+        if (x < 0)
+            break;
+    }
+    placeLayout(m_space.table(), m_space.layout(L), b);
+    return true;
+}
+
+int MixedStrategy::drawPolicy() const
+{
+    double x = uniform_real_distribution<double>(0, 1)(randomGenerator());
+    int p = 0;
+    for ( ; p + 1 < nPolicies(); p++)
+    {
+        x -= m_policies[p].probability;
+        if (x < 0)
+            break;
+    }
+    return p;
+}
+
+int MixedStrategy::bestCell(int p, int g, const StateKey& k) const
+{
+    if (p < 0  ||  p >= nPolicies())
+        return -1;
+    int symmetry;
+    StateKey canon = m_space.canonical(m_space.image(k, g), &symmetry);
+    int i = findKey(m_policies[p].keys, m_space.nWords(), canon);
+    if (i < 0)
+        return -1;
+    return m_space.unmapCell(g, m_space.unmapCell(symmetry, m_policies[p].cells[i]));
+}
+
+double MixedStrategy::expectedShots(int L) const
+{
+    double total = 0;
+    for (int p = 0; p < nPolicies(); p++)
+    {
+        double shots = 0;
+        for (int g = 0; g < m_space.nSymmetries(); g++)
+        {
+            StateKey k = m_space.initialState();
+            int n;
+            for (n = 1; n < MAXROWS * MAXCOLS; n++)
+            {
+                int cell = bestCell(p, g, k);
+                if (cell < 0)
+                {
+                    n = MAXROWS * MAXCOLS;      // the policy is lost
+                    break;
+                }
+                bool gameOver;
+                k = m_space.shoot(k, L, cell, gameOver);
+                if (gameOver)
+                    break;
+            }
+            shots += n;
+        }
+        total += m_policies[p].probability * shots / m_space.nSymmetries();
+    }
+    return total;
+}
+
+bool MixedStrategy::save(string path) const
+{
+    FILE* f = fopen(path.c_str(), "wb");
+    if (f == nullptr)
+        return false;
+
+    vector<unsigned char> out;
+    writeHeader(out, "BSEQ", m_space);
+    writeDouble(out, m_lower);
+    writeDouble(out, m_upper);
+    for (int L = 0; L < m_space.nLayouts(); L++)
+        writeDouble(out, L < (int)m_placement.size() ? m_placement[L] : 0);
+    writeWord(out, nPolicies(), 4);
+    for (int p = 0; p < nPolicies(); p++)
+    {
+        const Policy& policy = m_policies[p];
+        writeDouble(out, policy.probability);
+        writeWord(out, policy.cells.size(), 4);
+        for (size_t i = 0; i < policy.cells.size(); i++)
+        {
+            for (int w = 0; w < m_space.nWords(); w++)
+                writeWord(out, policy.keys[i * m_space.nWords() + w], 8);
+            out.push_back(policy.cells[i]);
+        }
+    }
+
+    bool ok = fwrite(&out[0], 1, out.size(), f) == out.size();
+    return fclose(f) == 0  &&  ok;
+}
+
+bool MixedStrategy::load(string path)
+{
+    if (!m_space.ok())
+        return false;
+    FILE* f = fopen(path.c_str(), "rb");
+    if (f == nullptr)
+        return false;
+
+    int nWords = m_space.nWords();
+    vector<unsigned char> data(16 + 8 * m_space.nLayouts() + 4);
+    bool ok = readHeader(f, "BSEQ", m_space)  &&
+              fread(&data[0], 1, data.size(), f) == data.size();
+    if (ok)
+    {
+        m_lower = readDouble(&data[0]);
+        m_upper = readDouble(&data[8]);
+        m_placement.resize(m_space.nLayouts());
+        for (int L = 0; L < m_space.nLayouts(); L++)
+            m_placement[L] = readDouble(&data[16 + 8 * L]);
+        int n = (int)readWord(&data[data.size() - 4], 4);
+
+        m_policies.assign(n, Policy());
+        unsigned char head[12];
+        vector<unsigned char> entry(8 * nWords + 1);
+        for (int p = 0; ok  &&  p < n; p++)
+        {
+            ok = fread(head, 1, 12, f) == 12;
+            Policy& policy = m_policies[p];
+            policy.probability = readDouble(head);
+            size_t nStates = ok ? readWord(head + 8, 4) : 0;
+            for (size_t i = 0; ok  &&  i < nStates; i++)
+            {
+                ok = fread(&entry[0], 1, entry.size(), f) == entry.size();
+                for (int w = 0; w < nWords; w++)
+                    policy.keys.push_back(readWord(&entry[8 * w], 8));
+                policy.cells.push_back(entry.back());
+            }
+        }
+    }
+    fclose(f);
+    return ok;
+}
+
+const MixedStrategy* MixedStrategy::shared(string path, const Game& g)
+{
+    static mutex strategyMutex;
+    static map<string, unique_ptr<MixedStrategy>> strategies;
+    static map<string, bool> loaded;
+
+    lock_guard<mutex> lock(strategyMutex);
+    string key = sharedKey(path, g);
+    unique_ptr<MixedStrategy>& strategy = strategies[key];
+    if (!strategy)
+    {
+        strategy.reset(new MixedStrategy(g));
+        loaded[key] = strategy->load(path);
+    }
+    if (!loaded[key]  ||  !sameGame(strategy->m_space.table(), g))
+        return nullptr;
+    return strategy.get();
+}
+
+//*********************************************************************
+//  EquilibriumSolver
+//*********************************************************************
+
+EquilibriumSolver::EquilibriumSolver(const KnowledgeGraph& graph, int nThreads)
+: m_graph(graph), m_nThreads(nThreads), m_iterations(0)
+{
+    if (m_nThreads <= 0)
+        m_nThreads = max(1u, thread::hardware_concurrency());
+
+    const LayoutSpace& space = graph.space();
+    vector<bool> seen(space.nLayouts(), false);
+    for (int L = 0; L < space.nLayouts(); L++)
+    {
+        if (seen[L])
+            continue;
+        vector<int> orbit;
+        for (int g = 0; g < space.nSymmetries(); g++)
+        {
+            int image = space.mapLayout(g, L);
+            if (!seen[image])
+            {
+                seen[image] = true;
+                orbit.push_back(image);
+            }
+        }
+        m_orbits.push_back(orbit);
+    }
+    m_regrets.assign(m_orbits.size(), 0);
+    m_probSums.assign(m_orbits.size(), 0);
+    m_costSums.assign(m_orbits.size(), 0);
+}
+
+vector<double> EquilibriumSolver::layoutWeights(const vector<double>& orbitProbs) const
+{
+    vector<double> weights(m_graph.space().nLayouts(), 0);
+    for (size_t o = 0; o < m_orbits.size(); o++)
+        for (size_t i = 0; i < m_orbits[o].size(); i++)
+            weights[m_orbits[o][i]] = orbitProbs[o] / m_orbits[o].size();
+    return weights;
+}
+
+double EquilibriumSolver::shotsToWin(const vector<int>& cells, int L) const
+{
+    const LayoutSpace& space = m_graph.space();
+    StateKey k = space.initialState();
+    for (int n = 1; n <= MAXROWS * MAXCOLS; n++)
+    {
+        int symmetry;
+        int s = m_graph.find(space.canonical(k, &symmetry));
+        if (s < 0  ||  cells[s] < 0)
+            break;
+        bool gameOver;
+        k = space.shoot(k, L, space.unmapCell(symmetry, cells[s]), gameOver);
+        if (gameOver)
+            return n;
+    }
+    return MAXROWS * MAXCOLS;
+}
+
+void EquilibriumSolver::run(int iterations)
+{
+    size_t nOrbits = m_orbits.size();
+    for (int it = 0; it < iterations; it++)
+    {
+        // the defender plays in proportion to its positive regrets, or
+        // uniformly over layouts when it has none
+        vector<double> probs(nOrbits);
+        double total = 0;
+        for (size_t o = 0; o < nOrbits; o++)
+            total += m_regrets[o];
+        for (size_t o = 0; o < nOrbits; o++)
+            probs[o] = total > 0 ? m_regrets[o] / total
+                                 : double(m_orbits[o].size()) / m_graph.space().nLayouts();
+
+        // the attacker's best response, and what it costs against each
+        // layout (averaged over each orbit, as if the attacker picked one
+        // of the board's symmetries at random)
+        vector<int> cells;
+        m_graph.solve(layoutWeights(probs), cells);
+        vector<double> costs(nOrbits);
+        parallelFor(nOrbits, m_nThreads, [&](int, size_t o) {
+            double sum = 0;
+            for (size_t i = 0; i < m_orbits[o].size(); i++)
+                sum += shotsToWin(cells, m_orbits[o][i]);
+            costs[o] = sum / m_orbits[o].size();
+        });
+
+        double expected = 0;
+        for (size_t o = 0; o < nOrbits; o++)
+            expected += probs[o] * costs[o];
+        for (size_t o = 0; o < nOrbits; o++)
+        {
+            m_regrets[o] = max(0.0, m_regrets[o] + costs[o] - expected);
+            m_probSums[o] += probs[o];
+            m_costSums[o] += costs[o];
+        }
+
+        // remember the response by the states it can reach, playing it
+        // again if it is one that has already been played
+        vector<bool> reached(m_graph.size(), false);
+        vector<int> stack(1, 0);
+        vector<int> next;
+        vector<pair<int, int>> policy;
+        reached[0] = true;
+        while (!stack.empty())
+        {
+            int s = stack.back();
+            stack.pop_back();
+            policy.push_back(make_pair(s, cells[s]));
+            m_graph.successors(s, cells[s], next);
+            for (size_t j = 0; j < next.size(); j++)
+                if (!reached[next[j]])
+                {
+                    reached[next[j]] = true;
+                    stack.push_back(next[j]);
+                }
+        }
+        sort(policy.begin(), policy.end());
+        size_t p;
+        for (p = 0; p < m_policies.size()  &&  m_policies[p] != policy; p++)
+            ;
+        if (p == m_policies.size())
+        {
+            m_policies.push_back(policy);
+            m_policyCounts.push_back(0);
+        }
+        m_policyCounts[p] += 1;
+        m_iterations++;
+    }
+}
+
+double EquilibriumSolver::lowerBound() const
+{
+    if (m_iterations == 0)
+        return 0;
+    vector<double> probs(m_probSums.size());
+    for (size_t o = 0; o < probs.size(); o++)
+        probs[o] = m_probSums[o] / m_iterations;
+    vector<int> cells;
+    return m_graph.solve(layoutWeights(probs), cells);
+}
+
+double EquilibriumSolver::upperBound() const
+{
+    if (m_iterations == 0)
+        return 0;
+    return *max_element(m_costSums.begin(), m_costSums.end()) / m_iterations;
+}
+
+void EquilibriumSolver::result(MixedStrategy& strategy) const
+{
+    vector<double> probs(m_probSums.size());
+    for (size_t o = 0; o < probs.size(); o++)
+        probs[o] = m_iterations == 0 ? 0 : m_probSums[o] / m_iterations;
+    vector<vector<pair<StateKey, int>>> policies(m_policies.size());
+    for (size_t p = 0; p < m_policies.size(); p++)
+        for (size_t i = 0; i < m_policies[p].size(); i++)
+            policies[p].push_back(make_pair(m_graph.state(m_policies[p][i].first),
+                                            m_policies[p][i].second));
+    strategy.assign(layoutWeights(probs), policies, m_policyCounts, lowerBound(), upperBound());
+}
@@ -0,0 +1,295 @@
+#ifndef POLICY_INCLUDED
+#define POLICY_INCLUDED
+
+#include "Placement.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class Game;
+class Board;
+
+// Perfect play for games small enough to solve completely, such as the 2x3
+// mini-game.
+//
+// A knowledge state is what an attacker has learned so far: the set of
+// fleet layouts still consistent with every shot's outcome, and which of
+// the cells those layouts cover have already been shot.  (Shots at cells
+// no remaining layout covers make no difference to the rest of the game,
+// so they are left out.)  A StateKey holds the shots as two words followed
+// by one bit per layout.
+typedef std::vector<uint64_t> StateKey;
+
+// Every layout of a game's fleet, and the reflections and rotations of the
+// board that turn one layout into another.  Two knowledge states that are
+// images of each other under a symmetry need the same number of shots, so
+// a solver only has to store one of them: the canonical one, with the
+// smallest key.
+class LayoutSpace
+{
+public:
+    // ok() is false if the fleet has more than maxLayouts layouts
+    LayoutSpace(const Game& g, int maxLayouts = 1 << 16);
+    bool ok() const { return m_ok; }
+
+    const PlacementTable& table() const { return m_table; }
+    int nLayouts() const { return (int)m_fleets.size(); }
+    int nWords() const { return 2 + (nLayouts() + 63) / 64; }
+    Bitboard fleet(int L) const { return m_fleets[L]; }
+    Bitboard ship(int L, int s) const { return m_ships[(size_t)L * m_table.nShips() + s]; }
+    // L as a layout of table(), one placement index per ship
+    std::vector<int> layout(int L) const;
+    int nSymmetries() const { return (int)m_cellMaps.size(); }
+
+    // The state before any shot
+    StateKey initialState() const;
+
+    // The shots of a state, and the layouts still possible in it
+    Bitboard shots(const StateKey& k) const { return Bitboard(k[0], k[1]); }
+    std::vector<int> layouts(const StateKey& k) const;
+
+    // What a shot at cell reveals if the layout is L and after holds every
+    // cell shot so far including this one: 0 for a miss, 1 for a hit, or
+    // 2 + 2*shipId for sinking a ship, plus 1 if that ends the game
+    int outcome(int L, Bitboard after, int cell) const;
+
+    // The state with the given shots and layouts
+    StateKey makeState(Bitboard shots, const std::vector<int>& layouts) const;
+
+    // The state after the attacker sees the result of a shot at p
+    StateKey observe(const StateKey& k, Point p, bool shotHit,
+                     bool shipDestroyed, int shipId) const;
+
+    // The state after a shot at cell when the layout is really L; gameOver
+    // is set if that shot sinks the last ship
+    StateKey shoot(const StateKey& k, int L, int cell, bool& gameOver) const;
+
+    // The canonical image of k; if symmetry is not null, it is set to a
+    // symmetry that maps k onto it
+    StateKey canonical(const StateKey& k, int* symmetry = nullptr) const;
+
+    // The image of k under symmetry g
+    StateKey image(const StateKey& k, int g) const;
+
+    // Where symmetry g moves a cell, and where it came from, and where it
+    // moves a layout
+    int mapCell(int g, int cell) const { return m_cellMaps[g][cell]; }
+    int unmapCell(int g, int cell) const { return m_cellUnmaps[g][cell]; }
+    int mapLayout(int g, int L) const { return m_layoutMaps[g][L]; }
+
+private:
+    PlacementTable m_table;
+    bool m_ok;
+    std::vector<Bitboard> m_ships;              // [layout][ship]
+    std::vector<Bitboard> m_fleets;             // union of each layout's ships
+    std::vector<int> m_placements;              // [layout][ship]
+    std::vector<std::vector<int>> m_cellMaps;   // [symmetry][cell]
+    std::vector<std::vector<int>> m_cellUnmaps;
+    std::vector<std::vector<int>> m_layoutMaps; // [symmetry][layout]
+};
+
+// The best shot in every canonical knowledge state reachable by perfect
+// play.  The file format is "BSOP", the board size, the number of ships
+// and their lengths, the number of layouts and of states, the expected
+// number of shots from the start (in millionths), and then for each state
+// its key (nWords little-endian 8 byte words) followed by one byte holding
+// the cell r*MAXCOLS+c to shoot, in the canonical state's frame.
+class PolicyTable
+{
+public:
+    PolicyTable(const Game& g);
+    const LayoutSpace& space() const { return m_space; }
+    int size() const { return (int)m_cells.size(); }
+    double expectedShots() const { return m_expectedShots; }
+
+    // Replace the table with the given canonical states and best cells
+    void assign(const std::vector<StateKey>& states, const std::vector<int>& cells,
+                double expectedShots);
+
+    // The best cell to shoot in state k (which need not be canonical), or -1
+    // if k is not in the table
+    int bestCell(const StateKey& k) const;
+
+    // false if the file is missing or was made for another board or fleet
+    bool load(std::string path);
+    bool save(std::string path) const;
+
+    // The table at path for games set up like g, loaded the first time it is
+    // asked for with that board and fleet and shared after that; nullptr if
+    // it cannot be loaded for them
+    static const PolicyTable* shared(std::string path, const Game& g);
+
+private:
+    LayoutSpace m_space;
+    std::vector<uint64_t> m_keys;       // nWords per state, sorted
+    std::vector<unsigned char> m_cells;
+    double m_expectedShots;
+};
+
+// The canonical knowledge states an attacker can reach in a small game,
+// and the shots between them, found once so that the game can be solved
+// again and again for different placement distributions.  States are
+// found breadth first, each wave expanded in parallel, and are valued in
+// order of the number of unshot ship cells summed over their layouts,
+// which every shot worth taking reduces, so each state's successors are
+// valued before it is.  State 0 is the initial state.
+class KnowledgeGraph
+{
+public:
+    // ok() is false if there are more than maxStates states.  nThreads == 0
+    // means one thread per core, here and in solve.
+    KnowledgeGraph(const LayoutSpace& space, int nThreads = 0, size_t maxStates = 20000000);
+    bool ok() const { return m_ok; }
+    const LayoutSpace& space() const { return m_space; }
+    int size() const { return (int)m_states.size(); }
+    const StateKey& state(int s) const { return m_states[s]; }
+
+    // The index of a canonical state, or -1 if it cannot be reached
+    int find(const StateKey& canonicalState) const;
+
+    // The states that a shot at cell in state s can lead to without ending
+    // the game
+    void successors(int s, int cell, std::vector<int>& next) const;
+
+    // Value every state by dynamic programming when layout L is drawn with
+    // probability proportional to weights[L], setting cells[s] to the shot
+    // that minimizes the expected number of shots still needed in state s.
+    // Layouts that are images of each other under a board symmetry must
+    // have the same weight.  Returns the expected number of shots from the
+    // start.
+    double solve(const std::vector<double>& weights, std::vector<int>& cells) const;
+
+private:
+    const LayoutSpace& m_space;
+    int m_nThreads;
+    bool m_ok;
+    std::vector<StateKey> m_states;
+    std::vector<int> m_sorted;          // states by key, for find
+    std::vector<int> m_order;           // states by unshot ship cells
+    std::vector<int> m_waves;           // where each group of equal counts starts
+    std::vector<int> m_moveStart;       // [state] first move, plus one past the end
+    std::vector<int> m_moveCell;        // [move]
+    std::vector<int> m_nextStart;       // [move] first successor, plus one past the end
+    std::vector<int> m_next;            // successors that do not end the game
+};
+
+// Solve a small game exactly, assuming every layout is equally likely, and
+// store the optimal policy in policy.  Returns false if there are more
+// than maxStates states.
+bool solveOptimalPolicy(PolicyTable& policy, int nThreads = 0, size_t maxStates = 20000000);
+
+// A mixed strategy for both sides of a small game: a probability for each
+// layout, and a set of pure shot policies with the probability of playing
+// each.  A game is played by drawing one policy and one board symmetry at
+// the start and following that policy on the board as seen through the
+// symmetry.  (Mixing shots state by state instead would not be the same
+// thing, since different shot orders can reach the same knowledge state.)
+//
+// The file format is "BSEQ", the board size, the number of ships and their
+// lengths, the number of layouts, the lower and upper bounds on the game's
+// value, a probability for each layout, the number of policies, and then
+// for each policy its probability, its number of states and each state's
+// key and best cell as in .bsp files.  Probabilities and bounds are 8 byte
+// doubles.
+class MixedStrategy
+{
+public:
+    MixedStrategy(const Game& g);
+    const LayoutSpace& space() const { return m_space; }
+    int nPolicies() const { return (int)m_policies.size(); }
+
+    // The expected shots to win in equilibrium lie between these
+    double lowerBound() const { return m_lower; }
+    double upperBound() const { return m_upper; }
+
+    double placementProbability(int L) const { return m_placement[L]; }
+    double policyProbability(int p) const { return m_policies[p].probability; }
+
+    // Replace the strategy.  policies[p] gives the best cell for each of the
+    // canonical states it can reach; weights need not add up to 1.
+    void assign(const std::vector<double>& placement,
+                const std::vector<std::vector<std::pair<StateKey, int>>>& policies,
+                const std::vector<double>& policyWeights, double lower, double upper);
+
+    // Put a layout drawn from the placement distribution on b
+    bool place(Board& b) const;
+
+    // A policy drawn at random, for the start of a game
+    int drawPolicy() const;
+
+    // The cell policy p shoots in state k when the board is seen through
+    // symmetry g, or -1 if the policy never reaches k
+    int bestCell(int p, int g, const StateKey& k) const;
+
+    // The exact expected number of shots needed to sink layout L
+    double expectedShots(int L) const;
+
+    // false if the file is missing or was made for another board or fleet
+    bool load(std::string path);
+    bool save(std::string path) const;
+
+    // The strategy at path for games set up like g, loaded the first time
+    // it is asked for with that board and fleet and shared after that;
+    // nullptr if it cannot be loaded for them
+    static const MixedStrategy* shared(std::string path, const Game& g);
+
+private:
+    struct Policy
+    {
+        double probability;
+        std::vector<uint64_t> keys;     // nWords per state, sorted
+        std::vector<unsigned char> cells;
+    };
+
+    LayoutSpace m_space;
+    std::vector<double> m_placement;
+    std::vector<Policy> m_policies;
+    double m_lower;
+    double m_upper;
+};
+
+// Approximates the equilibrium of the zero-sum game between a defender who
+// picks a layout and an attacker who picks a search policy, the payoff
+// being the number of shots to win.
+//
+// Each iteration the attacker plays a best response (by dynamic
+// programming on a KnowledgeGraph) to the defender's current distribution,
+// the policy is played against every layout in parallel, and the defender
+// updates its distribution by regret matching.  The defender's average
+// distribution and the attacker's mix of the responses it has played
+// converge to an equilibrium; the bounds say how close they are.  Layouts that are
+// images of each other under board symmetries are kept equally likely, so
+// the game can still be solved on canonical states.
+class EquilibriumSolver
+{
+public:
+    EquilibriumSolver(const KnowledgeGraph& graph, int nThreads = 0);
+    void run(int iterations);
+    int iterations() const { return m_iterations; }
+
+    // The best the attacker can do against the defender's average
+    // distribution, and the most shots any layout needs against the
+    // attacker's average policy; the value of the game lies between them.
+    double lowerBound() const;
+    double upperBound() const;
+    int nPolicies() const { return (int)m_policies.size(); }
+
+    // The average strategies so far
+    void result(MixedStrategy& strategy) const;
+
+private:
+    std::vector<double> layoutWeights(const std::vector<double>& orbitProbs) const;
+    double shotsToWin(const std::vector<int>& cells, int L) const;
+
+    const KnowledgeGraph& m_graph;
+    int m_nThreads;
+    int m_iterations;
+    std::vector<std::vector<int>> m_orbits;     // layouts that are images of each other
+    std::vector<double> m_regrets;              // [orbit]
+    std::vector<double> m_probSums;             // [orbit] summed over iterations
+    std::vector<double> m_costSums;             // [orbit] shots summed over iterations
+    std::vector<std::vector<std::pair<int, int>>> m_policies;    // (state, cell) of each
+    std::vector<double> m_policyCounts;         // iterations each policy was played
+};
+
+#endif // POLICY_INCLUDED
@@ -0,0 +1,208 @@
+#include "Renderer.h"
+#include "Board.h"
+#include "Game.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+using namespace std;
+
+// the gap between the two boards
+const int GAP = 4;
+
+void captureBoard(const Board& b, const Game& g, bool shotsOnly, Frame& f, int which)
+{
+    f.rows = g.rows();
+    f.cols = g.cols();
+    for (int r = 0; r < g.rows(); r++)
+        for (int c = 0; c < g.cols(); c++)
+            f.cells[which][r][c] = b.displaySymbol(Point(r, c), shotsOnly);
+}
+
+string describeShot(const Game& g, const string& attacker, const ShotRecord& shot)
+{
+    string where = "(" + to_string(shot.p.r) + "," + to_string(shot.p.c) + ")";
+    if (!shot.validShot)
+        return attacker + " wasted a shot at " + where + ".";
+    if (!shot.shotHit)
+        return attacker + " attacked " + where + " and missed";
+    if (shot.shipDestroyed  &&  shot.shipId >= 0  &&  shot.shipId < g.nShips())
+        return attacker + " attacked " + where + " and destroyed the " + g.shipName(shot.shipId);
+    return attacker + " attacked " + where + " and hit something";
+}
+
+//*********************************************************************
+//  TerminalRenderer
+//*********************************************************************
+
+TerminalRenderer::TerminalRenderer(int fd)
+: m_fd(fd), m_firstRow(0), m_firstCol(0), m_viewRows(MAXROWS), m_viewCols(MAXCOLS),
+  m_frames(0), m_bytes(0)
+{}
+
+void TerminalRenderer::scrollTo(int firstRow, int firstCol)
+{
+    m_firstRow = max(0, firstRow);
+    m_firstCol = max(0, firstCol);
+}
+
+void TerminalRenderer::follow(Point p)
+{
+    if (p.r < m_firstRow)
+        m_firstRow = p.r;
+    else if (p.r >= m_firstRow + m_viewRows)
+        m_firstRow = p.r - m_viewRows + 1;
+    if (p.c < m_firstCol)
+        m_firstCol = p.c;
+    else if (p.c >= m_firstCol + m_viewCols)
+        m_firstCol = p.c - m_viewCols + 1;
+    scrollTo(m_firstRow, m_firstCol);
+}
+
+void TerminalRenderer::layout(const Frame& f)
+{
+    // fit the viewport to the terminal, leaving room for the names, the
+    // column numbers, the status and the cursor
+    int termRows = 24;
+    int termCols = 80;
+    winsize ws;
+    if (ioctl(m_fd, TIOCGWINSZ, &ws) == 0  &&  ws.ws_row > 0  &&  ws.ws_col > 0)
+    {
+        termRows = ws.ws_row;
+        termCols = ws.ws_col;
+    }
+    m_viewRows = max(1, min(f.rows, termRows - 4));
+    m_viewCols = max(1, min(f.cols, (termCols - GAP) / 2 - 2));
+    m_firstRow = max(0, min(m_firstRow, f.rows - m_viewRows));
+    m_firstCol = max(0, min(m_firstCol, f.cols - m_viewCols));
+
+    const int width = max(2 + m_viewCols, (termCols - GAP) / 2);
+    m_lines.resize(3 + m_viewRows);
+    for (size_t i = 0; i < m_lines.size(); i++)
+        m_lines[i].clear();
+
+    for (int b = 0; b < 2; b++)
+    {
+        string name = f.names[b].substr(0, width);
+        m_lines[0] += name;
+        m_lines[1] += "  ";
+        for (int c = m_firstCol; c < m_firstCol + m_viewCols; c++)
+            m_lines[1] += char('0' + c % 10);
+        for (int r = m_firstRow; r < m_firstRow + m_viewRows; r++)
+        {
+            string& line = m_lines[2 + r - m_firstRow];
+            line += char('0' + r % 10);
+            line += ' ';
+            line.append(&f.cells[b][r][m_firstCol], m_viewCols);
+        }
+        if (b == 0)
+            for (int i = 0; i < 2 + m_viewRows; i++)
+                m_lines[i].resize(width + GAP, ' ');
+    }
+    m_lines.back() = f.status.substr(0, termCols - 1);
+}
+
+void TerminalRenderer::render(const Frame& f)
+{
+    layout(f);
+    m_out.clear();
+    if (m_screen.empty())
+        m_out += "\x1b[2J";
+    m_screen.resize(m_lines.size());
+
+    for (size_t i = 0; i < m_lines.size(); i++)
+    {
+        string& line = m_lines[i];
+        string& shown = m_screen[i];
+        if (line.size() < shown.size())
+            line.resize(shown.size(), ' ');     // blank out what was longer
+        size_t c = 0;
+        while (c < line.size())
+        {
+            if (c < shown.size()  &&  line[c] == shown[c])
+            {
+                c++;
+                continue;
+            }
+            // a run of changes, taking in short stretches of unchanged
+            // characters rather than moving the cursor again
+            size_t end = c + 1;
+            size_t same = 0;
+            while (end < line.size()  &&  same < 4)
+            {
+                if (end < shown.size()  &&  line[end] == shown[end])
+                    same++;
+                else
+                    same = 0;
+                end++;
+            }
+            end -= same;
+            m_out += "\x1b[" + to_string(i + 1) + ";" + to_string(c + 1) + "H";
+            m_out.append(line, c, end - c);
+            c = end;
+        }
+        shown = line;
+    }
+    // leave the cursor under the frame
+    m_out += "\x1b[" + to_string(m_lines.size() + 1) + ";1H";
+
+    // anything already sent through cout must come first
+    cout.flush();
+    size_t done = 0;
+    while (done < m_out.size())
+    {
+        ssize_t n = write(m_fd, m_out.data() + done, m_out.size() - done);
+        if (n <= 0)
+            break;
+        done += n;
+    }
+    m_frames++;
+    m_bytes += done;
+}
+
+//*********************************************************************
+//  TerminalSpectator
+//*********************************************************************
+
+TerminalSpectator::TerminalSpectator(const Game& g, int delayMs)
+: m_game(g), m_delayMs(delayMs)
+{}
+
+void TerminalSpectator::gameStarted(const string& name1, const Board& b1,
+                                    const string& name2, const Board& b2)
+{
+    m_frame.names[0] = name1;
+    m_frame.names[1] = name2;
+    captureBoard(b1, m_game, false, m_frame, 0);
+    captureBoard(b2, m_game, false, m_frame, 1);
+    m_frame.status = name1 + " moves first";
+    m_renderer.invalidate();
+    m_renderer.render(m_frame);
+}
+
+void TerminalSpectator::shotFired(const ShotRecord& shot, const Board& target)
+{
+    int which = 1 - shot.player;
+    if (m_game.isValid(shot.p))
+    {
+        m_frame.cells[which][shot.p.r][shot.p.c] = target.displaySymbol(shot.p, false);
+        m_renderer.follow(shot.p);
+    }
+    m_frame.status = describeShot(m_game, m_frame.names[shot.player], shot);
+    m_renderer.render(m_frame);
+    if (m_delayMs > 0)
+        this_thread::sleep_for(chrono::milliseconds(m_delayMs));
+}
+
+void TerminalSpectator::gameEnded(const GameRecord& rec)
+{
+    if (rec.winner >= 0)
+        m_frame.status = m_frame.names[rec.winner] + " wins!";
+    else
+        m_frame.status = "Nobody won";
+    m_renderer.render(m_frame);
+}
@@ -0,0 +1,92 @@
+#ifndef RENDERER_INCLUDED
+#define RENDERER_INCLUDED
+
+#include "globals.h"
+#include "HeadlessPlay.h"
+#include <string>
+#include <vector>
+
+class Board;
+class Game;
+
+// What a spectator sees of a game at one moment: both boards as display
+// shows them, the players' names above them, and a line of status.
+// Board 0 belongs to the player who moves first.
+struct Frame
+{
+    int rows = 0;
+    int cols = 0;
+    std::string names[2];
+    char cells[2][MAXROWS][MAXCOLS];
+    std::string status;
+};
+
+// Copy b's cells, as b.display(shotsOnly) shows them, into board which of f
+void captureBoard(const Board& b, const Game& g, bool shotsOnly, Frame& f, int which);
+
+// Draws frames in place on an ANSI terminal.
+//
+// Each frame is laid out as lines of text in a buffer kept from frame to
+// frame and compared with what the terminal already shows; only the runs
+// of characters that changed are sent, each after a cursor move, so an
+// attack usually costs a few dozen bytes.  The whole frame goes out in one
+// write.  If the boards do not fit in the terminal, a viewport shows part
+// of them, and can be scrolled, or made to follow the latest attack.
+class TerminalRenderer
+{
+public:
+    // Frames are written to the file descriptor fd (standard output by
+    // default)
+    TerminalRenderer(int fd = 1);
+
+    // Show the boards from row firstRow and column firstCol on
+    void scrollTo(int firstRow, int firstCol);
+
+    // Scroll just enough to bring p into the viewport
+    void follow(Point p);
+
+    void render(const Frame& f);
+
+    // Forget what the terminal shows, so the next frame is drawn in full
+    void invalidate() { m_screen.clear(); }
+
+    int frames() const { return m_frames; }
+    size_t bytesWritten() const { return m_bytes; }
+
+private:
+    void layout(const Frame& f);
+
+    int m_fd;
+    int m_firstRow;
+    int m_firstCol;
+    int m_viewRows;                     // the viewport's size as of the last frame
+    int m_viewCols;
+    std::vector<std::string> m_screen;  // what the terminal shows
+    std::vector<std::string> m_lines;   // the frame being drawn
+    std::string m_out;                  // what the next write sends
+    int m_frames;
+    size_t m_bytes;
+};
+
+// Watches a headless game on the terminal, redrawing it in place after
+// every attack and pausing delayMs milliseconds so it can be followed
+class TerminalSpectator : public GameObserver
+{
+public:
+    TerminalSpectator(const Game& g, int delayMs = 100);
+    virtual void gameStarted(const std::string& name1, const Board& b1,
+                             const std::string& name2, const Board& b2);
+    virtual void shotFired(const ShotRecord& shot, const Board& target);
+    virtual void gameEnded(const GameRecord& rec);
+
+private:
+    const Game& m_game;
+    int m_delayMs;
+    TerminalRenderer m_renderer;
+    Frame m_frame;
+};
+
+// The status line for an attack, as Game::play words it
+std::string describeShot(const Game& g, const std::string& attacker, const ShotRecord& shot);
+
+#endif // RENDERER_INCLUDED
@@ -0,0 +1,209 @@
+#include "Replay.h"
+#include "Game.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+static void writeInt(unsigned char* p, int n)
+{
+    p[0] = n & 0xFF;
+    p[1] = (n >> 8) & 0xFF;
+    p[2] = (n >> 16) & 0xFF;
+    p[3] = (n >> 24) & 0xFF;
+}
+
+//*********************************************************************
+//  ReplayBlock
+//*********************************************************************
+
+ReplayBlock::ReplayBlock()
+: m_data(REPLAY_BLOCK_SIZE, 0)
+{
+    clear();
+}
+
+void ReplayBlock::clear()
+{
+    memset(&m_data[0], 0, REPLAY_BLOCK_SIZE);
+    memcpy(&m_data[0], "BLOK", 4);
+    m_used = REPLAY_BLOCK_HEADER_SIZE;
+    m_nGames = 0;
+}
+
+bool ReplayBlock::add(const vector<ShotRecord>& shots, int winner)
+{
+    int size = 3 + 3 * (int)shots.size();
+    if (m_used + size > REPLAY_BLOCK_SIZE)
+        return false;
+
+    unsigned char* p = &m_data[m_used];
+    p[0] = shots.size() & 0xFF;
+    p[1] = (shots.size() >> 8) & 0xFF;
+    p[2] = (winner == -1 ? 255 : winner);
+    p += 3;
+    for (size_t i = 0; i < shots.size(); i++, p += 3)
+    {
+        const ShotRecord& s = shots[i];
+        bool onBoard = s.p.r >= 0  &&  s.p.r < MAXROWS  &&  s.p.c >= 0  &&  s.p.c < MAXCOLS;
+        p[0] = onBoard ? s.p.r * MAXCOLS + s.p.c : 255;
+        p[1] = (s.player == 1 ? REPLAY_SECOND_PLAYER : 0) |
+               (s.validShot ? REPLAY_VALID : 0) |
+               (s.shotHit ? REPLAY_HIT : 0) |
+               (s.shipDestroyed ? REPLAY_DESTROYED : 0);
+        p[2] = (s.shipId < 0 ? 255 : s.shipId);
+    }
+
+    m_used += size;
+    m_nGames++;
+    return true;
+}
+
+const unsigned char* ReplayBlock::data()
+{
+    writeInt(&m_data[4], m_used);
+    writeInt(&m_data[8], m_nGames);
+    return &m_data[0];
+}
+
+//*********************************************************************
+//  ReplayWriter
+//*********************************************************************
+
+ReplayWriter::ReplayWriter(string path, const Game& g)
+: m_file(nullptr), m_failed(false)
+{
+    if (g.nShips() > REPLAY_MAX_SHIPS)
+        return;
+    m_file = fopen(path.c_str(), "wb");
+    if (m_file == nullptr)
+        return;
+
+    unsigned char header[REPLAY_HEADER_SIZE];
+    memset(header, 0, sizeof(header));
+    memcpy(header, "BSRP", 4);
+    writeInt(header + 4, 1);
+    writeInt(header + 8, REPLAY_BLOCK_SIZE);
+    header[12] = g.rows();
+    header[13] = g.cols();
+    header[14] = g.nShips();
+    for (int s = 0; s < g.nShips(); s++)
+        header[16 + s] = g.shipLength(s);
+    if (fwrite(header, 1, sizeof(header), m_file) != sizeof(header))
+        m_failed = true;
+}
+
+ReplayWriter::~ReplayWriter()
+{
+    close();
+}
+
+void ReplayWriter::add(const vector<ShotRecord>& shots, int winner)
+{
+    if (!m_pending.add(shots, winner))
+    {
+        writeBlock(m_pending);
+        m_pending.add(shots, winner);
+    }
+}
+
+void ReplayWriter::writeBlock(ReplayBlock& block)
+{
+    if (block.nGames() == 0)
+        return;
+    {
+        lock_guard<mutex> lock(m_mutex);
+        if (m_file != nullptr  &&
+            fwrite(block.data(), 1, REPLAY_BLOCK_SIZE, m_file) != size_t(REPLAY_BLOCK_SIZE))
+            m_failed = true;
+    }
+    block.clear();
+}
+
+bool ReplayWriter::close()
+{
+    if (m_file == nullptr)
+        return !m_failed;
+    writeBlock(m_pending);
+    // a write still buffered can fail only now
+    if (fclose(m_file) != 0)
+        m_failed = true;
+    m_file = nullptr;
+    return !m_failed;
+}
+
+//*********************************************************************
+//  ReplayFile
+//*********************************************************************
+
+ReplayFile::ReplayFile(string path)
+: m_data(nullptr), m_size(0), m_nBlocks(0)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0  &&  st.st_size >= REPLAY_HEADER_SIZE)
+    {
+        m_size = st.st_size;
+        void* p = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED)
+        {
+            m_data = static_cast<const unsigned char*>(p);
+            madvise(p, m_size, MADV_SEQUENTIAL);
+        }
+    }
+    ::close(fd);
+
+    if (m_data == nullptr)
+        return;
+    if (memcmp(m_data, "BSRP", 4) != 0  ||  readInt(m_data + 4) != 1  ||
+        readInt(m_data + 8) != uint32_t(REPLAY_BLOCK_SIZE))
+    {
+        munmap(const_cast<unsigned char*>(m_data), m_size);
+        m_data = nullptr;
+        return;
+    }
+    if (rows() < 1  ||  rows() > MAXROWS  ||  cols() < 1  ||  cols() > MAXCOLS  ||
+        nShips() > REPLAY_MAX_SHIPS)
+    {
+        munmap(const_cast<unsigned char*>(m_data), m_size);
+        m_data = nullptr;
+        return;
+    }
+    
+    // a block cut short at the end of the file is not counted
+    m_nBlocks = (m_size - REPLAY_HEADER_SIZE) / REPLAY_BLOCK_SIZE;
+}
+
+bool ReplayFile::validGame(const unsigned char* p, const unsigned char* end) const
+{
+    if (end - p < 3)
+        return false;
+    ReplayGame game(p);
+    if (end - p < game.size())
+        return false;
+    for (int i = 0; i < game.nShots(); i++)
+    {
+        ReplayShot s = game.shot(i);
+        if (!s.onBoard())
+        {
+            if (s.validShot())
+                return false;
+        }
+        else if (s.cell() / MAXCOLS >= rows()  ||  s.cell() % MAXCOLS >= cols())
+            return false;
+    }
+    return true;
+}
+
+ReplayFile::~ReplayFile()
+{
+    if (m_data != nullptr)
+        munmap(const_cast<unsigned char*>(m_data), m_size);
+}
@@ -0,0 +1,175 @@
+#ifndef REPLAY_INCLUDED
+#define REPLAY_INCLUDED
+
+#include "HeadlessPlay.h"
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class Game;
+
+// Replay files archive headless games.  A file is a 256 byte header
+// followed by fixed-size blocks; every block holds whole games, so a file
+// can be cut into chunks of blocks and read in parallel without scanning.
+//
+//   header:  "BSRP", version, block size, rows, cols, number of ships and
+//            their lengths
+//   block:   "BLOK", bytes used, number of games, then the games
+//   game:    number of shots (2 bytes), winner (0, 1 or 255), then 3 bytes
+//            per shot: cell r*MAXCOLS+c (255 if off the board), flags
+//            (player, valid, hit, destroyed) and the id of the ship
+//            destroyed (255 if none)
+//
+// All numbers are little-endian.
+
+const int REPLAY_HEADER_SIZE = 256;
+const int REPLAY_BLOCK_SIZE = 64 * 1024;
+const int REPLAY_BLOCK_HEADER_SIZE = 12;
+const int REPLAY_MAX_SHIPS = REPLAY_HEADER_SIZE - 16;
+
+enum ReplayShotFlags {
+    REPLAY_SECOND_PLAYER = 1, REPLAY_VALID = 2, REPLAY_HIT = 4, REPLAY_DESTROYED = 8
+};
+
+// One shot of an archived game, pointing into the archive
+class ReplayShot
+{
+public:
+    ReplayShot(const unsigned char* p) : m_p(p) {}
+    int player() const { return m_p[1] & REPLAY_SECOND_PLAYER ? 1 : 0; }
+    bool onBoard() const { return m_p[0] != 255; }
+    int cell() const { return m_p[0]; }                 // r*MAXCOLS + c
+    Point point() const { return Point(m_p[0] / MAXCOLS, m_p[0] % MAXCOLS); }
+    bool validShot() const { return (m_p[1] & REPLAY_VALID) != 0; }
+    bool shotHit() const { return (m_p[1] & REPLAY_HIT) != 0; }
+    bool shipDestroyed() const { return (m_p[1] & REPLAY_DESTROYED) != 0; }
+    int shipId() const { return m_p[2] == 255 ? -1 : m_p[2]; }
+private:
+    const unsigned char* m_p;
+};
+
+// One archived game, pointing into the archive
+class ReplayGame
+{
+public:
+    ReplayGame(const unsigned char* p) : m_p(p) {}
+    int nShots() const { return m_p[0] | m_p[1] << 8; }
+    int winner() const { return m_p[2] == 255 ? -1 : m_p[2]; }
+    ReplayShot shot(int i) const { return ReplayShot(m_p + 3 + 3 * i); }
+    int size() const { return 3 + 3 * nShots(); }
+private:
+    const unsigned char* m_p;
+};
+
+// A block of games being filled before it is written.  Each thread that
+// archives games can fill its own block and hand it to ReplayWriter.
+class ReplayBlock
+{
+public:
+    ReplayBlock();
+    // false if the game does not fit; write the block and try again
+    bool add(const std::vector<ShotRecord>& shots, int winner);
+    int nGames() const { return m_nGames; }
+    void clear();
+    const unsigned char* data();
+private:
+    std::vector<unsigned char> m_data;
+    int m_used;
+    int m_nGames;
+};
+
+class ReplayWriter
+{
+public:
+    // Create the file at path for games played on boards set up like g
+    ReplayWriter(std::string path, const Game& g);
+    ~ReplayWriter();
+    // false if the file could not be created or a write to it failed
+    bool ok() const { return m_file != nullptr  &&  !m_failed; }
+
+    // Archive one game (not thread-safe; threads should fill their own
+    // ReplayBlock and use writeBlock instead)
+    void add(const std::vector<ShotRecord>& shots, int winner);
+
+    // Write a block and clear it; safe to call from several threads
+    void writeBlock(ReplayBlock& block);
+
+    // Write any pending games and close the file; false if anything
+    // written since it was created failed
+    bool close();
+
+    ReplayWriter(const ReplayWriter&) = delete;
+    ReplayWriter& operator=(const ReplayWriter&) = delete;
+
+private:
+    FILE* m_file;
+    std::atomic<bool> m_failed;
+    std::mutex m_mutex;
+    ReplayBlock m_pending;
+};
+
+// A replay file mapped into memory for reading
+class ReplayFile
+{
+public:
+    ReplayFile(std::string path);
+    ~ReplayFile();
+    bool ok() const { return m_data != nullptr; }
+
+    int rows() const { return m_data[12]; }
+    int cols() const { return m_data[13]; }
+    int nShips() const { return m_data[14]; }
+    int shipLength(int shipId) const { return m_data[16 + shipId]; }
+    size_t nBlocks() const { return m_nBlocks; }
+
+    // Call f(ReplayGame) for every game in block b (less than nBlocks()).
+    // The block's extent and every game's are checked before they are
+    // read, so a corrupt or truncated archive cannot send a reader out of
+    // bounds: the games of a block from the first one that does not fit in
+    // it, or has a shot off the board, are skipped, and false is returned.
+    template <class F>
+    bool forEachGame(size_t b, F f) const
+    {
+        if (b >= m_nBlocks)
+            return false;
+        const unsigned char* block = m_data + REPLAY_HEADER_SIZE + b * REPLAY_BLOCK_SIZE;
+        uint32_t used = readInt(block + 4);
+        if (memcmp(block, "BLOK", 4) != 0  ||  used < REPLAY_BLOCK_HEADER_SIZE  ||
+            used > uint32_t(REPLAY_BLOCK_SIZE))
+            return false;
+        const unsigned char* end = block + used;
+        uint32_t nGames = readInt(block + 8);
+        const unsigned char* p = block + REPLAY_BLOCK_HEADER_SIZE;
+        for (uint32_t k = 0; k < nGames; k++)
+        {
+            if (!validGame(p, end))
+                return false;
+            ReplayGame game(p);
+            f(game);
+            p += game.size();
+        }
+        return true;
+    }
+
+    ReplayFile(const ReplayFile&) = delete;
+    ReplayFile& operator=(const ReplayFile&) = delete;
+
+private:
+    static uint32_t readInt(const unsigned char* p)
+    {
+        return p[0] | p[1] << 8 | p[2] << 16 | uint32_t(p[3]) << 24;
+    }
+
+    // true if the game at p ends by end and its shots are all on the board
+    bool validGame(const unsigned char* p, const unsigned char* end) const;
+
+    const unsigned char* m_data;
+    size_t m_size;
+    size_t m_nBlocks;
+};
+
+#endif // REPLAY_INCLUDED
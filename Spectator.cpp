@@ -0,0 +1,165 @@
+#include "Spectator.h"
+#include "Board.h"
+#include "Game.h"
+
+#include <chrono>
+#include <cstring>
+#include <memory>
+
+using namespace std;
+
+// how many events the renderer applies before it looks at the clock again
+const int MAX_DRAIN = 64;
+
+static void copyName(char* dest, size_t size, const string& name)
+{
+    strncpy(dest, name.c_str(), size - 1);
+    dest[size - 1] = '\0';
+}
+
+SpectatorChannel::SpectatorChannel(const Game& g, int frameMs, int fd)
+: m_game(g), m_frameMs(frameMs), m_games(0), m_skipping(true), m_skipped(0),
+  m_renderer(fd), m_shownGame(-1), m_stopping(false)
+{
+    m_thread = thread(&SpectatorChannel::render, this);
+}
+
+SpectatorChannel::~SpectatorChannel()
+{
+    stop();
+}
+
+void SpectatorChannel::stop()
+{
+    if (!m_thread.joinable())
+        return;
+    m_stopping.store(true, memory_order_release);
+    m_thread.join();
+}
+
+//*********************************************************************
+//  The playing thread's side
+//*********************************************************************
+
+void SpectatorChannel::publish()
+{
+    if (m_skipping)
+        return;
+    if (!m_ring.tryPush(m_event))
+    {
+        m_skipping = true;
+        m_skipped.fetch_add(1, memory_order_relaxed);
+    }
+}
+
+void SpectatorChannel::gameStarted(const string& name1, const Board& b1,
+                                   const string& name2, const Board& b2)
+{
+    m_event.kind = SpectatorEvent::STARTED;
+    m_event.game = m_games++;
+    copyName(m_event.names[0], sizeof(m_event.names[0]), name1);
+    copyName(m_event.names[1], sizeof(m_event.names[1]), name2);
+    for (int r = 0; r < m_game.rows(); r++)
+        for (int c = 0; c < m_game.cols(); c++)
+        {
+            m_event.cells[0][r][c] = b1.displaySymbol(Point(r, c), false);
+            m_event.cells[1][r][c] = b2.displaySymbol(Point(r, c), false);
+        }
+    // every game gets a fresh chance of being shown
+    m_skipping = false;
+    publish();
+}
+
+void SpectatorChannel::shotFired(const ShotRecord& shot, const Board& target)
+{
+    m_event.kind = SpectatorEvent::SHOT;
+    m_event.shot = shot;
+    m_event.symbol = m_game.isValid(shot.p) ? target.displaySymbol(shot.p, false) : ' ';
+    publish();
+}
+
+void SpectatorChannel::gameEnded(const GameRecord& rec)
+{
+    m_event.kind = SpectatorEvent::ENDED;
+    m_event.winner = rec.winner;
+    publish();
+}
+
+//*********************************************************************
+//  The renderer's side
+//*********************************************************************
+
+void SpectatorChannel::apply(const SpectatorEvent& e)
+{
+    string prefix = "Game " + to_string(e.game + 1) + ": ";
+    switch (e.kind)
+    {
+        case SpectatorEvent::STARTED:
+            m_shownGame = e.game;
+            m_frame.rows = m_game.rows();
+            m_frame.cols = m_game.cols();
+            m_frame.names[0] = e.names[0];
+            m_frame.names[1] = e.names[1];
+            memcpy(m_frame.cells, e.cells, sizeof(m_frame.cells));
+            m_frame.status = prefix + m_frame.names[0] + " moves first";
+            break;
+        case SpectatorEvent::SHOT:
+            // a game is only sent from its start on, so this is just in case
+            if (e.game != m_shownGame)
+                break;
+            if (m_game.isValid(e.shot.p))
+            {
+                m_frame.cells[1 - e.shot.player][e.shot.p.r][e.shot.p.c] = e.symbol;
+                m_renderer.follow(e.shot.p);
+            }
+            m_frame.status = prefix + describeShot(m_game, m_frame.names[e.shot.player], e.shot);
+            break;
+        case SpectatorEvent::ENDED:
+            if (e.game != m_shownGame)
+                break;
+            if (e.winner >= 0)
+                m_frame.status = prefix + m_frame.names[e.winner] + " wins!";
+            else
+                m_frame.status = prefix + "nobody won";
+            break;
+    }
+}
+
+void SpectatorChannel::render()
+{
+    // the event being applied is big enough not to want on the stack of
+    // every thread, so it lives with the renderer
+    unique_ptr<SpectatorEvent> e(new SpectatorEvent);
+    auto nextFrame = chrono::steady_clock::now();
+    bool changed = false;
+    for (;;)
+    {
+        // read the flag before draining, so nothing pushed before stop()
+        // is left behind
+        bool stopping = m_stopping.load(memory_order_acquire);
+        int n = 0;
+        while (n < MAX_DRAIN  &&  m_ring.tryPop(*e))
+        {
+            apply(*e);
+            n++;
+        }
+        changed = changed  ||  n > 0;
+
+        auto now = chrono::steady_clock::now();
+        if (changed  &&  (now >= nextFrame  ||  (stopping  &&  n == 0)))
+        {
+            int skipped = m_skipped.load(memory_order_relaxed);
+            string status = m_frame.status;
+            if (skipped > 0)
+                m_frame.status += "   (" + to_string(skipped) + " games not shown)";
+            m_renderer.render(m_frame);
+            m_frame.status = status;
+            nextFrame = now + chrono::milliseconds(m_frameMs);
+            changed = false;
+        }
+        if (stopping  &&  n == 0  &&  !changed)
+            return;
+        if (n < MAX_DRAIN)
+            this_thread::sleep_for(chrono::milliseconds(1));
+    }
+}
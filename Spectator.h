@@ -0,0 +1,84 @@
+#ifndef SPECTATOR_INCLUDED
+#define SPECTATOR_INCLUDED
+
+#include "globals.h"
+#include "HeadlessPlay.h"
+#include "Renderer.h"
+#include "SpscRing.h"
+#include <atomic>
+#include <string>
+#include <thread>
+
+class Board;
+class Game;
+
+// One thing a spectator is told about, as it travels from the thread
+// playing the games to the thread drawing them
+struct SpectatorEvent
+{
+    enum Kind { STARTED, SHOT, ENDED };
+    Kind kind;
+    int game;                           // games started before this one
+    char names[2][24];                  // STARTED: the players, first mover first
+    char cells[2][MAXROWS][MAXCOLS];    // STARTED: both boards
+    ShotRecord shot;                    // SHOT
+    char symbol;                        // SHOT: what the attacked cell shows now
+    int winner;                         // ENDED
+};
+
+// A GameObserver that hands the games it is shown to a renderer thread of
+// its own, so they can be watched while being played at full speed.
+//
+// The events go through a lock-free ring, and the thread playing never
+// waits: if the ring is full, the rest of that game is not sent, and the
+// next game that finds room is shown instead.  The renderer applies every
+// event waiting in the ring to its frame and then draws the frame once, at
+// most every frameMs milliseconds, so when games go by faster than the
+// terminal can show them, the frames in between are never drawn.
+//
+// Only one thread at a time may play the games a SpectatorChannel is shown.
+class SpectatorChannel : public GameObserver
+{
+public:
+    SpectatorChannel(const Game& g, int frameMs = 30, int fd = 1);
+    // Draw what is left in the ring and stop the renderer
+    ~SpectatorChannel();
+    void stop();
+
+    virtual void gameStarted(const std::string& name1, const Board& b1,
+                             const std::string& name2, const Board& b2);
+    virtual void shotFired(const ShotRecord& shot, const Board& target);
+    virtual void gameEnded(const GameRecord& rec);
+
+    int games() const { return m_games; }
+    int gamesSkipped() const { return m_skipped; }
+    int framesDrawn() const { return m_renderer.frames(); }
+
+    SpectatorChannel(const SpectatorChannel&) = delete;
+    SpectatorChannel& operator=(const SpectatorChannel&) = delete;
+
+private:
+    void publish();
+    void render();
+    void apply(const SpectatorEvent& e);
+
+    const Game& m_game;
+    int m_frameMs;
+
+    // the playing thread's side
+    SpectatorEvent m_event;             // the event being filled in
+    int m_games;
+    bool m_skipping;                    // the rest of this game is not sent
+    std::atomic<int> m_skipped;
+
+    SpscRing<SpectatorEvent, 256> m_ring;
+
+    // the renderer's side
+    TerminalRenderer m_renderer;
+    Frame m_frame;
+    int m_shownGame;
+    std::atomic<bool> m_stopping;
+    std::thread m_thread;
+};
+
+#endif // SPECTATOR_INCLUDED
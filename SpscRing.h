@@ -0,0 +1,65 @@
+#ifndef SPSCRING_INCLUDED
+#define SPSCRING_INCLUDED
+
+#include <atomic>
+#include <cstddef>
+
+// A bounded queue between exactly one producer thread and one consumer
+// thread, without locks: neither side ever waits for the other.  tryPush
+// fails when the queue is full and tryPop when it is empty, and it is up to
+// the caller what to do then.  N must be a power of 2.
+//
+// Each side keeps its own index on a cache line of its own, and a copy of
+// the other side's index that it only refreshes when the queue looks full
+// (or empty), so most operations touch no shared cache line but the item's.
+template <class T, size_t N>
+class SpscRing
+{
+    static_assert(N > 0  &&  (N & (N - 1)) == 0, "SpscRing's size must be a power of 2");
+public:
+    SpscRing() : m_head(0), m_tailSeen(0), m_tail(0), m_headSeen(0) {}
+
+    // Producer only
+    bool tryPush(const T& item)
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_headSeen == N)
+        {
+            m_headSeen = m_head.load(std::memory_order_acquire);
+            if (tail - m_headSeen == N)
+                return false;
+        }
+        m_items[tail & (N - 1)] = item;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only
+    bool tryPop(T& item)
+    {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tailSeen)
+        {
+            m_tailSeen = m_tail.load(std::memory_order_acquire);
+            if (head == m_tailSeen)
+                return false;
+        }
+        item = m_items[head & (N - 1)];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+private:
+    // the consumer's side
+    alignas(64) std::atomic<size_t> m_head;     // next item to pop
+    size_t m_tailSeen;
+    // the producer's side
+    alignas(64) std::atomic<size_t> m_tail;     // next slot to fill
+    size_t m_headSeen;
+    alignas(64) T m_items[N];
+};
+
+#endif // SPSCRING_INCLUDED
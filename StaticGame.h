@@ -0,0 +1,247 @@
+#ifndef STATICGAME_INCLUDED
+#define STATICGAME_INCLUDED
+
+#include "Game.h"
+#include "Board.h"
+#include "Player.h"
+#include "Bitboard.h"
+#include <iostream>
+#include <utility>
+
+// A fleet for StaticGame is a type, so that the number of ships and their
+// lengths are compile-time constants.  A fleet needs nShips, lengths,
+// symbols and names; see StandardFleet.
+struct StandardFleet
+{
+    static constexpr int nShips = 5;
+    static constexpr int lengths[nShips] = { 5, 4, 3, 3, 2 };
+    static constexpr char symbols[nShips] = { 'A', 'B', 'D', 'S', 'P' };
+    static constexpr const char* names[nShips] = {
+        "aircraft carrier", "battleship", "destroyer", "submarine", "patrol boat"
+    };
+};
+
+// Add every ship of Fleet to g
+template <class Fleet>
+bool addFleet(Game& g)
+{
+    for (int k = 0; k < Fleet::nShips; k++)
+        if ( ! g.addShip(Fleet::lengths[k], Fleet::symbols[k], Fleet::names[k]))
+            return false;
+    return true;
+}
+
+// Every legal position of one ship on an empty Rows x Cols board
+template <int Rows, int Cols>
+struct StaticPlacementTable
+{
+    struct Placement
+    {
+        Bitboard mask;
+        int r;
+        int c;
+        Direction dir;
+    };
+
+    Placement placements[2 * Rows * Cols];
+    int count;
+};
+
+template <int Rows, int Cols>
+constexpr StaticPlacementTable<Rows, Cols> makeStaticPlacements(int len)
+{
+    StaticPlacementTable<Rows, Cols> t{};
+    t.count = 0;
+    for (int r = 0; r < Rows; r++)
+        for (int c = 0; c + len <= Cols; c++)
+            t.placements[t.count++] = { shipMask(r, c, len, HORIZONTAL), r, c, HORIZONTAL };
+    // a length 1 ship looks the same both ways
+    if (len > 1)
+        for (int r = 0; r + len <= Rows; r++)
+            for (int c = 0; c < Cols; c++)
+                t.placements[t.count++] = { shipMask(r, c, len, VERTICAL), r, c, VERTICAL };
+    return t;
+}
+
+template <int Rows, int Cols, class Fleet>
+struct StaticFleetTables
+{
+    StaticPlacementTable<Rows, Cols> ships[Fleet::nShips];
+};
+
+template <int Rows, int Cols, class Fleet>
+constexpr StaticFleetTables<Rows, Cols, Fleet> makeStaticFleetTables()
+{
+    StaticFleetTables<Rows, Cols, Fleet> t{};
+    for (int k = 0; k < Fleet::nShips; k++)
+        t.ships[k] = makeStaticPlacements<Rows, Cols>(Fleet::lengths[k]);
+    return t;
+}
+
+// A game engine for one fixed board size and fleet.  The board is kept as
+// bitmasks and all loop bounds and placement tables are compile-time
+// constants, so the per-shot work is a handful of 128-bit operations.
+//
+// Players are the same Player objects used with Game: construct them with
+// game(), which is an ordinary Game set up with Fleet.  Nothing is
+// displayed, so StaticGame is meant for computer players; use Game for
+// anything that involves a human.
+template <int Rows, int Cols, class Fleet>
+class StaticGame
+{
+    static_assert(Rows >= 1  &&  Rows <= MAXROWS, "bad number of rows");
+    static_assert(Cols >= 1  &&  Cols <= MAXCOLS, "bad number of columns");
+    static_assert(Fleet::nShips >= 1, "fleet must have a ship");
+
+public:
+    static constexpr int nShips = Fleet::nShips;
+    typedef StaticPlacementTable<Rows, Cols> PlacementTable;
+
+    // a game that has not ended after this many shots (by both players
+    // together) is abandoned
+    static constexpr int maxTurns = 4 * Rows * Cols;
+
+    static constexpr StaticFleetTables<Rows, Cols, Fleet> tables = makeStaticFleetTables<Rows, Cols, Fleet>();
+
+    static constexpr const PlacementTable& placements(int shipId) { return tables.ships[shipId]; }
+
+    StaticGame()
+    : m_game(Rows, Cols)
+    {
+        addFleet<Fleet>(m_game);
+    }
+
+    const Game& game() const { return m_game; }
+
+    // Play one game; returns the winner, or nullptr if a player could not
+    // place its ships or the game did not finish within maxTurns.
+    Player* play(Player* p1, Player* p2);
+
+    StaticGame(const StaticGame&) = delete;
+    StaticGame& operator=(const StaticGame&) = delete;
+
+private:
+    // one player's fleet, as the cells of each ship plus the cells shot at
+    struct Fleetboard
+    {
+        Bitboard ships[nShips];
+        Bitboard occupied;
+        Bitboard shots;
+    };
+
+    bool readFleet(const Board& b, Fleetboard& f) const;
+    static bool attack(Fleetboard& f, Point p, bool& shotHit, bool& shipDestroyed, int& shipId);
+
+    Game m_game;
+};
+
+// Copy the ships a player placed on b into bitmasks.  Each ship must cover
+// exactly one of its legal placements.
+template <int Rows, int Cols, class Fleet>
+bool StaticGame<Rows, Cols, Fleet>::readFleet(const Board& b, Fleetboard& f) const
+{
+    for (int k = 0; k < nShips; k++)
+        f.ships[k] = Bitboard();
+    for (int r = 0; r < Rows; r++)
+        for (int c = 0; c < Cols; c++)
+        {
+            int id = b.shipAt(Point(r, c));
+            if (id >= 0)
+                f.ships[id] |= Bitboard::cell(r, c);
+        }
+
+    f.occupied = Bitboard();
+    f.shots = Bitboard();
+    for (int k = 0; k < nShips; k++)
+    {
+        const PlacementTable& t = placements(k);
+        bool found = false;
+        for (int i = 0; i < t.count && !found; i++)
+            found = (t.placements[i].mask == f.ships[k]);
+        if (!found)
+            return false;
+        f.occupied |= f.ships[k];
+    }
+    return true;
+}
+
+template <int Rows, int Cols, class Fleet>
+bool StaticGame<Rows, Cols, Fleet>::attack(Fleetboard& f, Point p, bool& shotHit, bool& shipDestroyed, int& shipId)
+{
+    shotHit = false;
+    shipDestroyed = false;
+    if (p.r < 0  ||  p.r >= Rows  ||  p.c < 0  ||  p.c >= Cols  ||  f.shots.test(p))
+        return false;
+
+    Bitboard cell = Bitboard::cell(p);
+    f.shots |= cell;
+    if (!f.occupied.intersects(cell))
+        return true;
+
+    shotHit = true;
+    for (int k = 0; k < nShips; k++)
+        if (f.ships[k].intersects(cell))
+        {
+            if (f.shots.contains(f.ships[k]))
+            {
+                shipDestroyed = true;
+                shipId = k;
+            }
+            break;
+        }
+    return true;
+}
+
+template <int Rows, int Cols, class Fleet>
+Player* StaticGame<Rows, Cols, Fleet>::play(Player* p1, Player* p2)
+{
+    if (p1 == nullptr  ||  p2 == nullptr)
+        return nullptr;
+    if (p1->isHuman()  ||  p2->isHuman())
+    {
+        std::cout << "ERROR: StaticGame does not display boards, so it cannot be played by a human" << std::endl;
+        return nullptr;
+    }
+
+    Board b1(m_game);
+    Board b2(m_game);
+    Fleetboard f1;
+    Fleetboard f2;
+
+    if (!p1->placeShips(b1)  ||  !readFleet(b1, f1))
+    {
+        std::cout << "ERROR: Ships cannot be placed for P1, Game cannot start" << std::endl;
+        return nullptr;
+    }
+    if (!p2->placeShips(b2)  ||  !readFleet(b2, f2))
+    {
+        std::cout << "ERROR: Ships cannot be placed for P2, Game cannot start" << std::endl;
+        return nullptr;
+    }
+
+    Player* attacker = p1;
+    Player* defender = p2;
+    Fleetboard* target = &f2;
+
+    for (int turn = 0; turn < maxTurns; turn++)
+    {
+        bool hit = false;
+        bool destroy = false;
+        int id = -1;
+
+        Point p = attacker->recommendAttack();
+        bool shot = attack(*target, p, hit, destroy, id);
+        defender->recordAttackByOpponent(p);
+        attacker->recordAttackResult(p, shot, hit, destroy, id);
+
+        if (target->shots.contains(target->occupied))
+            return attacker;
+
+        std::swap(attacker, defender);
+        target = (target == &f2 ? &f1 : &f2);
+    }
+
+    return nullptr;
+}
+
+#endif // STATICGAME_INCLUDED
@@ -0,0 +1,214 @@
+#include "Targeting.h"
+#include "globals.h"
+
+using namespace std;
+
+namespace {
+
+const int DR[2] = { 0, 1 };     // the step along each Direction
+const int DC[2] = { 1, 0 };
+
+}  // end of anonymous namespace
+
+CellPool::CellPool(int nRows, int nCols)
+: m_rows(nRows), m_cols(nCols)
+{
+    reset();
+}
+
+void CellPool::reset()
+{
+    m_cells.clear();
+    m_where.assign(MAXROWS * MAXCOLS, -1);
+    for (int r = 0; r < m_rows; r++)
+        for (int c = 0; c < m_cols; c++)
+        {
+            m_where[Bitboard::index(r, c)] = (int)m_cells.size();
+            m_cells.push_back(Bitboard::index(r, c));
+        }
+}
+
+void CellPool::remove(Point p)
+{
+    if (p.r < 0  ||  p.r >= m_rows  ||  p.c < 0  ||  p.c >= m_cols)
+        return;
+    int cell = Bitboard::index(p);
+    int k = m_where[cell];
+    if (k < 0)
+        return;
+    m_cells[k] = m_cells.back();
+    m_where[m_cells[k]] = k;
+    m_cells.pop_back();
+    m_where[cell] = -1;
+}
+
+Point CellPool::draw()
+{
+    Point p = Bitboard::point(m_cells[randInt((int)m_cells.size())]);
+    remove(p);
+    return p;
+}
+
+//*********************************************************************
+//  TargetFrontier
+//*********************************************************************
+
+TargetFrontier::TargetFrontier(int nRows, int nCols)
+: m_rows(nRows), m_cols(nCols), m_dir(-1)
+{}
+
+void TargetFrontier::reset()
+{
+    m_shots = Bitboard();
+    m_open = Bitboard();
+    m_frontier.clear();
+    m_dir = -1;
+}
+
+bool TargetFrontier::nextTarget(Point& p)
+{
+    while (!m_frontier.empty())
+    {
+        int cell = m_frontier.front();
+        m_frontier.pop_front();
+        if (!m_shots.testBit(cell))
+        {
+            p = Bitboard::point(cell);
+            return true;
+        }
+    }
+    return false;
+}
+
+int TargetFrontier::runEnd(int cell, int dr, int dc) const
+{
+    Point p = Bitboard::point(cell);
+    int r = p.r + dr;
+    int c = p.c + dc;
+    while (onBoard(r, c)  &&  m_open.testBit(Bitboard::index(r, c)))
+    {
+        r += dr;
+        c += dc;
+    }
+    if (!onBoard(r, c)  ||  m_shots.testBit(Bitboard::index(r, c)))
+        return -1;
+    return Bitboard::index(r, c);
+}
+
+void TargetFrontier::queueAround(int cell)
+{
+    Point p = Bitboard::point(cell);
+    for (int d = 0; d < 2; d++)
+    {
+        if (d == m_dir)
+            continue;
+        for (int sign = -1; sign <= 1; sign += 2)
+        {
+            int r = p.r + sign * DR[d];
+            int c = p.c + sign * DC[d];
+            if (!onBoard(r, c)  ||  m_shots.testBit(Bitboard::index(r, c)))
+                continue;
+            // with no orientation yet, every neighbor is as good as another
+            if (m_dir < 0)
+                m_frontier.push_front(Bitboard::index(r, c));
+            else
+                m_frontier.push_back(Bitboard::index(r, c));
+        }
+    }
+    if (m_dir >= 0)
+        for (int sign = -1; sign <= 1; sign += 2)
+        {
+            int end = runEnd(cell, sign * DR[m_dir], sign * DC[m_dir]);
+            if (end >= 0)
+                m_frontier.push_front(end);
+        }
+}
+
+void TargetFrontier::forget(int cell)
+{
+    m_open = m_open.without(Bitboard::bit(cell));
+}
+
+void TargetFrontier::record(Point p, bool shotHit, bool shipDestroyed, int sunkLength)
+{
+    if (!onBoard(p.r, p.c))
+        return;
+    const int cell = Bitboard::index(p);
+    m_shots |= Bitboard::bit(cell);
+
+    if (!shotHit)
+    {
+        // if the line is closed at both ends without sinking anything, the
+        // hits on it belong to ships lying across it
+        if (m_dir >= 0  &&  !m_open.empty())
+        {
+            Bitboard open = m_open;
+            bool anyEnd = false;
+            while (!open.empty()  &&  !anyEnd)
+            {
+                int h = open.popLowest();
+                anyEnd = runEnd(h, DR[m_dir], DC[m_dir]) >= 0  ||
+                         runEnd(h, -DR[m_dir], -DC[m_dir]) >= 0;
+            }
+            if (!anyEnd)
+            {
+                m_dir = -1;
+                open = m_open;
+                while (!open.empty())
+                    queueAround(open.popLowest());
+            }
+        }
+        return;
+    }
+
+    if (!shipDestroyed)
+    {
+        // two adjacent hits give the orientation
+        if (m_dir < 0)
+            for (int d = 0; d < 2  &&  m_dir < 0; d++)
+                for (int sign = -1; sign <= 1; sign += 2)
+                {
+                    int r = p.r + sign * DR[d];
+                    int c = p.c + sign * DC[d];
+                    if (onBoard(r, c)  &&  m_open.testBit(Bitboard::index(r, c)))
+                        m_dir = d;
+                }
+        m_open |= Bitboard::bit(cell);
+        queueAround(cell);
+        return;
+    }
+
+    // take the sunk ship's cells off the unresolved hits: a run of hits
+    // through p, along the orientation if it is known
+    m_open |= Bitboard::bit(cell);
+    bool removed = false;
+    for (int d = 0; d < 2  &&  !removed; d++)
+    {
+        if (m_dir >= 0  &&  d != m_dir)
+            continue;
+        int before = 0;     // hits in a row on each side of p
+        int after = 0;
+        while (onBoard(p.r - (before + 1) * DR[d], p.c - (before + 1) * DC[d])  &&
+               m_open.testBit(Bitboard::index(p.r - (before + 1) * DR[d], p.c - (before + 1) * DC[d])))
+            before++;
+        while (onBoard(p.r + (after + 1) * DR[d], p.c + (after + 1) * DC[d])  &&
+               m_open.testBit(Bitboard::index(p.r + (after + 1) * DR[d], p.c + (after + 1) * DC[d])))
+            after++;
+        int len = (sunkLength > 0 ? sunkLength : before + after + 1);
+        if (len == 1  ||  before + after + 1 < len)
+            continue;
+        // the ship most likely ends at p, the cell that sank it
+        int first = (before >= len - 1 ? -(len - 1) : (after >= len - 1 ? 0 : -before));
+        for (int k = first; k < first + len; k++)
+            forget(Bitboard::index(p.r + k * DR[d], p.c + k * DC[d]));
+        removed = true;
+    }
+    if (!removed)
+        forget(cell);
+
+    m_dir = -1;
+    m_frontier.clear();
+    Bitboard open = m_open;
+    while (!open.empty())
+        queueAround(open.popLowest());
+}
@@ -0,0 +1,84 @@
+#ifndef TARGETING_INCLUDED
+#define TARGETING_INCLUDED
+
+#include "Bitboard.h"
+#include <deque>
+#include <vector>
+
+// The cells of a board not yet shot at, to draw one at random or cross one
+// off in constant time, instead of drawing cells until one is new
+class CellPool
+{
+public:
+    CellPool(int nRows, int nCols);
+    void reset();
+    bool empty() const { return m_cells.empty(); }
+    bool contains(Point p) const
+    {
+        return p.r >= 0  &&  p.r < m_rows  &&  p.c >= 0  &&  p.c < m_cols  &&
+               m_where[Bitboard::index(p)] >= 0;
+    }
+    void remove(Point p);
+    // A cell drawn uniformly at random and removed; the pool must not be
+    // empty
+    Point draw();
+
+private:
+    int m_rows;
+    int m_cols;
+    std::vector<int> m_cells;
+    std::vector<int> m_where;       // [cell] position in m_cells, or -1
+};
+
+// The target half of a hunt/target attacker: once a shot hits, which cells
+// to try next to finish the ship off.
+//
+// It keeps the hits not yet put down to a sunk ship, and a frontier of
+// unshot cells next to them.  Cells along the line through two adjacent
+// hits go to the front of the frontier, since that is the ship's
+// orientation; the other neighbors wait at the back in case the hits
+// belong to ships lying side by side.  A miss closes the branch it was
+// shot at.  When a ship is sunk, its cells are taken off the unresolved
+// hits, and if none are left the whole frontier is dropped; otherwise the
+// frontier is rebuilt around the hits that are left.  Picking the next
+// target pops cells off the front, skipping any already shot, so it takes
+// constant time apart from cells that were queued twice.
+class TargetFrontier
+{
+public:
+    TargetFrontier(int nRows, int nCols);
+    void reset();
+
+    // true while some hit has not been put down to a sunk ship
+    bool active() const { return !m_open.empty(); }
+
+    // The next cell to shoot at around the unresolved hits; false if there
+    // is none
+    bool nextTarget(Point& p);
+
+    // Update with the result of a valid shot.  sunkLength is the length of
+    // the ship the shot sank, or 0 if that is not known.
+    void record(Point p, bool shotHit, bool shipDestroyed, int sunkLength = 0);
+
+    bool wasShot(Point p) const { return m_shots.testBit(Bitboard::index(p)); }
+    Bitboard shots() const { return m_shots; }
+
+private:
+    bool onBoard(int r, int c) const { return r >= 0  &&  r < m_rows  &&  c >= 0  &&  c < m_cols; }
+    // queue the unshot neighbors of cell: along dir at the front, the
+    // others at the back
+    void queueAround(int cell);
+    // the first unshot cell past the run of unresolved hits from cell
+    // going (dr,dc), or -1 if a miss or the edge comes first
+    int runEnd(int cell, int dr, int dc) const;
+    void forget(int cell);
+
+    int m_rows;
+    int m_cols;
+    Bitboard m_shots;
+    Bitboard m_open;                // hits not yet put down to a sunk ship
+    std::deque<int> m_frontier;
+    int m_dir;                      // HORIZONTAL, VERTICAL, or -1 if not known
+};
+
+#endif // TARGETING_INCLUDED
@@ -0,0 +1,639 @@
+#include "Tournament.h"
+#include "ExternalBot.h"
+#include "HeadlessPlay.h"
+#include "Replay.h"
+#include "Player.h"
+#include "Game.h"
+#include "globals.h"
+#include "OpponentModel.h"
+#include "SpscRing.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+// Seed for game k of a tournament
+static unsigned gameSeed(unsigned seed, int k)
+{
+    unsigned long long z = (unsigned long long)seed << 32 | (unsigned)k;
+    z += 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return (unsigned)(z ^ (z >> 31));
+}
+
+// Play game k of the tournament and add its outcome to result.  Returns
+// the winner as in GameRecord, i.e., 0 if the player who moved first won.
+static int playTournamentGame(const Game& g, const string& type1, const string& type2,
+                              int k, bool staticDispatch, unsigned seed,
+                              TournamentResult& result, vector<ShotRecord>* log,
+                              GameObserver* observer)
+{
+    // the second type moves first in every other game
+    bool swapped = (k % 2 == 1);
+    const string& first = swapped ? type2 : type1;
+    const string& second = swapped ? type1 : type2;
+    
+    seedRandom(gameSeed(seed, k));
+    
+    GameRecord rec;
+    if (staticDispatch)
+    {
+        if (!playHeadlessGame(first, second, g, rec, log, observer))
+            rec.winner = -1;
+    }
+    else
+    {
+        Player* p1 = createPlayer(first, first, g);
+        Player* p2 = createPlayer(second, second, g);
+        if (p1 != nullptr  &&  p2 != nullptr  &&  !p1->isHuman()  &&  !p2->isHuman())
+            playHeadless(g, *p1, *p2, rec, log, observer);
+        else
+            rec.winner = -1;
+        delete p1;
+        delete p2;
+    }
+    
+    result.games++;
+    if (rec.winner == -1)
+        result.unfinished++;
+    else
+        result.wins[rec.winner ^ swapped]++;
+    result.shots[0] += rec.shots[swapped];
+    result.shots[1] += rec.shots[!swapped];
+    return rec.winner;
+}
+
+// Keeps the match of the games a thread plays open: a new one starts with
+// the first game of every match, or wherever the games stop following on
+// from each other
+class MatchOpener
+{
+public:
+    void enter(int k)
+    {
+        if (m_match == nullptr  ||  k != m_next  ||  k % MATCH_GAMES == 0)
+        {
+            m_match.reset();
+            m_match.reset(new MatchModels);
+        }
+        m_next = k + 1;
+    }
+    
+private:
+    unique_ptr<MatchModels> m_match;
+    int m_next = -1;
+};
+
+// Add the games counted in from to those in to
+static void addResults(TournamentResult& to, const TournamentResult& from)
+{
+    to.games += from.games;
+    to.unfinished += from.unfinished;
+    to.crashed += from.crashed;
+    for (int i = 0; i < 2; i++)
+    {
+        to.wins[i] += from.wins[i];
+        to.shots[i] += from.shots[i];
+    }
+}
+
+TournamentResult runTournament(const Game& g, string type1, string type2,
+                               int nGames, bool staticDispatch,
+                               int nThreads, unsigned seed,
+                               ReplayWriter* archive, GameObserver* spectator)
+{
+    TournamentResult total;
+    if (nThreads < 1)
+        nThreads = 1;
+    
+    auto start = chrono::steady_clock::now();
+    
+    // threads take the next unplayed match until there are none left
+    atomic<int> next(0);
+    mutex totalMutex;
+    auto worker = [&](GameObserver* observer) {
+        TournamentResult mine;
+        vector<ShotRecord> log;
+        ReplayBlock block;
+        MatchOpener opener;
+        
+        // counters are per thread, so each worker opens its own
+        PerfMode mode = perfMode();
+        unique_ptr<PerfCounters> counters;
+        if (mode != PERF_OFF)
+            counters.reset(new PerfCounters);
+        setRegionCounters(mode == PERF_REGIONS ? counters.get() : nullptr);
+        
+        for (int m = next++; m * MATCH_GAMES < nGames; m = next++)
+            for (int k = m * MATCH_GAMES; k < nGames  &&  k < (m + 1) * MATCH_GAMES; k++)
+            {
+                log.clear();
+                opener.enter(k);
+                if (counters != nullptr)
+                    counters->startGame();
+                int winner = playTournamentGame(g, type1, type2, k, staticDispatch, seed, mine,
+                                                archive != nullptr ? &log : nullptr, observer);
+                if (counters != nullptr)
+                    counters->endGame();
+                if (archive != nullptr  &&  !block.add(log, winner))
+                {
+                    archive->writeBlock(block);
+                    block.add(log, winner);
+                }
+            }
+        if (archive != nullptr)
+            archive->writeBlock(block);
+        setRegionCounters(nullptr);
+        
+        lock_guard<mutex> lock(totalMutex);
+        if (counters != nullptr)
+            total.perf.add(counters->report());
+        addResults(total, mine);
+    };
+    
+    vector<thread> threads;
+    for (int t = 1; t < nThreads; t++)
+        threads.push_back(thread(worker, nullptr));
+    worker(spectator);
+    for (size_t t = 0; t < threads.size(); t++)
+        threads[t].join();
+    
+    chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+    total.milliseconds = elapsed.count();
+    return total;
+}
+
+//*********************************************************************
+//  Tournaments in worker processes
+//*********************************************************************
+
+// games per range handed to a worker, whole matches; enough that handing
+// them out costs little, few enough that a crash does not throw much work
+// away
+const int FORKED_RANGE = 128;
+static_assert(FORKED_RANGE % MATCH_GAMES == 0, "a range must hold whole matches");
+
+// ranges a worker may have waiting besides the one it is playing
+const size_t FORKED_AHEAD = 1;
+
+// tries at starting a worker, and the pause before the nth retry is n
+// times this many microseconds
+const int FORK_RETRIES = 5;
+const int FORK_RETRY_US = 20000;
+
+struct GameRange
+{
+    int first;
+    int end;
+};
+
+struct RangeResult
+{
+    GameRange range;
+    TournamentResult totals;    // without perf, which is not sent back
+};
+
+// What a worker shares with the parent: a ring of ranges to play, a ring
+// of results, and the game it is playing, so the parent knows which game
+// to blame if it dies
+struct WorkerChannel
+{
+    SpscRing<GameRange, 4> work;
+    SpscRing<RangeResult, 4> results;
+    atomic<int> current;
+    atomic<bool> stop;
+};
+
+static_assert(atomic<size_t>::is_always_lock_free  &&  atomic<int>::is_always_lock_free,
+              "the rings shared between processes must not need locks");
+
+static void forkedWorker(WorkerChannel& ch, const Game& g, const string& type1,
+                         const string& type2, bool staticDispatch, unsigned seed)
+{
+    GameRange range;
+    MatchOpener opener;
+    for (;;)
+    {
+        if (!ch.work.tryPop(range))
+        {
+            if (ch.stop.load(memory_order_acquire))
+                return;
+            usleep(100);
+            continue;
+        }
+        RangeResult result;
+        result.range = range;
+        for (int k = range.first; k < range.end; k++)
+        {
+            ch.current.store(k, memory_order_relaxed);
+            opener.enter(k);
+            playTournamentGame(g, type1, type2, k, staticDispatch, seed, result.totals,
+                               nullptr, nullptr);
+        }
+        // from here on, dying would blame no game
+        ch.current.store(range.end, memory_order_relaxed);
+        while (!ch.results.tryPush(result))
+            usleep(100);
+    }
+}
+
+TournamentResult runForkedTournament(const Game& g, string type1, string type2,
+                                     int nGames, bool staticDispatch,
+                                     int nWorkers, unsigned seed)
+{
+    TournamentResult total;
+    if (nWorkers < 1)
+        nWorkers = 1;
+    
+    auto start = chrono::steady_clock::now();
+    
+    deque<GameRange> queue;
+    for (int first = 0; first < nGames; first += FORKED_RANGE)
+        queue.push_back(GameRange{ first, min(nGames, first + FORKED_RANGE) });
+    
+    void* shared = mmap(nullptr, nWorkers * sizeof(WorkerChannel), PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED)
+        return total;
+    WorkerChannel* channels = static_cast<WorkerChannel*>(shared);
+    
+    struct Worker
+    {
+        pid_t pid = -1;
+        deque<GameRange> assigned;  // in the order they will be played
+    };
+    vector<Worker> workers(nWorkers);
+    
+    // anything buffered would otherwise be written once by every worker too
+    cout.flush();
+    fflush(stdout);
+    
+    pid_t parent = getpid();
+    
+    // start worker w, trying again a few times if fork fails (it can run
+    // out of processes for a moment); if it never succeeds the worker's
+    // pid stays -1 and the others go on without it
+    auto spawn = [&](int w) {
+        WorkerChannel* ch = new (&channels[w]) WorkerChannel;
+        ch->current.store(-1);
+        ch->stop.store(false);
+        workers[w].assigned.clear();
+        pid_t pid = -1;
+        for (int attempt = 0; attempt < FORK_RETRIES  &&  pid < 0; attempt++)
+        {
+            if (attempt > 0)
+                usleep(FORK_RETRY_US * attempt);
+            pid = fork();
+        }
+        if (pid == 0)
+        {
+            // a worker that outlives the parent would wait for work forever,
+            // so it dies with it (checking it is still there, in case the
+            // parent died before this); and the parent's idle bots are not
+            // the worker's to play with, or two workers could share one
+            prctl(PR_SET_PDEATHSIG, SIGKILL);
+            if (getppid() != parent)
+                _exit(1);
+            BotProcess::forgetPool();
+            forkedWorker(*ch, g, type1, type2, staticDispatch, seed);
+            _exit(0);
+        }
+        workers[w].pid = pid;
+    };
+    
+    // collect what worker w has finished; true if there was anything
+    auto collect = [&](int w) {
+        bool any = false;
+        RangeResult r;
+        while (channels[w].results.tryPop(r))
+        {
+            addResults(total, r.totals);
+            workers[w].assigned.pop_front();
+            any = true;
+        }
+        return any;
+    };
+    
+    for (int w = 0; w < nWorkers  &&  w * FORKED_RANGE < nGames; w++)
+        spawn(w);
+    
+    for (;;)
+    {
+        bool busy = false;
+        bool progress = false;
+        int alive = 0;
+        for (int w = 0; w < nWorkers; w++)
+        {
+            if (workers[w].pid <= 0)
+                continue;
+            alive++;
+            progress = collect(w)  ||  progress;
+            while (workers[w].assigned.size() <= FORKED_AHEAD  &&  !queue.empty()  &&
+                   channels[w].work.tryPush(queue.front()))
+            {
+                workers[w].assigned.push_back(queue.front());
+                queue.pop_front();
+            }
+            busy = busy  ||  !workers[w].assigned.empty();
+        }
+        
+        // no worker could be started, so nothing left will be played
+        if (alive == 0)
+        {
+            for (const GameRange& r : queue)
+            {
+                total.games += r.end - r.first;
+                total.unfinished += r.end - r.first;
+            }
+            break;
+        }
+        
+        // a worker that died with ranges unfinished crashed in the first
+        // one.  Each worker is waited for by its own pid, so that children
+        // the players started themselves (external bots) are left alone.
+        for (int w = 0; w < nWorkers; w++)
+        {
+            if (workers[w].pid <= 0  ||  waitpid(workers[w].pid, nullptr, WNOHANG) != workers[w].pid)
+                continue;
+            collect(w);
+            workers[w].pid = -1;
+            deque<GameRange>& lost = workers[w].assigned;
+            if (lost.empty())
+            {
+                if (!queue.empty())
+                    spawn(w);
+                continue;
+            }
+            int crashedGame = channels[w].current.load();
+            GameRange first = lost.front();
+            lost.pop_front();
+            if (crashedGame >= first.first  &&  crashedGame < first.end)
+            {
+                total.games++;
+                total.unfinished++;
+                total.crashed++;
+                if (crashedGame + 1 < first.end)
+                    queue.push_front(GameRange{ crashedGame + 1, first.end });
+                if (first.first < crashedGame)
+                    queue.push_front(GameRange{ first.first, crashedGame });
+            }
+            else
+                queue.push_front(first);
+            while (!lost.empty())
+            {
+                queue.push_back(lost.front());
+                lost.pop_front();
+            }
+            spawn(w);
+            progress = true;
+            busy = true;
+        }
+        
+        if (!busy  &&  queue.empty())
+            break;
+        if (!progress)
+            usleep(200);
+    }
+    
+    for (int w = 0; w < nWorkers; w++)
+    {
+        if (workers[w].pid <= 0)
+            continue;
+        channels[w].stop.store(true, memory_order_release);
+        waitpid(workers[w].pid, nullptr, 0);
+    }
+    munmap(shared, nWorkers * sizeof(WorkerChannel));
+    
+    chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+    total.milliseconds = elapsed.count();
+    return total;
+}
+
+//*********************************************************************
+//  Checkpointed tournaments
+//*********************************************************************
+
+static_assert(CHECKPOINT_CHUNK % MATCH_GAMES == 0, "a chunk must hold whole matches");
+
+// What a checkpoint file holds: the tournament, as one line, which chunks
+// of games have been played, and the totals of those games
+struct Checkpoint
+{
+    string tournament;
+    vector<char> done;
+    TournamentResult totals;
+};
+
+static string describeTournament(const Game& g, const string& type1, const string& type2,
+                                 int nGames, bool staticDispatch, unsigned seed)
+{
+    ostringstream out;
+    out << type1 << " " << type2 << " " << nGames << " games, seed " << seed << ", "
+        << (staticDispatch ? "static" : "virtual") << ", " << g.rows() << "x" << g.cols();
+    for (int s = 0; s < g.nShips(); s++)
+        out << " " << g.shipLength(s);
+    return out.str();
+}
+
+// The file is text, one field per line:
+//
+//     battleship checkpoint 1
+//     tournament <description>
+//     done <chunks> <first-last of each run of finished chunks>...
+//     games <n> unfinished <n> wins <n> <n> shots <n> <n>
+static bool loadCheckpoint(string path, Checkpoint& cp)
+{
+    ifstream in(path);
+    string line;
+    if (!in  ||  !getline(in, line)  ||  line != "battleship checkpoint 1")
+        return false;
+    bool haveDone = false;
+    bool haveTotals = false;
+    while (getline(in, line))
+    {
+        istringstream fields(line);
+        string key;
+        fields >> key;
+        if (key == "tournament")
+        {
+            getline(fields >> ws, cp.tournament);
+        }
+        else if (key == "done")
+        {
+            int nChunks;
+            if (!(fields >> nChunks)  ||  nChunks < 0)
+                return false;
+            cp.done.assign(nChunks, 0);
+            int first;
+            int last;
+            char dash;
+            while (fields >> first >> dash >> last)
+            {
+                if (dash != '-'  ||  first < 0  ||  last >= nChunks  ||  first > last)
+                    return false;
+                for (int c = first; c <= last; c++)
+                    cp.done[c] = 1;
+            }
+            haveDone = true;
+        }
+        else if (key == "games")
+        {
+            TournamentResult& t = cp.totals;
+            string unfinished, wins, shots;
+            haveTotals = bool(fields >> t.games >> unfinished >> t.unfinished >> wins
+                                     >> t.wins[0] >> t.wins[1] >> shots >> t.shots[0] >> t.shots[1]);
+        }
+    }
+    return haveDone  &&  haveTotals;
+}
+
+// Write the checkpoint next to path and rename it into place, so the file
+// at path is always either the old checkpoint or the new one, whole
+static bool saveCheckpoint(string path, const Checkpoint& cp)
+{
+    string temp = path + ".tmp";
+    FILE* f = fopen(temp.c_str(), "w");
+    if (f == nullptr)
+        return false;
+    fprintf(f, "battleship checkpoint 1\n");
+    fprintf(f, "tournament %s\n", cp.tournament.c_str());
+    fprintf(f, "done %d", (int)cp.done.size());
+    for (size_t c = 0; c < cp.done.size(); c++)
+    {
+        if (!cp.done[c])
+            continue;
+        size_t last = c;
+        while (last + 1 < cp.done.size()  &&  cp.done[last + 1])
+            last++;
+        fprintf(f, " %d-%d", (int)c, (int)last);
+        c = last;
+    }
+    const TournamentResult& t = cp.totals;
+    fprintf(f, "\ngames %d unfinished %d wins %d %d shots %lld %lld\n",
+            t.games, t.unfinished, t.wins[0], t.wins[1], t.shots[0], t.shots[1]);
+    bool ok = (fflush(f) == 0  &&  fsync(fileno(f)) == 0);
+    ok = (fclose(f) == 0)  &&  ok;
+    return ok  &&  rename(temp.c_str(), path.c_str()) == 0;
+}
+
+static atomic<bool> s_interrupted(false);
+
+extern "C" void onInterrupt(int)
+{
+    s_interrupted.store(true);
+}
+
+TournamentResult runCheckpointedTournament(const Game& g, string type1, string type2,
+                                           int nGames, bool staticDispatch, int nThreads,
+                                           unsigned seed, string checkpointPath,
+                                           CheckpointStatus& status, double saveSeconds)
+{
+    if (nThreads < 1)
+        nThreads = 1;
+    const int nChunks = (nGames + CHECKPOINT_CHUNK - 1) / CHECKPOINT_CHUNK;
+    
+    Checkpoint cp;
+    string tournament = describeTournament(g, type1, type2, nGames, staticDispatch, seed);
+    if (loadCheckpoint(checkpointPath, cp))
+    {
+        if (cp.tournament != tournament  ||  (int)cp.done.size() != nChunks)
+        {
+            status = CHECKPOINT_MISMATCH;
+            return TournamentResult();
+        }
+    }
+    else
+    {
+        cp = Checkpoint();
+        cp.tournament = tournament;
+        cp.done.assign(nChunks, 0);
+    }
+    
+    auto start = chrono::steady_clock::now();
+    
+    s_interrupted.store(false);
+    struct sigaction action;
+    struct sigaction oldAction;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = onInterrupt;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, &oldAction);
+    
+    // threads take the next unplayed chunk until there are none left; a
+    // chunk's games are only added to the totals once all have been played
+    atomic<int> next(0);
+    mutex cpMutex;
+    auto lastSave = start;
+    bool saved = true;
+    auto worker = [&]() {
+        MatchOpener opener;
+        for (int c = next++; c < nChunks  &&  !s_interrupted.load(); c = next++)
+        {
+            if (cp.done[c])
+                continue;
+            TournamentResult mine;
+            int end = min(nGames, (c + 1) * CHECKPOINT_CHUNK);
+            int k;
+            for (k = c * CHECKPOINT_CHUNK; k < end  &&  !s_interrupted.load(); k++)
+            {
+                opener.enter(k);
+                playTournamentGame(g, type1, type2, k, staticDispatch, seed, mine, nullptr, nullptr);
+            }
+            if (k < end)
+                break;
+            
+            lock_guard<mutex> lock(cpMutex);
+            addResults(cp.totals, mine);
+            cp.done[c] = 1;
+            auto now = chrono::steady_clock::now();
+            if (chrono::duration<double>(now - lastSave).count() >= saveSeconds)
+            {
+                saved = saveCheckpoint(checkpointPath, cp)  &&  saved;
+                lastSave = now;
+            }
+        }
+    };
+    
+    vector<thread> threads;
+    for (int t = 1; t < nThreads; t++)
+        threads.push_back(thread(worker));
+    worker();
+    for (size_t t = 0; t < threads.size(); t++)
+        threads[t].join();
+    
+    saved = saveCheckpoint(checkpointPath, cp)  &&  saved;
+    sigaction(SIGINT, &oldAction, nullptr);
+    
+    bool finished = true;
+    for (int c = 0; c < nChunks; c++)
+        finished = finished  &&  cp.done[c];
+    if (!saved)
+        status = CHECKPOINT_UNWRITABLE;
+    else
+        status = finished ? TOURNAMENT_FINISHED : TOURNAMENT_INTERRUPTED;
+    
+    TournamentResult total = cp.totals;
+    chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+    total.milliseconds = elapsed.count();
+    return total;
+}
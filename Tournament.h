@@ -0,0 +1,97 @@
+#ifndef TOURNAMENT_INCLUDED
+#define TOURNAMENT_INCLUDED
+
+#include "PerfCounters.h"
+#include <string>
+
+class Game;
+class ReplayWriter;
+class GameObserver;
+
+// Totals from a tournament.  Index 0 is the first player type, 1 the second.
+struct TournamentResult
+{
+    int games = 0;
+    int wins[2] = { 0, 0 };
+    int unfinished = 0;         // ships could not be placed, or nobody won
+    int crashed = 0;            // games that killed their process (also unfinished)
+    long long shots[2] = { 0, 0 };
+    double milliseconds = 0;
+    PerfReport perf;            // filled in while perfMode() is not PERF_OFF
+};
+
+// Games in a match.  The games of a tournament are played in matches of
+// MATCH_GAMES consecutive games, each match in order on one thread, and
+// adaptive players learn from game to game within a match (MatchModels in
+// OpponentModel.h), starting over with the next.
+const int MATCH_GAMES = 32;
+
+// Play nGames headless games between computer players of type1 and type2
+// (as for createPlayer) on boards set up like g, alternating who moves
+// first.  Game k is seeded from seed and k alone, and depends on nothing
+// but the games before it in its match, so the results are the same for
+// any number of threads and for either kind of dispatch.
+//
+// With staticDispatch the players' types are fixed at compile time (see
+// playHeadlessGame); otherwise they are made by createPlayer and every
+// strategy call goes through Player's virtual functions.  If archive is
+// not null every game is written to it, with the player who moved first
+// as player 0.  If spectator is not null, it is shown the games played on
+// the calling thread (one thread, so a SpectatorChannel can be used), and
+// it must return quickly, or it will slow the whole tournament down.
+TournamentResult runTournament(const Game& g, std::string type1, std::string type2,
+                               int nGames, bool staticDispatch = true,
+                               int nThreads = 1, unsigned seed = 1,
+                               ReplayWriter* archive = nullptr,
+                               GameObserver* spectator = nullptr);
+
+// Play a tournament as runTournament does (without archive or spectator),
+// but in nWorkers forked worker processes rather than threads, so that a
+// player that crashes only takes down its own process.  The parent hands
+// each worker ranges of games, and the workers send back each range's
+// totals, through lock-free rings in memory shared with the parent.  When
+// a worker dies, the ranges it had not finished are handed out again,
+// except for the game it died playing, which is counted as crashed and
+// unfinished, and a new worker takes its place.  A worker that cannot be
+// started (fork keeps failing) is done without; if no worker is left, the
+// games not yet played are counted as unfinished.  Workers are killed if
+// the parent dies, and start their own external bots rather than sharing
+// the parent's idle ones.  The totals of a run without crashes are the
+// same as runTournament's.  (After a crash, the rest of that match starts
+// a new one, so adaptive players in it forget what they had learned.)
+TournamentResult runForkedTournament(const Game& g, std::string type1, std::string type2,
+                                     int nGames, bool staticDispatch = true,
+                                     int nWorkers = 1, unsigned seed = 1);
+
+// How a checkpointed tournament run ended
+enum CheckpointStatus {
+    TOURNAMENT_FINISHED,        // every game has been played
+    TOURNAMENT_INTERRUPTED,     // stopped by SIGINT; run it again to go on
+    CHECKPOINT_MISMATCH,        // the file holds a different tournament
+    CHECKPOINT_UNWRITABLE       // the checkpoint could not be saved
+};
+
+// Play a tournament as runTournament does, saving its progress to the file
+// at checkpointPath at least every saveSeconds seconds, so a run that is
+// killed loses only the games since the last save.  If the file holds an
+// unfinished run of the same tournament (the same players, board, fleet,
+// number of games, seed and dispatch), the run picks up where that one
+// left off; since every game is seeded from the tournament's seed and its
+// number alone, and the players carry nothing from one match to the next,
+// the totals come out the same as those of a run that was never stopped.
+// (An adaptive player given a model file, "adaptive:path", is the
+// exception: its play depends on the games the file has seen.)  SIGINT
+// (Ctrl-C) stops the run after the games being played, saves it and
+// returns TOURNAMENT_INTERRUPTED.
+//
+// Games are handed out, and saved, in chunks of CHECKPOINT_CHUNK games,
+// whole matches; the games of an unfinished chunk are played again on
+// resuming.  The result's milliseconds only count this run.
+const int CHECKPOINT_CHUNK = 64;
+
+TournamentResult runCheckpointedTournament(const Game& g, std::string type1, std::string type2,
+                                           int nGames, bool staticDispatch, int nThreads,
+                                           unsigned seed, std::string checkpointPath,
+                                           CheckpointStatus& status, double saveSeconds = 10);
+
+#endif // TOURNAMENT_INCLUDED
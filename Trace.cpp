@@ -0,0 +1,150 @@
+#include "Trace.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+// a buffer stops recording after this many spans (about 24MB), rather than
+// letting a long tournament run the machine out of memory
+const size_t MAX_SPANS_PER_THREAD = 1 << 20;
+
+struct TracedSpan
+{
+    const char* name;
+    int64_t start;      // nanoseconds since the trace's epoch
+    int64_t duration;
+};
+
+// One thread's spans.  Buffers belong to the registry so that they outlive
+// the threads that filled them; when a thread exits, its buffer is handed
+// to the next new thread, so starting a thread per game or per turn doesn't
+// grow the registry without end.
+struct ThreadTrace
+{
+    int tid;
+    vector<TracedSpan> spans;
+    size_t dropped = 0;
+    bool inUse = true;
+};
+
+static mutex s_registryMutex;
+static vector<unique_ptr<ThreadTrace>> s_buffers;
+static const chrono::steady_clock::time_point s_epoch = chrono::steady_clock::now();
+
+static thread_local ThreadTrace* t_trace = nullptr;
+
+// gives the thread's buffer back to the registry when the thread exits
+struct TraceRelease
+{
+    ~TraceRelease()
+    {
+        lock_guard<mutex> lock(s_registryMutex);
+        t_trace->inUse = false;
+        t_trace = nullptr;
+    }
+};
+
+static int64_t now()
+{
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - s_epoch).count();
+}
+
+static ThreadTrace& threadTrace()
+{
+    if (t_trace == nullptr)
+    {
+        lock_guard<mutex> lock(s_registryMutex);
+        for (size_t b = 0; b < s_buffers.size()  &&  t_trace == nullptr; b++)
+            if (!s_buffers[b]->inUse)
+            {
+                t_trace = s_buffers[b].get();
+                t_trace->inUse = true;
+            }
+        if (t_trace == nullptr)
+        {
+            s_buffers.push_back(unique_ptr<ThreadTrace>(new ThreadTrace));
+            t_trace = s_buffers.back().get();
+            t_trace->tid = (int)s_buffers.size();
+            t_trace->spans.reserve(4096);
+        }
+        static thread_local TraceRelease release;
+        (void)release;
+    }
+    return *t_trace;
+}
+
+TraceSpan::TraceSpan(const char* name)
+: m_name(name), m_start(now())
+{}
+
+TraceSpan::~TraceSpan()
+{
+    int64_t end = now();
+    ThreadTrace& trace = threadTrace();
+    if (trace.spans.size() < MAX_SPANS_PER_THREAD)
+        trace.spans.push_back(TracedSpan{ m_name, m_start, end - m_start });
+    else
+        trace.dropped++;
+}
+
+// Microseconds, which is what the trace format counts in, with the
+// nanoseconds kept as a fraction
+static void writeMicros(ofstream& out, int64_t ns)
+{
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%lld.%03d", (long long)(ns / 1000), (int)(ns % 1000));
+    out << buf;
+}
+
+bool writeTrace(string path)
+{
+    ofstream out(path);
+    if (!out)
+        return false;
+
+    lock_guard<mutex> lock(s_registryMutex);
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    bool first = true;
+    for (size_t b = 0; b < s_buffers.size(); b++)
+    {
+        const ThreadTrace& trace = *s_buffers[b];
+        if (!first)
+            out << ",\n";
+        first = false;
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << trace.tid
+            << ",\"args\":{\"name\":\"thread " << trace.tid;
+        if (trace.dropped > 0)
+            out << " (" << trace.dropped << " spans dropped)";
+        out << "\"}}";
+
+        // spans end in the order their destructors ran, i.e., inner spans
+        // first, which the trace viewers sort out for themselves
+        for (size_t i = 0; i < trace.spans.size(); i++)
+        {
+            const TracedSpan& s = trace.spans[i];
+            out << ",\n{\"name\":\"" << s.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+                << trace.tid << ",\"ts\":";
+            writeMicros(out, s.start);
+            out << ",\"dur\":";
+            writeMicros(out, s.duration);
+            out << "}";
+        }
+    }
+    out << "\n]}\n";
+    return bool(out);
+}
+
+void resetTrace()
+{
+    lock_guard<mutex> lock(s_registryMutex);
+    for (size_t b = 0; b < s_buffers.size(); b++)
+    {
+        s_buffers[b]->spans.clear();
+        s_buffers[b]->dropped = 0;
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef TRACE_INCLUDED
+#define TRACE_INCLUDED
+
+#include <cstdint>
+#include <string>
+
+// Timed spans of what a game spends its time on, written out as Chrome
+// trace-event JSON (load it in chrome://tracing or ui.perfetto.dev).
+//
+// Tracing is compiled in only when BATTLESHIP_TRACE is defined (for
+// example with -DBATTLESHIP_TRACE); otherwise TRACE_SPAN is nothing and
+// TRACE_CALL(name, call) is just call, so the hooks cost nothing at all.
+// Each thread records its spans into a buffer of its own without taking
+// any locks, and writeTrace puts the threads side by side, so a parallel
+// tournament shows up as one track per thread.  A thread's buffer passes
+// to the next thread started after it exits, so threads that come and go
+// share tracks rather than adding one each.
+//
+//     TRACE_SPAN("game");                              // until the end of the block
+//     if (TRACE_CALL("attack", b.attack(p, h, d, id))) // just this call
+//
+// Span names must be string literals, or live as long as the trace.
+
+#ifdef BATTLESHIP_TRACE
+const bool TRACE_ENABLED = true;
+#else
+const bool TRACE_ENABLED = false;
+#endif
+
+// Records the time from its construction to its destruction
+class TraceSpan
+{
+public:
+    TraceSpan(const char* name);
+    ~TraceSpan();
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char* m_name;
+    int64_t m_start;
+};
+
+// Write every span recorded so far to path as Chrome trace-event JSON.
+// Call this when no thread is still recording.
+bool writeTrace(std::string path);
+
+// Discard every span recorded so far
+void resetTrace();
+
+#define TRACE_CONCAT2(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT2(a, b)
+
+// decltype(auto) rather than decltype(call), which C++17 rejects when call
+// has a lambda of its own, as PERF_CALL does
+#ifdef BATTLESHIP_TRACE
+#define TRACE_SPAN(name) TraceSpan TRACE_CONCAT(traceSpan_, __LINE__)(name)
+#define TRACE_CALL(name, call) ([&]() -> decltype(auto) { TraceSpan span_(name); return call; }())
+#else
+#define TRACE_SPAN(name) ((void)0)
+#define TRACE_CALL(name, call) (call)
+#endif
+
+#endif // TRACE_INCLUDED
@@ -0,0 +1,79 @@
+#include "Tuning.h"
+#include "globals.h"
+
+#include <sstream>
+
+using namespace std;
+
+static const TuningInfo PARAMS[NTUNINGPARAMS] = {
+    { "mediocre.placeRetries",  "mediocre", 50, 1, 200 },
+    { "mediocre.crossRadius",   "mediocre",  4, 1, MAXROWS - 1 },
+    { "good.quadrantStep",      "good",      1, 0, 3 },
+    { "mediocre.blockPercent",  "mediocre", 50, 0, 75 },
+};
+
+// the types that play by another type's strategy, and that type
+static const char* const BUILT_ON[][2] = {
+    { "adaptive", "mediocre" },
+};
+
+static thread_local TuningConfig t_config;
+
+const TuningInfo& tuningInfo(int param)
+{
+    return PARAMS[param];
+}
+
+int findTuningParam(const string& name)
+{
+    for (int p = 0; p < NTUNINGPARAMS; p++)
+        if (name == PARAMS[p].name)
+            return p;
+    return -1;
+}
+
+bool readsTuning(const string& type, const string& player)
+{
+    // "adaptive:path" is still an adaptive player
+    string base = type.substr(0, type.find(':'));
+    if (base == player)
+        return true;
+    for (const auto& b : BUILT_ON)
+        if (base == b[0]  &&  player == b[1])
+            return true;
+    return false;
+}
+
+TuningConfig::TuningConfig()
+{
+    for (int p = 0; p < NTUNINGPARAMS; p++)
+        value[p] = PARAMS[p].defaultValue;
+}
+
+string TuningConfig::describe() const
+{
+    ostringstream out;
+    for (int p = 0; p < NTUNINGPARAMS; p++)
+        out << (p == 0 ? "" : " ") << PARAMS[p].name << "=" << value[p];
+    return out.str();
+}
+
+int tuned(TuningParam p)
+{
+    return t_config.value[p];
+}
+
+void setTuning(const TuningConfig& config)
+{
+    t_config = config;
+}
+
+void resetTuning()
+{
+    t_config = TuningConfig();
+}
+
+const TuningConfig& currentTuning()
+{
+    return t_config;
+}
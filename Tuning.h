@@ -0,0 +1,67 @@
+#ifndef TUNING_INCLUDED
+#define TUNING_INCLUDED
+
+#include <string>
+
+// Strategy parameters that used to be constants in the players, gathered
+// in one registry so that they can be searched for better values (see
+// tools/tune.cpp).  Every parameter has a name, the player type whose play
+// it changes, a default (the value it had as a constant) and a range.
+//
+// The values are per thread, like the random number generator: a thread
+// plays with the defaults until setTuning gives it a configuration of its
+// own, so several configurations can be tried at once on different
+// threads.  A runTournament with more than one thread plays some of its
+// games on threads of its own, with the defaults, so tune with one thread
+// per tournament.
+
+enum TuningParam {
+    TUNE_PLACE_RETRIES,     // blocked boards MediocrePlayer tries before giving up
+    TUNE_CROSS_RADIUS,      // how far MediocrePlayer's cross reaches from a first hit
+    TUNE_QUADRANT_STEP,     // quadrants GoodPlayer moves on by after a checkerboard shot
+    TUNE_BLOCK_PERCENT,     // chance in percent that Board::block blocks a cell
+    NTUNINGPARAMS
+};
+
+struct TuningInfo
+{
+    const char* name;
+    const char* player;     // the player type it tunes
+    int defaultValue;
+    int minValue;
+    int maxValue;
+};
+
+const TuningInfo& tuningInfo(int param);
+
+// The parameter with this name, or -1 if there is none
+int findTuningParam(const std::string& name);
+
+// Does a player of this type (as for createPlayer) play by the parameters
+// that tune player?  It does if it is that type, or is built on it, as the
+// adaptive player attacks like a mediocre one.
+bool readsTuning(const std::string& type, const std::string& player);
+
+// A value for every parameter
+struct TuningConfig
+{
+    TuningConfig();         // the defaults
+
+    int value[NTUNINGPARAMS];
+
+    // name=value for each parameter, separated by spaces
+    std::string describe() const;
+};
+
+// The value of p on the calling thread
+int tuned(TuningParam p);
+
+// Play with config on the calling thread, or with the defaults again
+void setTuning(const TuningConfig& config);
+void resetTuning();
+
+// The configuration the calling thread plays with, for a thread that
+// plays on its behalf to take up
+const TuningConfig& currentTuning();
+
+#endif // TUNING_INCLUDED
@@ -1,6 +1,7 @@
 #ifndef GLOBALS_INCLUDED
 #define GLOBALS_INCLUDED
 
+#include <cstdint>
 #include <random>
 
 const int MAXROWS = 10;
@@ -13,19 +14,83 @@ enum Direction {
 class Point
 {
 public:
-    Point() : r(0), c(0) {}
-    Point(int rr, int cc) : r(rr), c(cc) {}
+    constexpr Point() : r(0), c(0) {}
+    constexpr Point(int rr, int cc) : r(rr), c(cc) {}
     int r;
     int c;
 };
 
+// The random number generator behind randInt.  Each thread has its own, so
+// games can be played on several threads at once.
+inline std::mt19937& randomGenerator()
+{
+    static thread_local std::random_device rd;
+    static thread_local std::mt19937 generator(rd());
+    return generator;
+}
+
+// Reseed this thread's generator, making the following games reproducible
+inline void seedRandom(unsigned seed)
+{
+    randomGenerator().seed(seed);
+}
+
 // Return a uniformly distributed random int from 0 to limit-1
 inline int randInt(int limit)
 {
-    static std::random_device rd;
-    static std::mt19937 generator(rd());
     std::uniform_int_distribution<> distro(0, limit-1);
-    return distro(generator);
+    return distro(randomGenerator());
 }
 
+// A small, fast generator (xoshiro256**) for code that draws a great many
+// numbers, such as layout sampling.  It is seeded from randomGenerator, so
+// seedRandom makes what it draws reproducible too.
+class FastRandom
+{
+public:
+    FastRandom() { reseed(); }
+
+    void reseed()
+    {
+        for (int k = 0; k < 4; k++)
+        {
+            uint64_t hi = randomGenerator()();
+            m_s[k] = (hi << 32) | randomGenerator()();
+        }
+        if ((m_s[0] | m_s[1] | m_s[2] | m_s[3]) == 0)
+            m_s[0] = 1;
+    }
+
+    uint64_t next()
+    {
+        uint64_t result = rotl(m_s[1] * 5, 7) * 9;
+        uint64_t t = m_s[1] << 17;
+        m_s[2] ^= m_s[0];
+        m_s[3] ^= m_s[1];
+        m_s[1] ^= m_s[2];
+        m_s[0] ^= m_s[3];
+        m_s[2] ^= t;
+        m_s[3] = rotl(m_s[3], 45);
+        return result;
+    }
+
+    // A uniformly distributed int from 0 to limit-1, by multiplying rather
+    // than dividing, and redrawing the rare values that would bias it
+    uint32_t below(uint32_t limit)
+    {
+        uint64_t m = (next() >> 32) * limit;
+        if ((uint32_t)m < limit)
+        {
+            uint32_t threshold = (0u - limit) % limit;
+            while ((uint32_t)m < threshold)
+                m = (next() >> 32) * limit;
+        }
+        return (uint32_t)(m >> 32);
+    }
+
+private:
+    static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+    uint64_t m_s[4];
+};
+
 #endif // GLOBALS_INCLUDED
@@ -1,7 +1,19 @@
 #include "Game.h"
 #include "Player.h"
+#include "StaticGame.h"
+#include "Tournament.h"
+#include "Replay.h"
+#include "Analytics.h"
+#include "Heatmap.h"
+#include "HeadlessPlay.h"
+#include "Renderer.h"
+#include "Spectator.h"
+#include "Trace.h"
+#include "PerfCounters.h"
+#include <chrono>
 #include <iostream>
 #include <string>
+#include <vector>
 #include <cassert>
 
 
@@ -9,16 +21,43 @@ using namespace std;
 
 bool addStandardShips(Game& g)
 {
-    return g.addShip(5, 'A', "aircraft carrier")  &&
-    g.addShip(4, 'B', "battleship")  &&
-    g.addShip(3, 'D', "destroyer")  &&
-    g.addShip(3, 'S', "submarine")  &&
-    g.addShip(2, 'P', "patrol boat");
+    // the standard fleet is defined once, in StaticGame.h
+    return addFleet<StandardFleet>(g);
 }
 
+// Passes everything on to the player it wraps, counting the times it is
+// asked for its shots, so option 14 can time a round of them
+class RoundCounter : public Player
+{
+public:
+    RoundCounter(Player* p) : Player(p->name(), p->game()), m_player(p), m_rounds(0) {}
+    virtual ~RoundCounter() { delete m_player; }
+    int rounds() const { return m_rounds; }
+    
+    virtual bool placeShips(Board& b) { return m_player->placeShips(b); }
+    virtual Point recommendAttack() { m_rounds++; return m_player->recommendAttack(); }
+    virtual void recordAttackResult(Point p, bool validShot, bool shotHit,
+                                    bool shipDestroyed, int shipId)
+    { m_player->recordAttackResult(p, validShot, shotHit, shipDestroyed, shipId); }
+    virtual void recordAttackByOpponent(Point p) { m_player->recordAttackByOpponent(p); }
+    virtual vector<Point> recommendAttacks(int k) { m_rounds++; return m_player->recommendAttacks(k); }
+    virtual void recordAttackResults(const vector<ShotResult>& results)
+    { m_player->recordAttackResults(results); }
+    virtual void recordAttacksByOpponent(const vector<Point>& shots)
+    { m_player->recordAttacksByOpponent(shots); }
+    
+private:
+    Player* m_player;
+    int m_rounds;
+};
+
 int main()
 {
     const int NTRIALS = 10;
+    const int NBENCH = 5000;
+    const int NLONG = 1000000;
+    const int NSALVO = 5;
+    const int NTIMED = 3;
     
     cout << "Select one of these choices for an example of the game:" << endl;
     cout << "  1.  A mini-game between two mediocre players" << endl;
@@ -28,6 +67,31 @@ int main()
     << endl;
     cout << "  4.  A single game match between a good player and a mediocre player, with no pauses" << endl;
     cout << "  5.  My Own Game for Testing" << endl;
+    cout << "  6.  A " << NTRIALS
+    << "-game match between a mediocre and an awful player on the fixed 10x10 engine"
+    << endl;
+    cout << "  7.  A " << NBENCH
+    << "-game mediocre vs awful tournament, timing virtual against static dispatch"
+    << endl;
+    cout << "  8.  Archive a " << NBENCH
+    << "-game mediocre vs awful tournament to replays.bsr and analyze it" << endl;
+    cout << "  9.  Heatmaps of where the awful and mediocre players place ships and shoot"
+    << endl;
+    cout << "  10. Watch a good player against a mediocre player, redrawn in place"
+    << endl;
+    cout << "  11. A " << NBENCH
+    << "-game good vs mediocre tournament, watched live while it plays at full speed"
+    << endl;
+    cout << "  12. A " << NLONG
+    << "-game good vs mediocre tournament that saves its progress to tournament.ckpt;"
+    << endl << "      Ctrl-C stops it, and choosing 12 again resumes it" << endl;
+    cout << "  13. A salvo game between a good player and a mediocre player, "
+    << NSALVO << " shots a turn, with no pauses" << endl;
+    cout << "  14. " << NTIMED << " games between two density players with simultaneous turns,"
+    << endl << "      timed per round against the same games with alternating turns" << endl;
+    cout << "  15. A " << NBENCH
+    << "-game adaptive vs good tournament, beside the mediocre player it attacks like"
+    << endl;
     cout << "Enter your choice: ";
     string line;
     getline(cin,line);
@@ -37,6 +101,116 @@ int main()
         cout << "You did not enter a choice" << endl;
     }
     
+    else if (line == "10")
+    {
+        Game g(10, 10);
+        addStandardShips(g);
+        Player* p1 = createPlayer("good", "Good Gertrude", g);
+        Player* p2 = createPlayer("mediocre", "Mediocre Mimi", g);
+        TerminalSpectator spectator(g, 50);
+        GameRecord rec;
+        playHeadless(g, *p1, *p2, rec, nullptr, &spectator);
+        delete p1;
+        delete p2;
+    }
+    
+    else if (line == "11")
+    {
+        Game g(10, 10);
+        addStandardShips(g);
+        TournamentResult result;
+        int shown;
+        int skipped;
+        {
+            SpectatorChannel spectator(g);
+            result = runTournament(g, "good", "mediocre", NBENCH, true, 4, 1, nullptr, &spectator);
+            spectator.stop();
+            shown = spectator.games() - spectator.gamesSkipped();
+            skipped = spectator.gamesSkipped();
+        }
+        cout << "The good player won " << result.wins[0] << " and the mediocre player won "
+        << result.wins[1] << " in " << result.milliseconds << " ms" << endl;
+        cout << shown << " games were shown whole or in part and " << skipped
+        << " were skipped" << endl;
+    }
+    
+    else if (line == "12")
+    {
+        Game g(10, 10);
+        addStandardShips(g);
+        CheckpointStatus status;
+        TournamentResult result = runCheckpointedTournament(g, "good", "mediocre", NLONG, true,
+                                                            4, 1, "tournament.ckpt", status);
+        if (status == CHECKPOINT_MISMATCH)
+            cout << "tournament.ckpt holds a different tournament" << endl;
+        else
+        {
+            cout << "After " << result.games << " games the good player has won "
+            << result.wins[0] << " and the mediocre player " << result.wins[1] << endl;
+            if (status == TOURNAMENT_INTERRUPTED)
+                cout << "Stopped; choose 12 again to go on" << endl;
+            else if (status == CHECKPOINT_UNWRITABLE)
+                cout << "WARNING: the progress could not be saved to tournament.ckpt" << endl;
+        }
+    }
+    
+    else if (line == "13")
+    {
+        Game g(10, 10);
+        addStandardShips(g);
+        Player* p1 = createPlayer("good", "Good G", g);
+        Player* p2 = createPlayer("mediocre", "Mediocre M", g);
+        g.play(p1, p2, false, NSALVO);
+        delete p1;
+        delete p2;
+    }
+    
+    else if (line == "14")
+    {
+        // both modes play games seeded alike, with nothing printed, and are
+        // compared per round (each player choosing a shot once), since the
+        // two modes play their games differently and to different lengths
+        Game g(10, 10);
+        addStandardShips(g);
+        double msPerRound[2];
+        streambuf* screen = cout.rdbuf();
+        for (int k = 0; k < 2; k++)
+        {
+            double ms = 0;
+            int rounds = 0;
+            for (int game = 0; game < NTIMED; game++)
+            {
+                seedRandom(game + 1);
+                RoundCounter p1(createPlayer("density", "Density D", g));
+                RoundCounter p2(createPlayer("density", "Density E", g));
+                cout.rdbuf(nullptr);
+                auto start = chrono::steady_clock::now();
+                g.play(&p1, &p2, false, 1, k == 1);
+                ms += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+                cout.rdbuf(screen);
+                cout.clear();
+                rounds += p1.rounds();
+            }
+            msPerRound[k] = ms / rounds;
+        }
+        cout << "Alternating turns took " << msPerRound[0] << " ms a round, simultaneous turns "
+        << msPerRound[1] << " ms a round" << endl;
+    }
+    
+    else if (line == "15")
+    {
+        // the adaptive player learns where the good player shoots over each
+        // match of the tournament; the mediocre player places the same way
+        // every game
+        Game g(10, 10);
+        addStandardShips(g);
+        TournamentResult adaptive = runTournament(g, "adaptive", "good", NBENCH, true, 4);
+        TournamentResult mediocre = runTournament(g, "mediocre", "good", NBENCH, true, 4);
+        cout << "Against the good player, the adaptive player won " << adaptive.wins[0]
+        << " and the mediocre player won " << mediocre.wins[0] << " of " << NBENCH
+        << " games (matches of " << MATCH_GAMES << " games)" << endl;
+    }
+    
     else if (line[0] == '1')
     {
         Game g(2, 3);
@@ -185,8 +359,111 @@ int main()
          */
     }
     
+    else if (line[0] == '6')
+    {
+        StaticGame<10, 10, StandardFleet> g;
+        int nMediocreWins = 0;
+        
+        for (int k = 1; k <= NTRIALS; k++)
+        {
+            Player* p1 = createPlayer("awful", "Awful Audrey", g.game());
+            Player* p2 = createPlayer("mediocre", "Mediocre Mimi", g.game());
+            Player* winner = (k % 2 == 1 ?
+                              g.play(p1, p2) : g.play(p2, p1));
+            if (winner == p2)
+                nMediocreWins++;
+            delete p1;
+            delete p2;
+        }
+        cout << "The mediocre player won " << nMediocreWins << " out of "
+        << NTRIALS << " games." << endl;
+    }
+    
+    else if (line[0] == '7')
+    {
+        Game g(10, 10);
+        addStandardShips(g);
+        
+        // both runs use the same seed, so they play exactly the same games
+        TournamentResult virt = runTournament(g, "mediocre", "awful", NBENCH, false);
+        TournamentResult stat = runTournament(g, "mediocre", "awful", NBENCH, true);
+        
+        cout << "Virtual dispatch: mediocre won " << virt.wins[0] << ", awful won "
+        << virt.wins[1] << ", " << virt.unfinished << " unfinished, in "
+        << virt.milliseconds << " ms" << endl;
+        cout << "Static dispatch:  mediocre won " << stat.wins[0] << ", awful won "
+        << stat.wins[1] << ", " << stat.unfinished << " unfinished, in "
+        << stat.milliseconds << " ms" << endl;
+        if (virt.wins[0] != stat.wins[0]  ||  virt.shots[0] != stat.shots[0])
+            cout << "WARNING: the two runs did not play the same games" << endl;
+        
+        // counting regions slows the games down, so it gets a run of its own
+        setPerfMode(PERF_REGIONS);
+        TournamentResult counted = runTournament(g, "mediocre", "awful", NBENCH, true);
+        setPerfMode(PERF_OFF);
+        printPerfReport(cout, counted.perf);
+    }
+    
+    else if (line[0] == '8')
+    {
+        Game g(10, 10);
+        addStandardShips(g);
+        
+        ReplayWriter archive("replays.bsr", g);
+        if (!archive.ok())
+        {
+            cout << "Cannot create replays.bsr" << endl;
+            return 1;
+        }
+        runTournament(g, "mediocre", "awful", NBENCH, true, 4, 1, &archive);
+        if (!archive.close())
+            cout << "WARNING: not every game could be written to replays.bsr" << endl;
+        
+        ReplayFile replays("replays.bsr");
+        size_t rejected = 0;
+        ShotHeatmapReducer heatmap = reduceReplays(replays, ShotHeatmapReducer(), 0, &rejected);
+        FirstHitLatencyReducer latency = reduceReplays(replays, FirstHitLatencyReducer());
+        SinkOrderReducer sinkOrder = reduceReplays(replays, SinkOrderReducer(replays.nShips()));
+        OpeningReducer openings = reduceReplays(replays, OpeningReducer());
+        
+        heatmap.print(replays.rows(), replays.cols());
+        latency.print();
+        sinkOrder.print();
+        openings.print(replays.rows(), replays.cols());
+        if (rejected > 0)
+            cout << "WARNING: " << rejected << " corrupt blocks of replays.bsr were skipped,"
+            << " so these counts leave some games out" << endl;
+        else
+            cout << "All " << replays.nBlocks() << " blocks of replays.bsr were read" << endl;
+    }
+    
+    else if (line[0] == '9')
+    {
+        Game g(10, 10);
+        addStandardShips(g);
+        
+        enableHeatmaps(true);
+        runTournament(g, "mediocre", "awful", NBENCH, true, 4);
+        enableHeatmaps(false);
+        
+        vector<Heatmap> maps = collectHeatmaps();
+        writeHeatmaps("heatmaps.txt", maps, g.rows(), g.cols());
+        for (size_t m = 0; m < maps.size(); m++)
+        {
+            cout << "Where " << maps[m].name << " places its ships:" << endl;
+            printHeatmap(maps[m].placements, g.rows(), g.cols());
+            cout << "Where " << maps[m].name << " shoots:" << endl;
+            printHeatmap(maps[m].shots, g.rows(), g.cols());
+        }
+        cout << "The counts are in heatmaps.txt" << endl;
+    }
+    
     else
     {
         cout << "That's not one of the choices." << endl;
     }
+    
+    // built with -DBATTLESHIP_TRACE, every choice leaves a timeline behind
+    if (TRACE_ENABLED  &&  writeTrace("trace.json"))
+        cout << "The trace is in trace.json" << endl;
 }
@@ -0,0 +1,89 @@
+// Count the legal layouts of a fleet exactly (see Counting.h).
+//
+// The default is the standard game of main.cpp: a 10x10 board with ships
+// of length 5, 4, 3, 3 and 2.  Misses and hits already seen can be given as
+// strings of row,column pairs such as "0,0 4,7".
+//
+// usage: count_layouts [threads [rows cols length...]]
+//        count_layouts -m "misses" -h "hits" [threads [rows cols length...]]
+
+#include "../Game.h"
+#include "../Counting.h"
+#include "../globals.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+// Read "r,c r,c ..." into cells; false if a cell is off the board
+bool readCells(const char* text, int rows, int cols, Bitboard& cells)
+{
+    istringstream in(text);
+    int r;
+    int c;
+    char comma;
+    while (in >> r >> comma >> c)
+    {
+        if (comma != ','  ||  r < 0  ||  r >= rows  ||  c < 0  ||  c >= cols)
+            return false;
+        cells |= Bitboard::cell(Point(r, c));
+    }
+    return in.eof();
+}
+
+int main(int argc, char* argv[])
+{
+    const char* missText = "";
+    const char* hitText = "";
+    int a = 1;
+    while (a + 1 < argc  &&  (strcmp(argv[a], "-m") == 0  ||  strcmp(argv[a], "-h") == 0))
+    {
+        (argv[a][1] == 'm' ? missText : hitText) = argv[a + 1];
+        a += 2;
+    }
+
+    int nThreads = (argc > a ? atoi(argv[a]) : 0);     // 0 means one per core
+    int rows = (argc > a + 2 ? atoi(argv[a + 1]) : 10);
+    int cols = (argc > a + 2 ? atoi(argv[a + 2]) : 10);
+    if (rows < 1  ||  rows > MAXROWS  ||  cols < 1  ||  cols > MAXCOLS)
+    {
+        cout << "The board must be between 1x1 and " << MAXROWS << "x" << MAXCOLS << endl;
+        return 1;
+    }
+
+    Game g(rows, cols);
+    if (argc > a + 3)
+    {
+        for (int i = a + 3; i < argc; i++)
+            if (!g.addShip(atoi(argv[i]), 'A' + (i - a - 3), string("ship ") + to_string(i - a - 3)))
+                return 1;
+    }
+    else
+    {
+        g.addShip(5, 'A', "aircraft carrier");
+        g.addShip(4, 'B', "battleship");
+        g.addShip(3, 'D', "destroyer");
+        g.addShip(3, 'S', "submarine");
+        g.addShip(2, 'P', "patrol boat");
+    }
+
+    Bitboard misses;
+    Bitboard hits;
+    if (!readCells(missText, rows, cols, misses)  ||  !readCells(hitText, rows, cols, hits))
+    {
+        cout << "Cells are given as row,column pairs on the board" << endl;
+        return 1;
+    }
+
+    auto start = chrono::steady_clock::now();
+    BigCount n = countLayouts(g, misses, hits, nThreads);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << n.toString() << " layouts (" << n.toDouble() << ") counted in "
+    << seconds << "s" << endl;
+    return 0;
+}
@@ -0,0 +1,187 @@
+// Search for fleet layouts that a DensityHunter takes a long time to find,
+// and save the best of them as a layout library for DensityPlayer.
+//
+// Each of several simulated annealing chains starts from a random layout
+// and repeatedly moves one ship to a random free position, scoring a layout
+// by the average number of shots a DensityHunter needs to sink it.  All
+// layouts are scored against the same hunter seeds, so two layouts are
+// compared on equal terms.  The chains run in parallel and the best layout
+// each one finds goes into the library.  The layouts found, and random ones
+// for comparison, are then scored on other seeds than the search used,
+// since the search picked its layouts for how they did on its own.
+//
+// usage: optimize_layouts [library [layouts [steps [threads]]]]
+//        (defaults: layouts.bsl 32 2000 one per core)
+
+#include "../Game.h"
+#include "../StaticGame.h"
+#include "../Placement.h"
+#include "../Hunter.h"
+#include "../LayoutLibrary.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <climits>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+const int SEARCH_GAMES = 12;    // hunter games per score during the search
+const int FINAL_GAMES = 200;    // hunter games per score for the results
+
+// the first hunter seed of each
+const unsigned SEARCH_SEED = 1000;
+const unsigned FINAL_SEED = 2000;
+static_assert(SEARCH_SEED + SEARCH_GAMES <= FINAL_SEED, "the final games must not reuse search seeds");
+
+// Average shots a DensityHunter needs to sink layout, over nGames games
+// seeded firstSeed, firstSeed+1, ...
+double scoreLayout(const PlacementTable& t, const vector<int>& layout, unsigned firstSeed,
+                   int nGames)
+{
+    DensityHunter hunter(t);
+    vector<Bitboard> ships = layoutShips(t, layout);
+    long long total = 0;
+    for (int k = 0; k < nGames; k++)
+    {
+        seedRandom(firstSeed + k);
+        total += huntFleet(hunter, t, ships);
+    }
+    return double(total) / nGames;
+}
+
+// One annealing chain; returns the best layout it saw
+vector<int> anneal(const PlacementTable& t, int steps, unsigned seed)
+{
+    mt19937 rng(seed);
+    seedRandom(rng());
+    
+    vector<int> current;
+    randomLayout(t, current);
+    double currentScore = scoreLayout(t, current, SEARCH_SEED, SEARCH_GAMES);
+    vector<int> best = current;
+    double bestScore = currentScore;
+    
+    const double startTemp = 4;
+    const double endTemp = 0.05;
+    for (int step = 0; step < steps; step++)
+    {
+        double temp = startTemp * pow(endTemp / startTemp, double(step) / steps);
+        
+        // move one ship to a random position clear of the others
+        vector<int> next = current;
+        int s = uniform_int_distribution<>(0, t.nShips() - 1)(rng);
+        Bitboard others;
+        for (int k = 0; k < t.nShips(); k++)
+            if (k != s)
+                others |= t.placements(k)[next[k]].mask;
+        const vector<ShipPlacement>& list = t.placements(s);
+        int tries;
+        for (tries = 0; tries < 100; tries++)
+        {
+            next[s] = uniform_int_distribution<>(0, (int)list.size() - 1)(rng);
+            if (!list[next[s]].mask.intersects(others))
+                break;
+        }
+        if (tries == 100)
+            continue;
+        
+        // higher is better: accept improvements, and worse layouts sometimes
+        double nextScore = scoreLayout(t, next, SEARCH_SEED, SEARCH_GAMES);
+        if (nextScore >= currentScore  ||
+            uniform_real_distribution<>(0, 1)(rng) < exp((nextScore - currentScore) / temp))
+        {
+            current = next;
+            currentScore = nextScore;
+            if (currentScore > bestScore)
+            {
+                best = current;
+                bestScore = currentScore;
+            }
+        }
+    }
+    return best;
+}
+
+// Read a whole number of at least min from arg into value
+bool parseCount(const char* arg, int min, int& value)
+{
+    char* end;
+    long n = strtol(arg, &end, 10);
+    if (end == arg  ||  *end != '\0'  ||  n < min  ||  n > INT_MAX)
+        return false;
+    value = (int)n;
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    string path = (argc > 1 ? argv[1] : "layouts.bsl");
+    int nLayouts = 32;
+    int steps = 2000;
+    int nThreads = max(1, (int)thread::hardware_concurrency());
+    if ((argc > 2  &&  !parseCount(argv[2], 1, nLayouts))  ||
+        (argc > 3  &&  !parseCount(argv[3], 0, steps))  ||
+        (argc > 4  &&  !parseCount(argv[4], 1, nThreads))  ||  argc > 5)
+    {
+        cout << "usage: optimize_layouts [library [layouts [steps [threads]]]]" << endl
+             << "       layouts and threads at least 1, steps at least 0" << endl;
+        return 1;
+    }
+    
+    Game g(10, 10);
+    addFleet<StandardFleet>(g);
+    PlacementTable t(g);
+    
+    vector<vector<int>> found(nLayouts);
+    vector<double> scores(nLayouts);
+    atomic<int> next(0);
+    mutex printMutex;
+    auto worker = [&]() {
+        for (int k = next++; k < nLayouts; k = next++)
+        {
+            found[k] = anneal(t, steps, 7919 * (k + 1));
+            scores[k] = scoreLayout(t, found[k], FINAL_SEED, FINAL_GAMES);
+            lock_guard<mutex> lock(printMutex);
+            cout << "layout " << k << ": " << scores[k] << " shots" << endl;
+        }
+    };
+    vector<thread> threads;
+    for (int i = 1; i < nThreads; i++)
+        threads.push_back(thread(worker));
+    worker();
+    for (size_t i = 0; i < threads.size(); i++)
+        threads[i].join();
+    
+    // for comparison, how long the hunter takes against random layouts
+    double randomTotal = 0;
+    for (int k = 0; k < nLayouts; k++)
+    {
+        vector<int> layout;
+        randomLayout(t, layout);
+        randomTotal += scoreLayout(t, layout, FINAL_SEED, FINAL_GAMES);
+    }
+    
+    LayoutLibrary library(g);
+    double total = 0;
+    for (int k = 0; k < nLayouts; k++)
+    {
+        library.add(found[k]);
+        total += scores[k];
+    }
+    if (!library.save(path))
+    {
+        cout << "Cannot write " << path << endl;
+        return 1;
+    }
+    cout << "Saved " << nLayouts << " layouts to " << path << "; the hunter needs "
+    << total / nLayouts << " shots on average, against " << randomTotal / nLayouts
+    << " for random layouts" << endl;
+    return 0;
+}
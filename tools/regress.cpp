@@ -0,0 +1,448 @@
+// Check that no change has made games slower or players weaker.
+//
+// Plays a fixed corpus of seeded games for every pairing of the computer
+// player types in createPlayer's list (computerPlayerTypes in Player.h),
+// alternating who moves first, and
+// measures for each pairing the time per game, the number of allocations
+// per game, each side's wins and the shots each side needed for the games
+// it won.  The games are played in matches of MATCH_GAMES, as tournaments
+// play them, so the adaptive player learns across each match.  They are
+// the same on every run, so the wins and shots only change when a player's
+// behavior does.  The results are compared with a
+// baseline (tools/regress_baseline.txt by default), and anything that got
+// worse by more than its threshold fails the run:
+//
+//   time per game          more than 50 percent slower (see -t below), by
+//                          the median of several runs of the corpus
+//   allocations per game   more than ALLOC_SLACK percent more
+//   wins                   a side winning WIN_SLACK percentage points fewer
+//   shots to win           a side needing SHOTS_SLACK percent more shots
+//
+// Improvements are listed but do not fail.  Once a change is known to be
+// good, rerun with -u to make its results the new baseline.
+//
+// Players read files from the current directory, so the games are played
+// in a temporary directory, which is removed at the end.  The optimal and
+// equilibrium players only play their own way on a board small enough to
+// solve (without policy.bsp or equilibrium.bse they play like density), so
+// they play on a 3x3 board, against each other and density, with the
+// policy and strategy for it solved into the directory first; the other
+// pairings are on the standard 10x10 board.  There is no layouts.bsl, so
+// density places its ships at random.  The whole run takes under a minute.
+//
+// Times only mean something on the machine that recorded the baseline, so
+// record one there (on a tree without the change) before comparing; on a
+// noisy machine, -t sets a larger slack for the time per game.
+//
+// usage: regress [-u] [-t percent] [baseline]
+
+#include "../Game.h"
+#include "../StaticGame.h"
+#include "../HeadlessPlay.h"
+#include "../OpponentModel.h"
+#include "../Player.h"
+#include "../Policy.h"
+#include "../Tournament.h"
+#include "../globals.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+using namespace std;
+
+const unsigned GOLDEN_SEED = 20170615;
+const int FAST_GAMES = 200;     // games per pairing of fast players
+const int SLOW_GAMES = 24;      // games per pairing with a player that searches
+const int TIME_REPEATS = 7;     // runs of a fast pairing's corpus to time
+const int SLOW_TIME_REPEATS = 3;    // and of a slow pairing's
+const int WARM_UP_MS = 1000;
+
+const double DEFAULT_TIME_SLACK = 50;
+const double ALLOC_SLACK = 10;
+const double WIN_SLACK = 5;
+const double SHOTS_SLACK = 3;
+
+const char* const SLOW_TYPES[] = { "density" };
+
+// the small board, and the types that only play their own way on it; they
+// play there against each other and SMALL_PARTNER, in pairings named with
+// its size, as in density@3x3, and every other type plays on 10x10
+const int SMALL_ROWS = 3;
+const int SMALL_COLS = 3;
+const char* const SMALL_ONLY_TYPES[] = { "optimal", "equilibrium" };
+const char* const SMALL_PARTNER = "density";
+const int EQUILIBRIUM_ITERATIONS = 200;
+
+//*********************************************************************
+//  Counting allocations
+//*********************************************************************
+
+// The games are played on this thread alone, but the counter is atomic in
+// case a player ever starts one of its own
+static atomic<long long> s_allocations(0);
+
+void* operator new(size_t size)
+{
+    s_allocations.fetch_add(1, memory_order_relaxed);
+    void* p = malloc(size == 0 ? 1 : size);
+    if (p == nullptr)
+        throw bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+//*********************************************************************
+//  Measuring
+//*********************************************************************
+
+struct PairingResult
+{
+    int games = 0;
+    int wins[2] = { 0, 0 };
+    double shotsToWin[2] = { 0, 0 };    // average over the games each side won
+    double nsPerGame = 0;
+    double allocsPerGame = 0;
+};
+
+bool isSmallOnly(const string& type)
+{
+    for (const char* small : SMALL_ONLY_TYPES)
+        if (type == small)
+            return true;
+    return false;
+}
+
+bool isSlow(const string& type)
+{
+    for (const char* slow : SLOW_TYPES)
+        if (type == slow)
+            return true;
+    return false;
+}
+
+// Play the pairing's corpus once, adding to result, and return the time
+// it took in nanoseconds
+double playCorpus(const Game& g, const string& type1, const string& type2,
+                  PairingResult& result, long long shots[2])
+{
+    auto start = chrono::steady_clock::now();
+    unique_ptr<MatchModels> match;
+    for (int k = 0; k < result.games; k++)
+    {
+        if (k % MATCH_GAMES == 0)
+        {
+            match.reset();
+            match.reset(new MatchModels);
+        }
+        bool swapped = (k % 2 == 1);
+        seedRandom(GOLDEN_SEED + k);
+        GameRecord rec;
+        if (!playHeadlessGame(swapped ? type2 : type1, swapped ? type1 : type2, g, rec)  ||
+            rec.winner == -1)
+            continue;
+        int side = rec.winner ^ swapped;
+        result.wins[side]++;
+        shots[side] += rec.shots[rec.winner];
+    }
+    chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+PairingResult measure(const Game& g, const string& type1, const string& type2, bool slow)
+{
+    PairingResult result;
+    result.games = slow ? SLOW_GAMES : FAST_GAMES;
+    long long shots[2] = { 0, 0 };
+
+    long long allocsBefore = s_allocations.load();
+    double ns = playCorpus(g, type1, type2, result, shots);
+    result.allocsPerGame = double(s_allocations.load() - allocsBefore) / result.games;
+    for (int s = 0; s < 2; s++)
+        result.shotsToWin[s] = result.wins[s] > 0 ? double(shots[s]) / result.wins[s] : 0;
+
+    // the time is the median of several runs, which a run slowed by
+    // something else on the machine does not move
+    vector<double> times(1, ns);
+    for (int rep = 1; rep < (slow ? SLOW_TIME_REPEATS : TIME_REPEATS); rep++)
+    {
+        PairingResult again;
+        again.games = result.games;
+        long long ignored[2] = { 0, 0 };
+        times.push_back(playCorpus(g, type1, type2, again, ignored));
+    }
+    nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+    result.nsPerGame = times[times.size() / 2] / result.games;
+    return result;
+}
+
+// Solve the small game into policy.bsp and equilibrium.bse in the current
+// directory, on one thread so that the results are the same every run
+bool solveSmallGame(const Game& g)
+{
+    PolicyTable policy(g);
+    if (!solveOptimalPolicy(policy, 1)  ||  !policy.save("policy.bsp"))
+        return false;
+
+    MixedStrategy strategy(g);
+    KnowledgeGraph graph(strategy.space(), 1);
+    if (!graph.ok())
+        return false;
+    EquilibriumSolver solver(graph, 1);
+    solver.run(EQUILIBRIUM_ITERATIONS);
+    solver.result(strategy);
+    return strategy.save("equilibrium.bse");
+}
+
+string smallName(const string& type)
+{
+    return type + "@" + to_string(SMALL_ROWS) + "x" + to_string(SMALL_COLS);
+}
+
+// The type a pairing's name stands for, and whether it plays on the small
+// board
+string typeOf(const string& name, bool& small)
+{
+    size_t at = name.find('@');
+    small = (at != string::npos);
+    return name.substr(0, at);
+}
+
+//*********************************************************************
+//  The baseline
+//*********************************************************************
+
+// One line per pairing:
+//   type1 type2 games wins1 wins2 shotsToWin1 shotsToWin2 nsPerGame allocsPerGame
+typedef map<pair<string, string>, PairingResult> Results;
+
+bool loadBaseline(string path, Results& baseline)
+{
+    ifstream in(path);
+    if (!in)
+        return false;
+    string line;
+    while (getline(in, line))
+    {
+        if (line.empty()  ||  line[0] == '#')
+            continue;
+        istringstream fields(line);
+        string t1;
+        string t2;
+        PairingResult r;
+        if (fields >> t1 >> t2 >> r.games >> r.wins[0] >> r.wins[1] >> r.shotsToWin[0]
+                   >> r.shotsToWin[1] >> r.nsPerGame >> r.allocsPerGame)
+            baseline[make_pair(t1, t2)] = r;
+    }
+    return true;
+}
+
+bool saveBaseline(string path, const vector<pair<string, string>>& order, Results& results)
+{
+    ofstream out(path);
+    if (!out)
+        return false;
+    out << "# type1 type2 games wins1 wins2 shotsToWin1 shotsToWin2 nsPerGame allocsPerGame" << endl;
+    out << fixed;
+    for (const pair<string, string>& p : order)
+    {
+        const PairingResult& r = results[p];
+        out << p.first << " " << p.second << " " << r.games << " " << r.wins[0] << " "
+            << r.wins[1] << " " << setprecision(3) << r.shotsToWin[0] << " "
+            << r.shotsToWin[1] << " " << setprecision(0) << r.nsPerGame << " "
+            << setprecision(1) << r.allocsPerGame << endl;
+    }
+    return bool(out);
+}
+
+// Compare one number and print it if it changed.  Returns true if it got
+// worse (bigger, or smaller if biggerIsBetter) by more than slack, which is
+// a percentage of old, or with absolute, in the number's own units.
+bool compare(const string& pairing, const string& metric, double old, double now,
+             double slack, bool absolute, bool biggerIsBetter = false)
+{
+    double change = absolute ? now - old : (old == 0 ? (now == 0 ? 0 : 100) : (now - old) / old * 100);
+    double worse = biggerIsBetter ? -change : change;
+    bool failed = worse > slack;
+    if (fabs(change) < 0.05)
+        return false;
+    if (!failed  &&  metric == "ns per game"  &&  fabs(change) < slack)
+        return false;   // timing noise is not worth a line
+
+    char buf[160];
+    snprintf(buf, sizeof(buf), "%-36s %-24s %14.1f %14.1f %+9.1f%s  %s",
+             pairing.c_str(), metric.c_str(), old, now, change, absolute ? "  " : "% ",
+             failed ? "FAIL" : (worse < 0 ? "better" : "ok"));
+    cout << buf << endl;
+    return failed;
+}
+
+int main(int argc, char* argv[])
+{
+    bool update = false;
+    double timeSlack = DEFAULT_TIME_SLACK;
+    int a = 1;
+    for (;;)
+    {
+        if (a < argc  &&  strcmp(argv[a], "-u") == 0)
+        {
+            update = true;
+            a++;
+        }
+        else if (a + 1 < argc  &&  strcmp(argv[a], "-t") == 0)
+        {
+            timeSlack = atof(argv[a + 1]);
+            a += 2;
+        }
+        else
+            break;
+    }
+    string path = (a < argc ? argv[a] : "tools/regress_baseline.txt");
+
+    // the baseline is found from here, the games are played elsewhere
+    path = filesystem::absolute(path).string();
+    char dir[] = "/tmp/regressXXXXXX";
+    if (mkdtemp(dir) == nullptr  ||  chdir(dir) != 0)
+    {
+        cout << "Cannot make a temporary directory to play in" << endl;
+        return 1;
+    }
+
+    Game g(10, 10);
+    addFleet<StandardFleet>(g);
+    Game small(SMALL_ROWS, SMALL_COLS);
+    small.addShip(2, 'D', "destroyer");
+    small.addShip(2, 'P', "patrol boat");
+    if (!solveSmallGame(small))
+    {
+        cout << "Cannot solve the " << SMALL_ROWS << "x" << SMALL_COLS << " game" << endl;
+        filesystem::remove_all(dir);
+        return 1;
+    }
+
+    vector<string> types;
+    vector<string> smallTypes(1, SMALL_PARTNER);
+    for (const string& type : computerPlayerTypes())
+        (isSmallOnly(type) ? smallTypes : types).push_back(type);
+
+    vector<pair<string, string>> order;
+    for (size_t i = 0; i < types.size(); i++)
+        for (size_t j = i; j < types.size(); j++)
+            order.push_back(make_pair(types[i], types[j]));
+    for (size_t i = 0; i < smallTypes.size(); i++)
+        for (size_t j = i; j < smallTypes.size(); j++)
+            order.push_back(make_pair(smallName(smallTypes[i]), smallName(smallTypes[j])));
+
+    // the first games of a run are slower (the heap is still growing, the
+    // processor may still be clocking up), so play some untimed ones first
+    auto warmUpEnd = chrono::steady_clock::now() + chrono::milliseconds(WARM_UP_MS);
+    while (chrono::steady_clock::now() < warmUpEnd)
+    {
+        PairingResult ignored;
+        ignored.games = FAST_GAMES;
+        long long shots[2] = { 0, 0 };
+        playCorpus(g, "mediocre", "good", ignored, shots);
+    }
+
+    Results results;
+    auto start = chrono::steady_clock::now();
+    for (const pair<string, string>& p : order)
+    {
+        bool onSmall;
+        string type1 = typeOf(p.first, onSmall);
+        string type2 = typeOf(p.second, onSmall);
+        results[p] = measure(onSmall ? small : g, type1, type2, isSlow(type1)  ||  isSlow(type2));
+    }
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    filesystem::remove_all(dir);
+    cout << "Played " << order.size() << " pairings in " << fixed << setprecision(1)
+         << elapsed.count() << " s" << endl;
+
+    if (update)
+    {
+        if (!saveBaseline(path, order, results))
+        {
+            cout << "Cannot write " << path << endl;
+            return 1;
+        }
+        cout << "Saved the results to " << path << endl;
+        return 0;
+    }
+
+    Results baseline;
+    if (!loadBaseline(path, baseline))
+    {
+        cout << "Cannot read " << path << "; run with -u to create it" << endl;
+        return 1;
+    }
+
+    int failures = 0;
+    char header[160];
+    snprintf(header, sizeof(header), "%-36s %-24s %14s %14s %10s",
+             "pairing", "metric", "baseline", "now", "change");
+    cout << header << endl;
+    for (const pair<string, string>& p : order)
+    {
+        string pairing = p.first + " vs " + p.second;
+        Results::iterator it = baseline.find(p);
+        if (it == baseline.end())
+        {
+            cout << pairing << " is not in the baseline" << endl;
+            continue;
+        }
+        const PairingResult& old = it->second;
+        const PairingResult& now = results[p];
+        if (old.games != now.games)
+        {
+            cout << pairing << " played " << now.games << " games, but the baseline has "
+                 << old.games << "; rerun with -u" << endl;
+            failures++;
+            continue;
+        }
+
+        failures += compare(pairing, "ns per game", old.nsPerGame, now.nsPerGame, timeSlack, false);
+        failures += compare(pairing, "allocs per game", old.allocsPerGame,
+                            now.allocsPerGame, ALLOC_SLACK, false);
+        for (int s = 0; s < 2; s++)
+        {
+            string side = (s == 0 ? p.first : p.second) + (p.first == p.second ? to_string(s + 1) : "");
+            failures += compare(pairing, side + " win %", 100.0 * old.wins[s] / old.games,
+                                100.0 * now.wins[s] / now.games, WIN_SLACK, true, true);
+            failures += compare(pairing, side + " shots to win", old.shotsToWin[s],
+                                now.shotsToWin[s], SHOTS_SLACK, false);
+        }
+    }
+
+    if (failures > 0)
+    {
+        cout << failures << " regression" << (failures == 1 ? "" : "s")
+             << ".  If they are intended, rerun with -u to accept them." << endl;
+        return 1;
+    }
+    cout << "No regressions" << endl;
+    return 0;
+}
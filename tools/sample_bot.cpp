@@ -0,0 +1,135 @@
+// A bot for ExternalPlayer (see ExternalBot.h), as an example of the
+// protocol and for testing it.  It needs nothing from the rest of the
+// project, so it builds on its own:
+//
+//     g++ -std=c++17 -O2 -o sample_bot tools/sample_bot.cpp
+//
+// and plays as "external:./sample_bot".  It places its ships at random,
+// hunts on a checkerboard and, after a hit, tries the hit's neighbors.
+
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+int rows = 0;
+int cols = 0;
+vector<int> lengths;
+vector<bool> shot;          // [r*cols+c]
+vector<int> targets;        // cells to try after a hit, last first
+mt19937 generator(random_device{}());
+
+int randInt(int limit)
+{
+    return uniform_int_distribution<>(0, limit - 1)(generator);
+}
+
+void newGame(istringstream& in)
+{
+    int n;
+    in >> rows >> cols >> n;
+    lengths.assign(n, 0);
+    for (int i = 0; i < n; i++)
+        in >> lengths[i];
+    shot.assign(rows * cols, false);
+    targets.clear();
+}
+
+string place()
+{
+    for (int attempt = 0; attempt < 10000; attempt++)
+    {
+        vector<bool> used(rows * cols, false);
+        ostringstream out;
+        size_t i;
+        for (i = 0; i < lengths.size(); i++)
+        {
+            bool horizontal = randInt(2) == 0;
+            int h = horizontal ? 1 : lengths[i];
+            int w = horizontal ? lengths[i] : 1;
+            if (h > rows  ||  w > cols)
+                break;
+            int r = randInt(rows - h + 1);
+            int c = randInt(cols - w + 1);
+            bool clear = true;
+            for (int k = 0; k < lengths[i]; k++)
+                clear = clear  &&  !used[(r + (horizontal ? 0 : k)) * cols + c + (horizontal ? k : 0)];
+            if (!clear)
+                break;
+            for (int k = 0; k < lengths[i]; k++)
+                used[(r + (horizontal ? 0 : k)) * cols + c + (horizontal ? k : 0)] = true;
+            out << (i > 0 ? " " : "") << r << " " << c << " " << (horizontal ? 'h' : 'v');
+        }
+        if (i == lengths.size())
+            return out.str();
+    }
+    return "";
+}
+
+string attack()
+{
+    while (!targets.empty())
+    {
+        int cell = targets.back();
+        targets.pop_back();
+        if (!shot[cell])
+            return to_string(cell / cols) + " " + to_string(cell % cols);
+    }
+    vector<int> open;
+    vector<int> even;
+    for (int cell = 0; cell < rows * cols; cell++)
+        if (!shot[cell])
+        {
+            open.push_back(cell);
+            if ((cell / cols + cell % cols) % 2 == 0)
+                even.push_back(cell);
+        }
+    const vector<int>& from = (even.empty() ? open : even);
+    if (from.empty())
+        return "0 0";
+    int cell = from[randInt((int)from.size())];
+    return to_string(cell / cols) + " " + to_string(cell % cols);
+}
+
+void result(istringstream& in)
+{
+    int r, c, valid, hit, destroyed, id;
+    if (!(in >> r >> c >> valid >> hit >> destroyed >> id)  ||  !valid)
+        return;
+    shot[r * cols + c] = true;
+    if (!hit  ||  destroyed)
+        return;
+    const int dr[4] = { -1, 1, 0, 0 };
+    const int dc[4] = { 0, 0, -1, 1 };
+    for (int d = 0; d < 4; d++)
+    {
+        int rr = r + dr[d];
+        int cc = c + dc[d];
+        if (rr >= 0  &&  rr < rows  &&  cc >= 0  &&  cc < cols  &&  !shot[rr * cols + cc])
+            targets.push_back(rr * cols + cc);
+    }
+}
+
+int main()
+{
+    string line;
+    while (getline(cin, line))
+    {
+        istringstream in(line);
+        string command;
+        in >> command;
+        if (command == "game")
+            newGame(in);
+        else if (command == "place")
+            cout << place() << endl;
+        else if (command == "attack")
+            cout << attack() << endl;
+        else if (command == "result")
+            result(in);
+        // "opponent" needs nothing from this bot
+    }
+    return 0;
+}
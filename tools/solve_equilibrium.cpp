@@ -0,0 +1,101 @@
+// Solve the placement game of a small board: the defender picks a layout,
+// the attacker a way of searching, and the payoff is the number of shots
+// the attacker needs.  Regret matching against best responses (see
+// EquilibriumSolver in Policy.h) converges to a mixed-strategy equilibrium,
+// which is saved for the "equilibrium" player: a placement distribution
+// and a shot policy that no layout or search can do better against.  The
+// default game is the 2x3 mini-game of main.cpp.
+//
+// usage: solve_equilibrium [strategy [iterations [threads [rows cols length...]]]]
+//        (defaults: equilibrium.bse 1000, one per core, 2 3 2 1)
+
+#include "../Game.h"
+#include "../Policy.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main(int argc, char* argv[])
+{
+    string path = (argc > 1 ? argv[1] : "equilibrium.bse");
+    int iterations = (argc > 2 ? atoi(argv[2]) : 1000);
+    int nThreads = (argc > 3 ? atoi(argv[3]) : 0);     // 0 means one per core
+    int rows = (argc > 5 ? atoi(argv[4]) : 2);
+    int cols = (argc > 5 ? atoi(argv[5]) : 3);
+    if (rows < 1  ||  rows > MAXROWS  ||  cols < 1  ||  cols > MAXCOLS)
+    {
+        cout << "The board must be between 1x1 and " << MAXROWS << "x" << MAXCOLS << endl;
+        return 1;
+    }
+
+    Game g(rows, cols);
+    if (argc > 6)
+    {
+        for (int i = 6; i < argc; i++)
+            g.addShip(atoi(argv[i]), 'A' + (i - 6), string("ship ") + to_string(i - 6));
+    }
+    else
+    {
+        g.addShip(2, 'R', "rowboat");
+        g.addShip(1, 'T', "TEE");
+    }
+
+    auto start = chrono::steady_clock::now();
+    MixedStrategy strategy(g);
+    const LayoutSpace& space = strategy.space();
+    if (!space.ok()  ||  space.nLayouts() == 0)
+    {
+        cout << "That fleet has no layouts, or too many to solve" << endl;
+        return 1;
+    }
+    KnowledgeGraph graph(space, nThreads);
+    if (!graph.ok())
+    {
+        cout << "Too many knowledge states to solve" << endl;
+        return 1;
+    }
+    cout << space.nLayouts() << " layouts, " << graph.size() << " canonical states" << endl;
+
+    // against layouts placed uniformly at random, for comparison
+    vector<int> cells;
+    double uniform = graph.solve(vector<double>(space.nLayouts(), 1.0), cells);
+    cout << "Against uniform placement the best search needs " << uniform << " shots" << endl;
+
+    EquilibriumSolver solver(graph, nThreads);
+    int step = max(1, iterations / 10);
+    while (solver.iterations() < iterations)
+    {
+        solver.run(min(step, iterations - solver.iterations()));
+        cout << "iteration " << solver.iterations() << ": value between "
+        << solver.lowerBound() << " and " << solver.upperBound() << endl;
+    }
+    solver.result(strategy);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    // what the saved strategies actually guarantee
+    int support = 0;
+    double worst = 0;
+    for (int L = 0; L < space.nLayouts(); L++)
+    {
+        if (strategy.placementProbability(L) > 1e-4)
+            support++;
+        worst = max(worst, strategy.expectedShots(L));
+    }
+    cout << "Solved in " << seconds << "s.  The placement distribution uses " << support
+    << " of " << space.nLayouts() << " layouts; mixing " << strategy.nPolicies()
+    << " shot policies needs at most " << worst << " shots on average against any layout"
+    << endl;
+
+    if (!strategy.save(path))
+    {
+        cout << "Cannot write " << path << endl;
+        return 1;
+    }
+    cout << "Saved the strategy to " << path << endl;
+    return 0;
+}
@@ -0,0 +1,77 @@
+// Solve a small game exactly and save the optimal attacking policy for the
+// "optimal" player.
+//
+// Every knowledge state an attacker can reach is valued by dynamic
+// programming (see Policy.h), assuming the defender's layout is drawn
+// uniformly at random.  States that are reflections or rotations of each
+// other are solved once.  The default game is the 2x3 mini-game of main.cpp,
+// with a 2-segment rowboat and a 1-segment TEE.
+//
+// usage: solve_small [policy [threads [rows cols length...]]]
+//        (defaults: policy.bsp, one per core, 2 3 2 1)
+
+#include "../Game.h"
+#include "../Policy.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main(int argc, char* argv[])
+{
+    string path = (argc > 1 ? argv[1] : "policy.bsp");
+    int nThreads = (argc > 2 ? atoi(argv[2]) : 0);     // 0 means one per core
+    int rows = (argc > 4 ? atoi(argv[3]) : 2);
+    int cols = (argc > 4 ? atoi(argv[4]) : 3);
+    if (rows < 1  ||  rows > MAXROWS  ||  cols < 1  ||  cols > MAXCOLS)
+    {
+        cout << "The board must be between 1x1 and " << MAXROWS << "x" << MAXCOLS << endl;
+        return 1;
+    }
+
+    Game g(rows, cols);
+    if (argc > 5)
+    {
+        for (int i = 5; i < argc; i++)
+            g.addShip(atoi(argv[i]), 'A' + (i - 5), string("ship ") + to_string(i - 5));
+    }
+    else
+    {
+        g.addShip(2, 'R', "rowboat");
+        g.addShip(1, 'T', "TEE");
+    }
+
+    auto start = chrono::steady_clock::now();
+    PolicyTable policy(g);
+    const LayoutSpace& space = policy.space();
+    if (!space.ok()  ||  space.nLayouts() == 0)
+    {
+        cout << "That fleet has no layouts, or too many to solve" << endl;
+        return 1;
+    }
+    cout << space.nLayouts() << " layouts, " << space.nSymmetries()
+    << " symmetries" << endl;
+
+    if (!solveOptimalPolicy(policy, nThreads))
+    {
+        cout << "Too many knowledge states to solve" << endl;
+        return 1;
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    Point first = Bitboard::point(policy.bestCell(space.initialState()));
+    cout << policy.size() << " canonical states solved in " << seconds << "s" << endl;
+    cout << "Optimal expected shots to win: " << policy.expectedShots()
+    << " (first shot at " << first.r << "," << first.c << ")" << endl;
+
+    if (!policy.save(path))
+    {
+        cout << "Cannot write " << path << endl;
+        return 1;
+    }
+    cout << "Saved the policy to " << path << endl;
+    return 0;
+}
@@ -0,0 +1,228 @@
+// Search for better values of a player's strategy parameters (Tuning.h).
+//
+// Draws random configurations of the parameters that tune one player type,
+// with the defaults always among them, and plays each against an opponent
+// type by successive halving: every configuration still in the running
+// plays a round of headless games, the better half by win rate goes on to
+// the next round, and each round plays twice as many games as the one
+// before, until one configuration is left.  Every configuration plays the
+// same seeded games in a round, so they are compared on equal terms.  The
+// configurations of a round are played in parallel, one tournament per
+// thread.
+//
+// A configuration that survived the rounds was also picked for its luck,
+// so the winner and the defaults then play a fresh set of games, and the
+// report gives their win rates with 95 percent (Wilson) confidence bounds,
+// and the bounds on the difference between them.
+//
+// The opponent plays with the defaults, so it must not play by the
+// parameters being tuned: neither the same type as the player, nor one
+// built on it (adaptive attacks like mediocre, so it cannot be the
+// opponent of a tuned mediocre player).
+//
+// usage: tune [-p player] [-o opponent] [-n configs] [-g games] [-f games]
+//             [-j threads] [-s seed]
+//
+//   -p   the player type to tune (default mediocre)
+//   -o   the opponent type (default good)
+//   -n   configurations to draw (default 32)
+//   -g   games each configuration plays in the first round (default 40)
+//   -f   games the winner and the defaults play at the end (default 4000)
+//   -j   threads (default one per processor)
+//   -s   seed for the configurations and the games (default 1)
+
+#include "../Game.h"
+#include "../StaticGame.h"
+#include "../Tournament.h"
+#include "../Tuning.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+const double Z95 = 1.96;
+
+struct Candidate
+{
+    TuningConfig config;
+    int games = 0;
+    int wins = 0;
+
+    double rate() const { return games == 0 ? 0 : double(wins) / games; }
+};
+
+// Play nGames between player and opponent for every candidate in which,
+// one candidate per thread at a time, adding to their totals
+void playRound(const Game& g, const string& player, const string& opponent,
+               vector<Candidate>& candidates, const vector<int>& which,
+               int nGames, unsigned seed, int nThreads)
+{
+    atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i = next++; i < which.size(); i = next++)
+        {
+            Candidate& c = candidates[which[i]];
+            setTuning(c.config);
+            TournamentResult r = runTournament(g, player, opponent, nGames, true, 1, seed);
+            resetTuning();
+            c.games += r.games;
+            c.wins += r.wins[0];
+        }
+    };
+
+    vector<thread> threads;
+    for (int t = 1; t < nThreads  &&  t < (int)which.size(); t++)
+        threads.push_back(thread(worker));
+    worker();
+    for (size_t t = 0; t < threads.size(); t++)
+        threads[t].join();
+}
+
+// The 95 percent Wilson score interval for wins out of n
+void wilson(int wins, int n, double& low, double& high)
+{
+    if (n == 0)
+    {
+        low = 0;
+        high = 1;
+        return;
+    }
+    double p = double(wins) / n;
+    double z2 = Z95 * Z95;
+    double center = (p + z2 / (2 * n)) / (1 + z2 / n);
+    double half = Z95 * sqrt(p * (1 - p) / n + z2 / (4.0 * n * n)) / (1 + z2 / n);
+    low = center - half;
+    high = center + half;
+}
+
+void report(const string& label, const Candidate& c)
+{
+    double low, high;
+    wilson(c.wins, c.games, low, high);
+    cout << setw(10) << left << label << right << fixed << setprecision(2)
+         << setw(7) << 100 * c.rate() << "% of " << c.games << " games"
+         << "  (95% bounds " << 100 * low << "% to " << 100 * high << "%)" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+    string player = "mediocre";
+    string opponent = "good";
+    int nConfigs = 32;
+    int firstGames = 40;
+    int finalGames = 4000;
+    int nThreads = max(1, (int)thread::hardware_concurrency());
+    unsigned seed = 1;
+
+    for (int a = 1; a < argc; a += 2)
+    {
+        if (a + 1 >= argc  ||  argv[a][0] != '-'  ||  strlen(argv[a]) != 2)
+        {
+            cout << "usage: tune [-p player] [-o opponent] [-n configs] [-g games] [-f games]"
+                 << " [-j threads] [-s seed]" << endl;
+            return 1;
+        }
+        const char* value = argv[a + 1];
+        switch (argv[a][1])
+        {
+          case 'p':  player = value;                        break;
+          case 'o':  opponent = value;                      break;
+          case 'n':  nConfigs = max(1, atoi(value));        break;
+          case 'g':  firstGames = max(2, atoi(value));      break;
+          case 'f':  finalGames = max(2, atoi(value));      break;
+          case 'j':  nThreads = max(1, atoi(value));        break;
+          case 's':  seed = (unsigned)strtoul(value, nullptr, 10); break;
+          default:
+            cout << "Unknown option " << argv[a] << endl;
+            return 1;
+        }
+    }
+
+    vector<int> params;
+    for (int p = 0; p < NTUNINGPARAMS; p++)
+        if (player == tuningInfo(p).player)
+            params.push_back(p);
+    if (params.empty())
+    {
+        cout << "No parameters tune the " << player << " player" << endl;
+        return 1;
+    }
+    if (readsTuning(opponent, player))
+    {
+        cout << "The " << opponent << " player plays by the " << player
+             << " parameters, so it cannot be the opponent" << endl;
+        return 1;
+    }
+
+    Game g(10, 10);
+    addFleet<StandardFleet>(g);
+
+    // the defaults are candidate 0, so a search never reports anything
+    // worse without having played it against them
+    mt19937 draw(seed);
+    vector<Candidate> candidates(nConfigs);
+    for (int k = 1; k < nConfigs; k++)
+        for (size_t i = 0; i < params.size(); i++)
+        {
+            const TuningInfo& info = tuningInfo(params[i]);
+            uniform_int_distribution<> value(info.minValue, info.maxValue);
+            candidates[k].config.value[params[i]] = value(draw);
+        }
+
+    cout << "Tuning " << player << " against " << opponent << ": " << nConfigs
+         << " configurations of";
+    for (size_t i = 0; i < params.size(); i++)
+        cout << " " << tuningInfo(params[i]).name;
+    cout << ", " << nThreads << " threads" << endl;
+
+    // successive halving
+    vector<int> alive(nConfigs);
+    for (int k = 0; k < nConfigs; k++)
+        alive[k] = k;
+    int nGames = firstGames;
+    for (int round = 1; alive.size() > 1; round++)
+    {
+        playRound(g, player, opponent, candidates, alive, nGames, seed * 1000 + round, nThreads);
+        stable_sort(alive.begin(), alive.end(), [&](int a, int b) {
+            return candidates[a].rate() > candidates[b].rate();
+        });
+        const Candidate& best = candidates[alive[0]];
+        cout << "round " << round << ": " << alive.size() << " configurations, "
+             << nGames << " games each; best " << fixed << setprecision(1)
+             << 100 * best.rate() << "% after " << best.games << " games" << endl;
+        alive.resize((alive.size() + 1) / 2);
+        nGames *= 2;
+    }
+
+    // the winner's totals are biased upward by the selection, so measure
+    // it again, alongside the defaults, on games it has not seen
+    vector<Candidate> finalists(2);
+    finalists[0].config = candidates[alive[0]].config;
+    vector<int> both = { 0, 1 };
+    playRound(g, player, opponent, finalists, both, finalGames, seed * 1000, nThreads);
+
+    cout << endl << "best: " << finalists[0].config.describe() << endl;
+    report("best", finalists[0]);
+    report("defaults", finalists[1]);
+
+    // the two were measured on the same games, which only makes this
+    // interval wider than it needs to be
+    double p1 = finalists[0].rate();
+    double p2 = finalists[1].rate();
+    double diff = p1 - p2;
+    double half = Z95 * sqrt(p1 * (1 - p1) / finalists[0].games + p2 * (1 - p2) / finalists[1].games);
+    cout << "difference " << showpos << fixed << setprecision(2) << 100 * diff
+         << noshowpos << " points  (95% bounds " << showpos << 100 * (diff - half)
+         << " to " << 100 * (diff + half) << noshowpos << ")" << endl;
+    return 0;
+}